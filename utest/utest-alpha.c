@@ -0,0 +1,561 @@
+/*******************************************************************************
+ * utest-alpha.c
+ *
+ * IMR unit test application - alpha-masks cache
+ *
+ * Copyright (c) 2016 Cogent Embedded Inc. ALL RIGHTS RESERVED.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#define MODULE_TAG                      ALPHA
+
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+
+#include "utest-common.h"
+#include "utest-alpha.h"
+
+/*******************************************************************************
+ * Tracing configuration
+ ******************************************************************************/
+
+TRACE_TAG(INIT, 1);
+TRACE_TAG(INFO, 1);
+TRACE_TAG(DEBUG, 0);
+
+/*******************************************************************************
+ * Local types definitions
+ ******************************************************************************/
+
+/* ...maximal amount of compressed data kept in memory */
+#define ALPHA_CACHE_LIMIT               (32 << 20)
+
+/* ...persistent file signature ("AMSK") */
+#define ALPHA_FILE_MAGIC                0x4B534D41
+
+/* ...compressed alpha-masks set */
+struct alpha_mask
+{
+    /* ...owning cache */
+    alpha_cache_t          *cache;
+
+    /* ...cache key (packed step triple) */
+    u32                     key;
+
+    /* ...per-plane bounding boxes of compressed area (x0, y0, x1, y1) */
+    int                     bbox[ALPHA_MASK_PLANES][4];
+
+    /* ...per-plane compressed data */
+    u8                     *data[ALPHA_MASK_PLANES];
+
+    /* ...per-plane compressed data size */
+    u32                     size[ALPHA_MASK_PLANES];
+
+    /* ...position in recency list */
+    GList                   link;
+
+    /* ...number of users (pinned set is never evicted) */
+    int                     refs;
+};
+
+/* ...alpha-masks cache */
+struct alpha_cache
+{
+    /* ...alpha-plane dimensions */
+    int                     w, h;
+
+    /* ...persistent storage directory (optional) */
+    char                   *path;
+
+    /* ...configuration tag (mesh, steps, gain) */
+    u32                     tag;
+
+    /* ...masks sets indexed by key */
+    GHashTable             *table;
+
+    /* ...masks sets in use order, least recently used first (eviction queue) */
+    GQueue                  order;
+
+    /* ...masks sets not written to persistent storage yet */
+    GQueue                  unsaved;
+
+    /* ...total size of compressed data */
+    u32                     size;
+
+    /* ...access lock (lookups and insertions come from different threads) */
+    pthread_mutex_t         lock;
+};
+
+/* ...persistent file header */
+struct alpha_file
+{
+    u32                     magic, tag;
+    u32                     w, h;
+    u32                     key;
+    s32                     bbox[ALPHA_MASK_PLANES][4];
+    u32                     size[ALPHA_MASK_PLANES];
+};
+
+/*******************************************************************************
+ * Run-length coding (PackBits)
+ ******************************************************************************/
+
+/* ...compress single row; returns size of compressed data */
+static int __rle_encode(u8 *dst, const u8 *src, int n)
+{
+    u8     *p = dst;
+    int     i = 0, k;
+
+    while (i < n)
+    {
+        /* ...measure run of identical bytes */
+        for (k = 1; i + k < n && k < 129 && src[i + k] == src[i]; k++)
+            ;
+
+        if (k >= 2)
+        {
+            /* ...run of 2..129 bytes */
+            *p++ = (u8)(k + 126), *p++ = src[i], i += k;
+        }
+        else
+        {
+            /* ...literal sequence up to next run (1..128 bytes) */
+            for (k = 1; i + k < n && k < 128 && (i + k + 1 == n || src[i + k] != src[i + k + 1]); k++)
+                ;
+
+            *p++ = (u8)(k - 1), memcpy(p, src + i, k), p += k, i += k;
+        }
+    }
+
+    return (int)(p - dst);
+}
+
+/* ...decompress single row into cleared memory (zero runs are skipped) */
+static int __rle_decode(u8 *dst, int n, const u8 **src, const u8 *end)
+{
+    const u8   *p = *src;
+    int         k;
+
+    while (n > 0)
+    {
+        CHK_ERR(p < end, -(errno = EINVAL));
+
+        if (*p < 128)
+        {
+            /* ...literal sequence */
+            k = *p++ + 1;
+            CHK_ERR(k <= n && p + k <= end, -(errno = EINVAL));
+            memcpy(dst, p, k), p += k;
+        }
+        else
+        {
+            /* ...run of identical bytes */
+            k = *p++ - 126;
+            CHK_ERR(k <= n && p < end, -(errno = EINVAL));
+            (*p != 0 ? memset(dst, *p, k) : NULL), p++;
+        }
+
+        dst += k, n -= k;
+    }
+
+    *src = p;
+
+    return 0;
+}
+
+/*******************************************************************************
+ * Persistent storage
+ ******************************************************************************/
+
+/* ...pack step triple into a cache key */
+static inline u32 __mask_key(const int *step)
+{
+    BUG((u32)step[0] >= 1024 || (u32)step[1] >= 1024 || (u32)step[2] >= 1024, _x("invalid step: %d/%d/%d"), step[0], step[1], step[2]);
+
+    return (u32)step[0] | ((u32)step[1] << 10) | ((u32)step[2] << 20);
+}
+
+/* ...compose file name of a masks set */
+static inline void __mask_name(alpha_cache_t *cache, u32 key, char *name, int size)
+{
+    snprintf(name, size, "%s/alpha-%u-%u-%u.rle", cache->path, key & 0x3FF, (key >> 10) & 0x3FF, key >> 20);
+}
+
+/* ...load masks set from persistent storage */
+static alpha_mask_t * __mask_load(alpha_cache_t *cache, u32 key)
+{
+    char                name[PATH_MAX];
+    struct alpha_file   hdr;
+    alpha_mask_t       *mask;
+    FILE               *f;
+    int                 k;
+
+    __mask_name(cache, key, name, sizeof(name));
+
+    /* ...absence of a file is a normal cache miss */
+    if ((f = fopen(name, "rb")) == NULL)    return NULL;
+
+    /* ...validate file header */
+    if (fread(&hdr, sizeof(hdr), 1, f) != 1 || hdr.magic != ALPHA_FILE_MAGIC ||
+        hdr.tag != cache->tag || hdr.w != (u32)cache->w || hdr.h != (u32)cache->h || hdr.key != key)
+    {
+        TRACE(INFO, _b("ignore stale mask file '%s'"), name);
+        goto error;
+    }
+
+    if ((mask = calloc(1, sizeof(*mask))) == NULL)
+    {
+        TRACE(ERROR, _x("failed to allocate mask"));
+        goto error;
+    }
+
+    mask->cache = cache, mask->key = key, mask->link.data = mask;
+
+    /* ...read compressed planes */
+    for (k = 0; k < ALPHA_MASK_PLANES; k++)
+    {
+        memcpy(mask->bbox[k], hdr.bbox[k], sizeof(mask->bbox[k]));
+
+        if ((mask->size[k] = hdr.size[k]) == 0)     continue;
+
+        if ((mask->data[k] = malloc(mask->size[k])) == NULL || fread(mask->data[k], mask->size[k], 1, f) != 1)
+        {
+            TRACE(ERROR, _x("failed to read mask file '%s'"), name);
+            alpha_mask_destroy(mask);
+            goto error;
+        }
+    }
+
+    fclose(f);
+
+    TRACE(DEBUG, _b("mask '%s' loaded (%u + %u bytes)"), name, mask->size[0], mask->size[1]);
+
+    return mask;
+
+error:
+    fclose(f);
+    return NULL;
+}
+
+/* ...write masks set to persistent storage */
+static int __mask_save(alpha_cache_t *cache, alpha_mask_t *mask)
+{
+    char                name[PATH_MAX], tmp[PATH_MAX];
+    struct alpha_file   hdr;
+    FILE               *f;
+    int                 k, r = 0;
+
+    __mask_name(cache, mask->key, name, sizeof(name));
+    snprintf(tmp, sizeof(tmp), "%s.tmp", name);
+
+    /* ...fill-in header */
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = ALPHA_FILE_MAGIC, hdr.tag = cache->tag;
+    hdr.w = cache->w, hdr.h = cache->h, hdr.key = mask->key;
+    memcpy(hdr.bbox, mask->bbox, sizeof(hdr.bbox));
+    memcpy(hdr.size, mask->size, sizeof(hdr.size));
+
+    /* ...write temporary file and rename it to keep storage consistent */
+    CHK_ERR(f = fopen(tmp, "wb"), -errno);
+
+    (fwrite(&hdr, sizeof(hdr), 1, f) != 1 ? r = -EIO : 0);
+
+    for (k = 0; r == 0 && k < ALPHA_MASK_PLANES; k++)
+    {
+        (mask->size[k] && fwrite(mask->data[k], mask->size[k], 1, f) != 1 ? r = -EIO : 0);
+    }
+
+    (fclose(f) != 0 ? r = -EIO : 0);
+
+    if (r == 0 && rename(tmp, name) == 0)
+    {
+        TRACE(DEBUG, _b("mask '%s' saved"), name);
+        return 0;
+    }
+
+    TRACE(ERROR, _x("failed to write mask file '%s'"), name);
+    unlink(tmp);
+    return -(errno = EIO);
+}
+
+/*******************************************************************************
+ * Masks set API
+ ******************************************************************************/
+
+/* ...create empty masks set for a view step */
+alpha_mask_t * alpha_mask_create(alpha_cache_t *cache, const int *step)
+{
+    alpha_mask_t   *mask;
+
+    CHK_ERR(mask = calloc(1, sizeof(*mask)), (errno = ENOMEM, NULL));
+
+    mask->cache = cache, mask->key = __mask_key(step), mask->link.data = mask;
+
+    return mask;
+}
+
+/* ...compress bounding box of an alpha-plane into masks set */
+int alpha_mask_encode(alpha_mask_t *mask, int k, const u8 *plane, const int *bbox)
+{
+    int     w = mask->cache->w, h = mask->cache->h;
+    int     n = bbox[2] - bbox[0], y;
+    u8     *data, *p;
+
+    BUG((u32)k >= ALPHA_MASK_PLANES, _x("invalid plane: %d"), k);
+
+    /* ...drop previous data if any */
+    free(mask->data[k]), mask->data[k] = NULL, mask->size[k] = 0;
+    memset(mask->bbox[k], 0, sizeof(mask->bbox[k]));
+
+    /* ...nothing to save for an empty area */
+    if (n <= 0 || bbox[3] <= bbox[1])       return 0;
+
+    BUG(bbox[0] < 0 || bbox[1] < 0 || bbox[2] > w || bbox[3] > h, _x("invalid box: %d,%d,%d,%d"), bbox[0], bbox[1], bbox[2], bbox[3]);
+
+    /* ...allocate worst-case buffer (single literal followed by a pair is 4 bytes per 3) */
+    CHK_ERR(data = malloc((bbox[3] - bbox[1]) * (n + (n >> 1) + 2)), -(errno = ENOMEM));
+
+    /* ...compress rows separately */
+    for (p = data, y = bbox[1]; y < bbox[3]; y++)
+    {
+        p += __rle_encode(p, plane + y * w + bbox[0], n);
+    }
+
+    /* ...trim buffer to actual size */
+    mask->size[k] = (u32)(p - data);
+    mask->data[k] = realloc(data, mask->size[k]) ? : data;
+    memcpy(mask->bbox[k], bbox, sizeof(mask->bbox[k]));
+
+    TRACE(DEBUG, _b("plane-%d: %d*%d -> %u bytes"), k, n, bbox[3] - bbox[1], mask->size[k]);
+
+    return 0;
+}
+
+/* ...decompress alpha-plane from a masks set (plane must be cleared) */
+int alpha_mask_decode(alpha_mask_t *mask, int k, u8 *plane, int *bbox)
+{
+    int         w = mask->cache->w, h = mask->cache->h;
+    int        *box = mask->bbox[k];
+    const u8   *src = mask->data[k], *end = src + mask->size[k];
+    int         y;
+
+    BUG((u32)k >= ALPHA_MASK_PLANES, _x("invalid plane: %d"), k);
+
+    /* ...empty plane has no data */
+    if (mask->size[k] == 0)
+    {
+        bbox[0] = w, bbox[1] = h, bbox[2] = bbox[3] = 0;
+        return 0;
+    }
+
+    /* ...decompress rows */
+    for (y = box[1]; y < box[3]; y++)
+    {
+        CHK_API(__rle_decode(plane + y * w + box[0], box[2] - box[0], &src, end));
+    }
+
+    /* ...return area touched */
+    memcpy(bbox, box, sizeof(mask->bbox[k]));
+
+    return 0;
+}
+
+/* ...destroy masks set not inserted into a cache */
+void alpha_mask_destroy(alpha_mask_t *mask)
+{
+    int     k;
+
+    for (k = 0; k < ALPHA_MASK_PLANES; k++)
+    {
+        free(mask->data[k]);
+    }
+
+    free(mask);
+}
+
+/*******************************************************************************
+ * Cache API
+ ******************************************************************************/
+
+/* ...total compressed size of masks set */
+static inline u32 __mask_size(alpha_mask_t *mask)
+{
+    return mask->size[0] + mask->size[1];
+}
+
+/* ...insert masks set into in-memory index (called with a lock held) */
+static void __cache_add(alpha_cache_t *cache, alpha_mask_t *mask)
+{
+    GList      *link, *next;
+
+    g_hash_table_insert(cache->table, GUINT_TO_POINTER(mask->key), mask);
+    g_queue_push_tail_link(&cache->order, &mask->link);
+    cache->size += __mask_size(mask);
+
+    /* ...evict least recently used entries if memory limit is exceeded (keep the newest and pinned ones) */
+    for (link = cache->order.head; link != &mask->link && cache->size > ALPHA_CACHE_LIMIT; link = next)
+    {
+        alpha_mask_t   *m = link->data;
+
+        next = link->next;
+
+        if (m->refs)    continue;
+
+        TRACE(DEBUG, _b("evict mask #%X"), m->key);
+
+        g_hash_table_remove(cache->table, GUINT_TO_POINTER(m->key));
+        g_queue_unlink(&cache->order, link);
+        g_queue_remove(&cache->unsaved, m);
+        cache->size -= __mask_size(m);
+        alpha_mask_destroy(m);
+    }
+}
+
+/* ...find masks set for a view step (RAM first, then persistent storage) */
+alpha_mask_t * alpha_cache_lookup(alpha_cache_t *cache, const int *step)
+{
+    u32             key = __mask_key(step);
+    alpha_mask_t   *mask;
+
+    pthread_mutex_lock(&cache->lock);
+
+    /* ...check in-memory index */
+    if ((mask = g_hash_table_lookup(cache->table, GUINT_TO_POINTER(key))) != NULL)
+    {
+        /* ...move entry to the most recently used position */
+        g_queue_unlink(&cache->order, &mask->link);
+        g_queue_push_tail_link(&cache->order, &mask->link);
+    }
+    else if (cache->path && (mask = __mask_load(cache, key)) != NULL)
+    {
+        /* ...loaded from persistent storage */
+        __cache_add(cache, mask);
+    }
+
+    /* ...pin the set until the caller releases it */
+    (mask ? mask->refs++ : 0);
+
+    pthread_mutex_unlock(&cache->lock);
+
+    return mask;
+}
+
+/* ...release masks set returned by a lookup */
+void alpha_cache_release(alpha_cache_t *cache, alpha_mask_t *mask)
+{
+    pthread_mutex_lock(&cache->lock);
+
+    BUG(mask->refs <= 0, _x("mask #%X: invalid refcount: %d"), mask->key, mask->refs);
+
+    mask->refs--;
+
+    pthread_mutex_unlock(&cache->lock);
+}
+
+/* ...insert complete masks set into a cache (takes ownership) */
+int alpha_cache_insert(alpha_cache_t *cache, alpha_mask_t *mask)
+{
+    pthread_mutex_lock(&cache->lock);
+
+    /* ...ignore duplicate (shouldn't happen) */
+    if (g_hash_table_lookup(cache->table, GUINT_TO_POINTER(mask->key)) != NULL)
+    {
+        pthread_mutex_unlock(&cache->lock);
+        alpha_mask_destroy(mask);
+        return 0;
+    }
+
+    TRACE(DEBUG, _b("insert mask #%X (%u bytes)"), mask->key, __mask_size(mask));
+
+    /* ...schedule write to persistent storage as required */
+    (cache->path ? g_queue_push_tail(&cache->unsaved, mask) : 0);
+
+    __cache_add(cache, mask);
+
+    pthread_mutex_unlock(&cache->lock);
+
+    return 0;
+}
+
+/* ...write new masks sets to persistent storage */
+int alpha_cache_flush(alpha_cache_t *cache)
+{
+    alpha_mask_t   *mask;
+
+    pthread_mutex_lock(&cache->lock);
+
+    while ((mask = g_queue_pop_head(&cache->unsaved)) != NULL)
+    {
+        /* ...pin the set and write it without a lock */
+        mask->refs++;
+        pthread_mutex_unlock(&cache->lock);
+
+        /* ...failure is not fatal; masks will be re-rendered next time */
+        __mask_save(cache, mask);
+
+        pthread_mutex_lock(&cache->lock);
+        mask->refs--;
+    }
+
+    pthread_mutex_unlock(&cache->lock);
+
+    return 0;
+}
+
+/* ...create alpha-masks cache */
+alpha_cache_t * alpha_cache_create(int w, int h, const char *path, u32 tag)
+{
+    alpha_cache_t  *cache;
+
+    CHK_ERR(cache = calloc(1, sizeof(*cache)), (errno = ENOMEM, NULL));
+
+    cache->w = w, cache->h = h, cache->tag = tag;
+    cache->path = (path ? strdup(path) : NULL);
+    cache->table = g_hash_table_new(g_direct_hash, g_direct_equal);
+    g_queue_init(&cache->order);
+    g_queue_init(&cache->unsaved);
+    pthread_mutex_init(&cache->lock, NULL);
+
+    TRACE(INIT, _b("alpha-masks cache created: %d*%d, storage: '%s'"), w, h, (path ? : "none"));
+
+    return cache;
+}
+
+/* ...destroy cache */
+void alpha_cache_destroy(alpha_cache_t *cache)
+{
+    alpha_mask_t   *mask;
+
+    /* ...save pending masks */
+    alpha_cache_flush(cache);
+
+    while (!g_queue_is_empty(&cache->order))
+    {
+        mask = cache->order.head->data;
+        g_queue_unlink(&cache->order, &mask->link);
+        alpha_mask_destroy(mask);
+    }
+
+    g_hash_table_destroy(cache->table);
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->path);
+    free(cache);
+}
@@ -0,0 +1,75 @@
+/*******************************************************************************
+ * utest-alpha.h
+ *
+ * IMR unit test application - alpha-masks cache
+ *
+ * Copyright (c) 2016 Cogent Embedded Inc. ALL RIGHTS RESERVED.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#ifndef __UTEST_ALPHA_H
+#define __UTEST_ALPHA_H
+
+/*******************************************************************************
+ * Types definitions
+ ******************************************************************************/
+
+/* ...number of alpha-planes in a mask set */
+#define ALPHA_MASK_PLANES               2
+
+/* ...opaque types */
+typedef struct alpha_cache  alpha_cache_t;
+typedef struct alpha_mask   alpha_mask_t;
+
+/*******************************************************************************
+ * External API
+ ******************************************************************************/
+
+/* ...create alpha-masks cache (path is optional persistent storage directory) */
+extern alpha_cache_t * alpha_cache_create(int w, int h, const char *path, u32 tag);
+
+/* ...find masks set for a view step (RAM first, then persistent storage); set is pinned until released */
+extern alpha_mask_t * alpha_cache_lookup(alpha_cache_t *cache, const int *step);
+
+/* ...release masks set returned by a lookup */
+extern void alpha_cache_release(alpha_cache_t *cache, alpha_mask_t *mask);
+
+/* ...create empty masks set for a view step */
+extern alpha_mask_t * alpha_mask_create(alpha_cache_t *cache, const int *step);
+
+/* ...compress bounding box of an alpha-plane into masks set */
+extern int alpha_mask_encode(alpha_mask_t *mask, int k, const u8 *plane, const int *bbox);
+
+/* ...decompress alpha-plane from a masks set (plane must be cleared) */
+extern int alpha_mask_decode(alpha_mask_t *mask, int k, u8 *plane, int *bbox);
+
+/* ...destroy masks set not inserted into a cache */
+extern void alpha_mask_destroy(alpha_mask_t *mask);
+
+/* ...insert complete masks set into a cache (takes ownership) */
+extern int alpha_cache_insert(alpha_cache_t *cache, alpha_mask_t *mask);
+
+/* ...write new masks sets to persistent storage */
+extern int alpha_cache_flush(alpha_cache_t *cache);
+
+/* ...destroy cache */
+extern void alpha_cache_destroy(alpha_cache_t *cache);
+
+#endif  /* __UTEST_ALPHA_H */
@@ -35,7 +35,10 @@
 #include "utest-vsink.h"
 #include "utest-png.h"
 #include "utest-vin.h"
+#include "utest-replay.h"
+#include "utest-record.h"
 #include "utest-imr-sv.h"
+#include "utest-sync.h"
 #include <linux/videodev2.h>
 #include <pango/pangocairo.h>
 #include <math.h>
@@ -52,12 +55,15 @@ TRACE_TAG(DEBUG, 1);
  * Local constants definitions
  ******************************************************************************/
 
-/* ...size of compositor buffers pool */
-#define VSP_POOL_SIZE                   2
-
 /* ...number of cameras */
 #define VIN_NUMBER                      4
 
+/* ...maximal number of frames waiting for alignment per camera */
+#define VIN_SYNC_DEPTH                  3
+
+/* ...number of composed frames between dropped frames reports */
+#define APP_DROPS_REPORT                256
+
 /*******************************************************************************
  * Local types definitions
  ******************************************************************************/
@@ -82,14 +88,14 @@ struct app_data
     /* ...miscellaneous control flags */
     u32                 flags;
 
-    /* ...input (camera) buffers readiness flag */
-    u32                 input_ready;
-
-    /* ...pending input buffers (waiting for IMR processing start) */
-    GQueue              input[CAMERAS_NUMBER];
+    /* ...pending input buffers synchronizer (waiting for IMR processing start) */
+    frame_sync_t       *sync;
 
     /* ...rendering queue for main window (buffers waiting for visualization) */
     GQueue              render;
+
+    /* ...number of composed frames and frames dropped from rendering queue */
+    u32                 ready_num, render_dropped;
     
     /* ...data access lock */
     pthread_mutex_t     lock;
@@ -97,6 +103,12 @@ struct app_data
     /* ...VIN handle */
     vin_data_t         *vin;
 
+    /* ...recorded cameras replay handle (replaces VIN if set) */
+    replay_data_t      *replay;
+
+    /* ...capture recorder (optional) */
+    recorder_t         *recorder;
+
     /* ...IMR engine handle */
     imr_sview_t        *imr_sv;
     
@@ -223,6 +235,8 @@ static int app_input_process(void *data, int i, GstBuffer *buffer)
 {
     app_data_t     *app = data;
     vsink_meta_t   *vmeta = gst_buffer_get_vsink_meta(buffer);
+    GstBuffer      *buf[VIN_NUMBER];
+    int             r;
 
     TRACE(DEBUG, _b("camera-%d: input buffer received"), i);
 
@@ -232,44 +246,41 @@ static int app_input_process(void *data, int i, GstBuffer *buffer)
     /* ...make sure buffer dimensions are valid */
     CHK_ERR(vmeta && vmeta->width == app->width && vmeta->height == app->height, -EINVAL);
 
+    /* ...recorder takes a reference; frame is not recorded if disk is not keeping up */
+    (app->recorder ? recorder_store(app->recorder, i, buffer) : 0);
+
+    /* ...per-camera dispatch starts engine right away (sets are joined by compositor) */
+    if (__camera_dispatch)
+    {
+        return CHK_API(imr_sview_submit_camera(app->imr_sv, i, buffer));
+    }
+
     /* ...lock access to the internal queue */
     pthread_mutex_lock(&app->lock);
     
+    /* ...stalled cameras do not hold the sets */
+    frame_sync_absent(app->sync, imr_sview_watchdog(app->imr_sv, i));
+
     /* ...collect buffers in a pending input queue */
-    g_queue_push_tail(&app->input[i], gst_buffer_ref(buffer));
+    r = frame_sync_push(app->sync, i, buffer);
 
-    /* ...submit a job only when all buffers have been collected */
-    if ((app->input_ready &= ~(1 << i)) == 0)
+    /* ...submit a job for every set of temporally aligned buffers */
+    while (r == 0 && frame_sync_pop(app->sync, buf))
     {
-        GstBuffer  *buf[4];
-            
-        /* ...collect buffers from input queue (it is a common function) */
-        for (i = 0; i < 4; i++)
-        {
-            buf[i] = g_queue_pop_head(&app->input[i]);
-
-            /* ...update readiness flag */
-            (g_queue_is_empty(&app->input[i]) ? app->input_ready |= (1 << i) : 0);
-        }
-
         /* ...submit buffers to the engine */
-        CHK_API(imr_sview_submit(app->imr_sv, buf));
+        r = imr_sview_submit(app->imr_sv, buf);
 
-        /* ...release buffers ownership */
-        for (i = 0; i < 4; i++)
+        /* ...release buffers ownership (stalled camera has none) */
+        for (i = 0; i < VIN_NUMBER; i++)
         {
-            gst_buffer_unref(buf[i]);
+            (buf[i] ? gst_buffer_unref(buf[i]) : 0);
         }
     }
-    else
-    {
-        TRACE(DEBUG, _b("buffer queued: %X"), app->input_ready);
-    }
 
     /* ...unlock internal data */
     pthread_mutex_unlock(&app->lock);
 
-    return 0;
+    return CHK_API(r);
 }
 
 /* ...callbacks for camera back-end */
@@ -293,11 +304,24 @@ static void imr_sv_ready(void *cdata, GstBuffer **buf)
     /* ...lock internal application data */
     pthread_mutex_lock(&app->lock);
 
+    /* ...latest-frame-wins mode drops the oldest frame waiting for visualization */
+    if (__latest_depth && (int)g_queue_get_length(&app->render) >= __latest_depth)
+    {
+        gst_buffer_unref(g_queue_pop_head(&app->render));
+        app->render_dropped++;
+    }
+
     /* ...put buffer into rendering queue */
     g_queue_push_tail(&app->render, gst_buffer_ref(buffer));
 
     /* ...all other buffers are just dropped - tbd */
 
+    /* ...report frames dropped by every stage periodically */
+    if (__latest_depth && ++app->ready_num % APP_DROPS_REPORT == 0)
+    {
+        TRACE(INFO, _b("frames dropped: cameras %u/%u/%u/%u, engines %u, display %u"), frame_sync_dropped(app->sync, 0), frame_sync_dropped(app->sync, 1), frame_sync_dropped(app->sync, 2), frame_sync_dropped(app->sync, 3), imr_sview_dropped(app->imr_sv), app->render_dropped);
+    }
+
     /* ...rendering is available */
     window_schedule_redraw(app->window);
 
@@ -441,23 +465,43 @@ static int app_context_init(widget_data_t *widget, void *data)
     int             h = window_get_height(window);
     int             i;
 
-    /* ...create VIN engine */
-    CHK_ERR(app->vin = vin_init(vin_dev_name, VIN_NUMBER, &camera_cb, app), -errno);
+    /* ...create cameras frames synchronizer (matching is done by capturing timestamps) */
+    CHK_ERR(app->sync = frame_sync_create(VIN_NUMBER, (u64)__sync_window * 1000000, (__latest_depth ? : VIN_SYNC_DEPTH)), -errno);
+
+    /* ...create capture recorder if requested */
+    if (__record_prefix)
+    {
+        CHK_ERR(app->recorder = recorder_create(__record_prefix, VIN_NUMBER), -errno);
+    }
+
+    if (__replay_files)
+    {
+        /* ...open cameras recording */
+        CHK_ERR(app->replay = replay_init(replay_file_name, __replay_files, VIN_NUMBER, __replay_rate, &camera_cb, app), -errno);
+
+        /* ...replay buffers are separate memory blocks (allocated before surround-view arena) */
+        for (i = 0; i < VIN_NUMBER; i++)
+        {
+            CHK_API(replay_device_init(app->replay, i, __vin_width, __vin_height, __vin_format, __vin_buffers_num));
+        }
+    }
+    else
+    {
+        /* ...create VIN engine */
+        CHK_ERR(app->vin = vin_init(vin_dev_name, VIN_NUMBER, &camera_cb, app), -errno);
+    }
 
     /* ...setup IMR-based surround-view engine (FullHD is a maximal possible resolution) */
     CHK_ERR(app->imr_sv = imr_sview_init(&imr_sv_callback, app, __vin_width, __vin_height, __vin_format, __vsp_width, __vsp_height, __car_width, __car_height, __shadow_rect), -errno);
 
     /* ...setup VINs */
-    for (i = 0; i < VIN_NUMBER; i++)
+    for (i = 0; app->vin && i < VIN_NUMBER; i++)
     {
         /* ...use 1280*800 UYVY configuration; use pool of 5 buffers */
         CHK_API(vin_device_init(app->vin, i, __vin_width, __vin_height, __vin_format, __vin_buffers_num));
 
     }
 
-    /* ...buffers not ready */
-    app->input_ready = (1 << VIN_NUMBER) - 1;
-
     TRACE(INFO, _b("run-time initialized: VIN: %d*%d@%c%c%c%c, VSP: %d*%d, DISP: %d*%d"), __vin_width, __vin_height, __v4l2_fmt(__vin_format), __vsp_width, __vsp_height, w, h);
 
     return 0;
@@ -471,6 +515,8 @@ void * app_thread(void *arg)
 {
     app_data_t     *app = arg;
 
+    thread_placement(THREAD_LOOP);
+
     g_main_loop_run(app->loop);
     
     return NULL;
@@ -623,6 +669,12 @@ static void app_destroy(gpointer data, GObject *obj)
 
     /* ...destroy main application window */
     (app->window ? window_destroy(app->window) : 0);
+
+    /* ...release pending input buffers */
+    (app->sync ? frame_sync_destroy(app->sync), 0 : 0);
+
+    /* ...write pending recorded frames */
+    (app->recorder ? recorder_destroy(app->recorder), 0 : 0);
     
     /* ...free application data structure */
     free(app);
@@ -732,10 +784,10 @@ app_data_t * app_init(display_data_t *display)
         goto error;
     }
 
-    /* ...start VIN interface */
-    if (vin_start(app->vin) < 0)
+    /* ...start VIN interface (or recording replay) */
+    if ((app->replay ? replay_start(app->replay) : vin_start(app->vin)) < 0)
     {
-        TRACE(ERROR, _x("failed to start VIN: %m"));
+        TRACE(ERROR, _x("failed to start %s: %m"), (app->replay ? "replay" : "VIN"));
         goto error;
     }
     
@@ -758,3 +810,27 @@ error:
 
     return NULL;
 }
+
+/* ...application shutdown (main loop terminated) */
+void app_exit(app_data_t *app)
+{
+    /* ...stop cameras or replay first (capture callbacks acquire application lock) */
+    if (app->vin)
+    {
+        vin_destroy(app->vin, NULL), app->vin = NULL;
+    }
+
+    if (app->replay)
+    {
+        replay_destroy(app->replay), app->replay = NULL;
+    }
+
+    pthread_mutex_lock(&app->lock);
+
+    /* ...close surround-view engine */
+    (app->imr_sv ? imr_sview_close(app->imr_sv), 0 : 0);
+
+    pthread_mutex_unlock(&app->lock);
+
+    TRACE(INIT, _b("application closed"));
+}
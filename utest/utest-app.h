@@ -89,6 +89,25 @@ extern int  __vin_width, __vin_height;
 /* ...number of buffers to allocate */
 extern int  __vin_buffers_num;
 
+/* ...cameras frames synchronization window (ms) */
+extern int  __sync_window;
+
+/* ...pending frames limit of latest-frame-wins mode (0 - disabled) */
+extern int  __latest_depth;
+
+/* ...per-camera dispatch mode (engines start on frame arrival) */
+extern int  __camera_dispatch;
+
+/* ...camera stall timeout in ms (0 - watchdog disabled) */
+extern int  __stall_timeout;
+
+/* ...recording file names and replay rate (replaces VIN capturing if set) */
+extern char * replay_file_name[];
+extern int  __replay_files, __replay_rate;
+
+/* ...capture recording files prefix (recorder is disabled if not set) */
+extern char * __record_prefix;
+
 /* ...output buffer dimensions */
 extern int  __vsp_width, __vsp_height;
 
@@ -114,4 +133,7 @@ extern app_data_t * app_init(display_data_t *display);
 /* ...main application thread */
 extern void * app_thread(void *arg);
 
+/* ...application shutdown */
+extern void app_exit(app_data_t *app);
+
 #endif  /* __UTEST_APP_H */
@@ -0,0 +1,879 @@
+/*******************************************************************************
+ * utest-car.c
+ *
+ * IMR unit test application - car images cache
+ *
+ * Copyright (c) 2016 Cogent Embedded Inc. ALL RIGHTS RESERVED.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#define MODULE_TAG                      CAR
+
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+
+#include "utest-common.h"
+#include "utest-car.h"
+#include "utest-png.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*******************************************************************************
+ * Tracing configuration
+ ******************************************************************************/
+
+TRACE_TAG(INIT, 1);
+TRACE_TAG(INFO, 1);
+TRACE_TAG(DEBUG, 0);
+
+/*******************************************************************************
+ * Local types definitions
+ ******************************************************************************/
+
+/* ...number of background decoding threads */
+#define CAR_CACHE_THREADS               2
+
+/* ...atlas file signature ("CATL") and format version */
+#define CAR_ATLAS_MAGIC                 0x4C544143
+#define CAR_ATLAS_VERSION               2
+
+/* ...atlas file header (followed by index table and compressed sprites) */
+struct car_atlas_file
+{
+    u32                     magic, version;
+    u32                     w, h;
+    u32                     steps[3];
+};
+
+/* ...atlas index entry (size is zero for a missing sprite) */
+struct car_atlas_entry
+{
+    u32                     offset, size;
+
+    /* ...sprite bounding box within the image (x0, y0, x1, y1) */
+    s32                     bbox[4];
+};
+
+/* ...decoded car image */
+typedef struct car_image
+{
+    /* ...cache key (packed step triple) */
+    u32                     key;
+
+    /* ...image state (0 - decoding, 1 - ready, -1 - failed) */
+    int                     state;
+
+    /* ...number of users (image is not evicted while in use) */
+    int                     refs;
+
+    /* ...position in LRU queue (ready images only) */
+    GList                   link;
+
+    /* ...ARGB pixel data of a sprite (packed rows of a bounding box) */
+    void                   *data;
+
+    /* ...sprite bounding box within the image (x0, y0, x1, y1) */
+    int                     bbox[4];
+
+    /* ...size of pixel data */
+    u32                     size;
+
+}   car_image_t;
+
+/* ...car images cache */
+struct car_cache
+{
+    /* ...image dimensions */
+    int                     w, h;
+
+    /* ...image file name prefix */
+    char                   *prefix;
+
+    /* ...mapped sprites atlas (optional) */
+    const u8               *atlas;
+
+    /* ...size of mapped atlas */
+    size_t                  atlas_size;
+
+    /* ...memory budget and current usage */
+    u32                     limit, size;
+
+    /* ...maximal size of a sprite */
+    u32                     max;
+
+    /* ...images indexed by key */
+    GHashTable             *table;
+
+    /* ...ready images, most recently used first */
+    GQueue                  lru;
+
+    /* ...image of the displayed view (pinned) */
+    car_image_t            *current;
+
+    /* ...pending prefetch requests (most wanted first) */
+    u32                     request[CAR_PREFETCH_MAX];
+
+    /* ...number of pending prefetch requests */
+    int                     requests;
+
+    /* ...termination flag */
+    int                     exit;
+
+    /* ...internal data protection lock */
+    pthread_mutex_t         lock;
+
+    /* ...prefetch request / decoding completion conditions */
+    pthread_cond_t          wait, done;
+
+    /* ...decoding threads */
+    pthread_t               thread[CAR_CACHE_THREADS];
+};
+
+/*******************************************************************************
+ * LZ4 block codec
+ ******************************************************************************/
+
+/* ...match finder hash table size */
+#define LZ4_HASH_BITS                   12
+
+static inline u32 __lz4_read32(const u8 *p)
+{
+    u32     v;
+
+    return memcpy(&v, p, 4), v;
+}
+
+static inline u32 __lz4_hash(u32 v)
+{
+    return (v * 2654435761U) >> (32 - LZ4_HASH_BITS);
+}
+
+/* ...put extended length */
+static inline u8 * __lz4_length(u8 *p, int len)
+{
+    for (; len >= 255; len -= 255)  *p++ = 255;
+
+    return *p++ = (u8)len, p;
+}
+
+/* ...emit single sequence (match is absent for the last one) */
+static inline u8 * __lz4_sequence(u8 *p, const u8 *lit, int n, int offset, int len)
+{
+    u8     *token = p++;
+
+    *token = (u8)((n < 15 ? n : 15) << 4);
+    (n >= 15 ? p = __lz4_length(p, n - 15) : NULL);
+    memcpy(p, lit, n), p += n;
+
+    if (offset)
+    {
+        *p++ = (u8)offset, *p++ = (u8)(offset >> 8);
+        *token |= (u8)(len - 4 < 15 ? len - 4 : 15);
+        (len - 4 >= 15 ? p = __lz4_length(p, len - 4 - 15) : NULL);
+    }
+
+    return p;
+}
+
+/* ...greedy compression; destination must hold n + n / 255 + 16 bytes */
+static int __lz4_encode(u8 *dst, const u8 *src, int n)
+{
+    int         table[1 << LZ4_HASH_BITS];
+    const u8   *ip = src, *anchor = src, *end = src + n;
+    u8         *op = dst;
+
+    memset(table, 0xFF, sizeof(table));
+
+    /* ...matches must not start within last 12 bytes, last 5 bytes are literals */
+    while (ip + 12 < end)
+    {
+        u32         v = __lz4_read32(ip), h = __lz4_hash(v);
+        int         ref = table[h];
+        const u8   *m = src + (ref < 0 ? 0 : ref);
+        int         len;
+
+        table[h] = (int)(ip - src);
+
+        if (ref < 0 || ip - m > 65535 || __lz4_read32(m) != v)
+        {
+            ip++;
+            continue;
+        }
+
+        for (len = 4; ip + len < end - 5 && ip[len] == m[len]; len++)
+            ;
+
+        op = __lz4_sequence(op, anchor, (int)(ip - anchor), (int)(ip - m), len);
+        anchor = (ip += len);
+    }
+
+    op = __lz4_sequence(op, anchor, (int)(end - anchor), 0, 0);
+
+    return (int)(op - dst);
+}
+
+/* ...read extended length */
+static inline int __lz4_extend(const u8 **src, const u8 *end, int *len)
+{
+    const u8   *p = *src;
+
+    do
+    {
+        CHK_ERR(p < end, -(errno = EINVAL));
+        *len += *p;
+    }
+    while (*p++ == 255);
+
+    return *src = p, 0;
+}
+
+/* ...decompress block of exactly n bytes */
+static int __lz4_decode(u8 *dst, int n, const u8 *src, int size)
+{
+    const u8   *ip = src, *iend = src + size;
+    u8         *op = dst, *oend = dst + n;
+
+    while (ip < iend)
+    {
+        u32         token = *ip++;
+        int         len = token >> 4, offset, k;
+        const u8   *m;
+
+        /* ...literals */
+        if (len == 15)  CHK_API(__lz4_extend(&ip, iend, &len));
+        CHK_ERR(len <= iend - ip && len <= oend - op, -(errno = EINVAL));
+        memcpy(op, ip, len), op += len, ip += len;
+
+        /* ...last sequence has no match */
+        if (ip == iend)     break;
+
+        CHK_ERR(iend - ip >= 2, -(errno = EINVAL));
+        offset = ip[0] | (ip[1] << 8), ip += 2;
+        CHK_ERR(offset > 0 && offset <= op - dst, -(errno = EINVAL));
+
+        len = token & 15;
+        if (len == 15)  CHK_API(__lz4_extend(&ip, iend, &len));
+        CHK_ERR((len += 4) <= oend - op, -(errno = EINVAL));
+
+        /* ...copy periodic pattern with non-overlapping chunks doubling in size */
+        for (m = op - offset; len > 0; op += k, len -= k)
+        {
+            k = (int)(op - m), (k > len ? k = len : 0);
+            memcpy(op, m, k);
+        }
+    }
+
+    CHK_ERR(op == oend, -(errno = EINVAL));
+
+    return 0;
+}
+
+/*******************************************************************************
+ * Images management
+ ******************************************************************************/
+
+/* ...pack step triple into a cache key */
+static inline u32 __car_key(const int *step)
+{
+    BUG((u32)step[0] >= 1024 || (u32)step[1] >= 1024 || (u32)step[2] >= 1024, _x("invalid step: %d/%d/%d"), step[0], step[1], step[2]);
+
+    return (u32)step[0] | ((u32)step[1] << 10) | ((u32)step[2] << 20);
+}
+
+/* ...destroy image descriptor */
+static inline void __image_free(car_image_t *img)
+{
+    free(img->data);
+    free(img);
+}
+
+/* ...drop least recently used images exceeding memory budget (called with a lock held) */
+static void __cache_trim(car_cache_t *cache)
+{
+    GList      *link = cache->lru.tail;
+
+    while (cache->size > cache->limit && link)
+    {
+        car_image_t    *img = link->data;
+
+        /* ...advance to the next candidate before unlinking */
+        link = link->prev;
+
+        /* ...images being copied are not evicted */
+        if (img->refs)      continue;
+
+        TRACE(DEBUG, _b("evict image %08X"), img->key);
+
+        g_queue_unlink(&cache->lru, &img->link);
+        g_hash_table_remove(cache->table, GUINT_TO_POINTER(img->key));
+        cache->size -= img->size;
+        __image_free(img);
+    }
+}
+
+/* ...create image descriptor in decoding state (called with a lock held) */
+static car_image_t * __image_create(car_cache_t *cache, u32 key)
+{
+    car_image_t    *img;
+
+    CHK_ERR(img = calloc(1, sizeof(*img)), (errno = ENOMEM, NULL));
+
+    /* ...image is owned by decoding thread; memory is accounted once decoded */
+    img->key = key, img->refs = 1, img->link.data = img;
+    g_hash_table_insert(cache->table, GUINT_TO_POINTER(key), img);
+
+    return img;
+}
+
+/* ...crop image to non-transparent area in place; returns size of sprite */
+static u32 __image_crop(u8 *data, int w, int h, int *bbox)
+{
+    int     x0 = w, y0 = h, x1 = 0, y1 = 0;
+    int     x, y, n;
+    u8     *p;
+
+    /* ...find bounding box of pixels with non-zero alpha (BGRA byte order) */
+    for (y = 0, p = data + 3; y < h; y++)
+    {
+        for (x = 0; x < w; x++, p += 4)
+        {
+            if (*p == 0)    continue;
+
+            (x < x0 ? x0 = x : 0), (x >= x1 ? x1 = x + 1 : 0);
+            (y < y0 ? y0 = y : 0), y1 = y + 1;
+        }
+    }
+
+    /* ...fully transparent image is represented by single pixel */
+    (x0 >= x1 ? x0 = y0 = 0, x1 = y1 = 1, memset(data, 0, 4) : 0);
+
+    /* ...pack rows of a bounding box (destination never overtakes source) */
+    for (y = y0, n = (x1 - x0) * 4, p = data; y < y1; y++, p += n)
+    {
+        memmove(p, data + (y * w + x0) * 4, n);
+    }
+
+    bbox[0] = x0, bbox[1] = y0, bbox[2] = x1, bbox[3] = y1;
+
+    return (u32)(n * (y1 - y0));
+}
+
+/* ...find compressed sprite in the atlas */
+static const struct car_atlas_entry * __atlas_entry(car_cache_t *cache, u32 key)
+{
+    const struct car_atlas_file    *hdr = (const void *)cache->atlas;
+    const struct car_atlas_entry   *index = (const void *)(hdr + 1);
+    u32                             s0 = key & 0x3FF, s1 = (key >> 10) & 0x3FF, s2 = key >> 20;
+
+    if (s0 >= hdr->steps[0] || s1 >= hdr->steps[1] || s2 >= hdr->steps[2])     return NULL;
+
+    index += (s0 * hdr->steps[1] + s1) * hdr->steps[2] + s2;
+
+    return (index->size ? index : NULL);
+}
+
+/* ...decode image file (called without a lock) */
+static int __image_decode(car_cache_t *cache, car_image_t *img)
+{
+    char        name[PATH_MAX];
+    int         w = cache->w, h = cache->h;
+    int         format = GST_VIDEO_FORMAT_ARGB;
+    void       *data;
+    u32         t0, t1;
+
+    snprintf(name, sizeof(name), "%s-%u-%u-%u.png", cache->prefix, img->key & 0x3FF, (img->key >> 10) & 0x3FF, img->key >> 20);
+
+    t0 = __get_time_usec();
+
+    if (cache->atlas)
+    {
+        const struct car_atlas_entry   *e = __atlas_entry(cache, img->key);
+
+        /* ...sprite is stored cropped in native ARGB layout */
+        CHK_ERR(e, -(errno = ENOENT));
+        memcpy(img->bbox, e->bbox, sizeof(img->bbox));
+        img->size = (e->bbox[2] - e->bbox[0]) * (e->bbox[3] - e->bbox[1]) * 4;
+        CHK_ERR(img->data = malloc(img->size), -(errno = ENOMEM));
+        CHK_API(__lz4_decode(img->data, img->size, cache->atlas + e->offset, e->size));
+    }
+    else
+    {
+        /* ...decode full image and crop it to a sprite */
+        CHK_ERR(data = img->data = malloc(w * h * 4), -(errno = ENOMEM));
+        CHK_API(create_png(name, &w, &h, &format, &data));
+        img->size = __image_crop(img->data, w, h, img->bbox);
+        (data = realloc(img->data, img->size)) ? img->data = data : NULL;
+    }
+
+    t1 = __get_time_usec();
+
+    TRACE(DEBUG, _b("decoded '%s': (%d,%d)-(%d,%d) (time: %u)"), name, img->bbox[0], img->bbox[1], img->bbox[2], img->bbox[3], (u32)(t1 - t0));
+
+    return 0;
+}
+
+/* ...complete decoding (called with a lock held) */
+static void __image_ready(car_cache_t *cache, car_image_t *img, int r)
+{
+    if (r == 0)
+    {
+        /* ...put image into LRU queue and make room for it */
+        img->state = 1;
+        g_queue_push_head_link(&cache->lru, &img->link);
+        cache->size += img->size;
+        __cache_trim(cache);
+    }
+    else
+    {
+        /* ...remove failed image from the cache; it is destroyed by last user */
+        img->state = -1;
+        g_hash_table_remove(cache->table, GUINT_TO_POINTER(img->key));
+    }
+
+    /* ...wake up users waiting for the image */
+    pthread_cond_broadcast(&cache->done);
+}
+
+/* ...release image reference (called with a lock held) */
+static void __image_release(car_cache_t *cache, car_image_t *img)
+{
+    if (--img->refs == 0)
+    {
+        (img->state < 0 ? __image_free(img) : __cache_trim(cache));
+    }
+}
+
+/*******************************************************************************
+ * Prefetch threads
+ ******************************************************************************/
+
+/* ...background decoding thread */
+static void * car_prefetch_thread(void *arg)
+{
+    car_cache_t    *cache = arg;
+
+    thread_placement(THREAD_WORKER);
+
+    pthread_mutex_lock(&cache->lock);
+
+    while (!cache->exit)
+    {
+        car_image_t    *img;
+        u32             key;
+        int             r;
+
+        /* ...wait for a prefetch request */
+        if (cache->requests == 0)
+        {
+            pthread_cond_wait(&cache->wait, &cache->lock);
+            continue;
+        }
+
+        /* ...take most wanted image */
+        key = cache->request[0], cache->requests--;
+        memmove(cache->request, cache->request + 1, cache->requests * sizeof(u32));
+
+        /* ...skip images already present or being decoded */
+        if (g_hash_table_lookup(cache->table, GUINT_TO_POINTER(key)))  continue;
+
+        if ((img = __image_create(cache, key)) == NULL)
+        {
+            TRACE(ERROR, _x("prefetch of %08X failed: %m"), key);
+            continue;
+        }
+
+        pthread_mutex_unlock(&cache->lock);
+
+        r = __image_decode(cache, img);
+
+        pthread_mutex_lock(&cache->lock);
+
+        TRACE(DEBUG, _b("prefetched image %08X: %d"), key, r);
+
+        __image_ready(cache, img, r);
+        __image_release(cache, img);
+    }
+
+    pthread_mutex_unlock(&cache->lock);
+
+    return NULL;
+}
+
+/*******************************************************************************
+ * External API
+ ******************************************************************************/
+
+/* ...create cache of decoded ARGB images */
+car_cache_t * car_cache_create(int w, int h, const char *prefix, u32 limit)
+{
+    car_cache_t    *cache;
+    pthread_attr_t  attr;
+    int             i, r;
+
+    CHK_ERR(cache = calloc(1, sizeof(*cache)), (errno = ENOMEM, NULL));
+
+    cache->w = w, cache->h = h, cache->limit = limit, cache->max = w * h * 4;
+    cache->prefix = strdup(prefix);
+    cache->table = g_hash_table_new(NULL, NULL);
+    g_queue_init(&cache->lru);
+    pthread_mutex_init(&cache->lock, NULL);
+    pthread_cond_init(&cache->wait, NULL);
+    pthread_cond_init(&cache->done, NULL);
+
+    /* ...initialize thread attributes (joinable, 128KB stack) */
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    pthread_attr_setstacksize(&attr, 128 << 10);
+
+    /* ...create decoding threads */
+    for (i = 0, r = 0; i < CAR_CACHE_THREADS && r == 0; i++)
+    {
+        r = pthread_create(&cache->thread[i], &attr, car_prefetch_thread, cache);
+    }
+
+    pthread_attr_destroy(&attr);
+
+    if (r != 0)
+    {
+        TRACE(ERROR, _x("failed to create prefetch thread: %d"), r);
+        cache->exit = 1, i--;
+        pthread_cond_broadcast(&cache->wait);
+        while (i--)     pthread_join(cache->thread[i], NULL);
+        g_hash_table_destroy(cache->table);
+        free(cache->prefix), free(cache);
+        errno = r;
+        return NULL;
+    }
+
+    TRACE(INIT, _b("car images cache created: %d*%d, limit=%u KB"), w, h, limit >> 10);
+
+    return cache;
+}
+
+/* ...copy sprite of a view step into a buffer */
+int car_cache_load(car_cache_t *cache, const int *step, void *data, int *bbox)
+{
+    u32             key = __car_key(step);
+    car_image_t    *img;
+    int             r;
+
+    pthread_mutex_lock(&cache->lock);
+
+    if ((img = g_hash_table_lookup(cache->table, GUINT_TO_POINTER(key))) != NULL)
+    {
+        /* ...image is cached or being prefetched; wait for decoding completion */
+        img->refs++;
+
+        while (img->state == 0)
+        {
+            pthread_cond_wait(&cache->done, &cache->lock);
+        }
+
+        TRACE(INFO, _b("image %08X: cache hit"), key);
+    }
+    else
+    {
+        /* ...decode image synchronously */
+        CHK_ERR(img = __image_create(cache, key), (pthread_mutex_unlock(&cache->lock), -errno));
+
+        pthread_mutex_unlock(&cache->lock);
+
+        r = __image_decode(cache, img);
+
+        pthread_mutex_lock(&cache->lock);
+
+        __image_ready(cache, img, r);
+
+        TRACE(INFO, _b("image %08X: cache miss"), key);
+    }
+
+    if (img->state > 0)
+    {
+        /* ...mark image is most recently used */
+        g_queue_unlink(&cache->lru, &img->link);
+        g_queue_push_head_link(&cache->lru, &img->link);
+
+        /* ...copy pixels without holding a lock (image is pinned) */
+        pthread_mutex_unlock(&cache->lock);
+        memcpy(data, img->data, img->size);
+        memcpy(bbox, img->bbox, sizeof(img->bbox));
+        pthread_mutex_lock(&cache->lock);
+        r = 0;
+
+        /* ...keep displayed image pinned; prefetching never evicts it */
+        if (cache->current != img)
+        {
+            img->refs++;
+
+            if (cache->current)
+            {
+                __image_release(cache, cache->current);
+            }
+
+            cache->current = img;
+        }
+    }
+    else
+    {
+        r = -(errno = ENOENT);
+    }
+
+    __image_release(cache, img);
+
+    pthread_mutex_unlock(&cache->lock);
+
+    return r;
+}
+
+/* ...attach sprites atlas (replaces PNG files) */
+int car_cache_atlas(car_cache_t *cache, const char *path)
+{
+    const struct car_atlas_file    *hdr;
+    const struct car_atlas_entry   *index;
+    struct stat                     st;
+    void                           *p;
+    u32                             i, n, max;
+    int                             fd;
+
+    CHK_ERR((fd = open(path, O_RDONLY)) >= 0, -errno);
+    CHK_ERR(fstat(fd, &st) == 0, (close(fd), -errno));
+    p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    CHK_ERR(p != MAP_FAILED, -errno);
+
+    /* ...validate header and index table */
+    hdr = p, index = (const void *)(hdr + 1);
+
+    if ((size_t)st.st_size < sizeof(*hdr) || hdr->magic != CAR_ATLAS_MAGIC || hdr->version != CAR_ATLAS_VERSION)
+    {
+        TRACE(ERROR, _x("invalid atlas '%s'"), path);
+        goto error;
+    }
+
+    if ((int)hdr->w != cache->w || (int)hdr->h != cache->h || hdr->steps[0] >= 1024 || hdr->steps[1] >= 1024 || hdr->steps[2] >= 1024)
+    {
+        TRACE(ERROR, _x("atlas '%s' mismatch: %u*%u (expected %d*%d)"), path, hdr->w, hdr->h, cache->w, cache->h);
+        goto error;
+    }
+
+    n = hdr->steps[0] * hdr->steps[1] * hdr->steps[2];
+
+    if ((size_t)st.st_size < sizeof(*hdr) + n * sizeof(*index))
+    {
+        TRACE(ERROR, _x("truncated atlas '%s'"), path);
+        goto error;
+    }
+
+    for (i = 0, max = 0; i < n; i++)
+    {
+        const s32  *b = index[i].bbox;
+
+        if ((size_t)index[i].offset + index[i].size > (size_t)st.st_size)
+        {
+            TRACE(ERROR, _x("corrupted atlas '%s': entry %u"), path, i);
+            goto error;
+        }
+
+        /* ...missing sprites are not checked */
+        if (index[i].size == 0)     continue;
+
+        if (b[0] < 0 || b[1] < 0 || b[2] > hdr->w || b[3] > hdr->h || b[0] >= b[2] || b[1] >= b[3])
+        {
+            TRACE(ERROR, _x("corrupted atlas '%s': entry %u"), path, i);
+            goto error;
+        }
+
+        (max < (u32)((b[2] - b[0]) * (b[3] - b[1]) * 4) ? max = (b[2] - b[0]) * (b[3] - b[1]) * 4 : 0);
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    cache->atlas = p, cache->atlas_size = st.st_size, cache->max = max;
+    pthread_mutex_unlock(&cache->lock);
+
+    TRACE(INIT, _b("atlas '%s' mapped: %u sprites, %zu KB"), path, n, (size_t)st.st_size >> 10);
+
+    return 0;
+
+error:
+    munmap(p, st.st_size);
+    return -(errno = EINVAL);
+}
+
+/* ...build sprites atlas from PNG files */
+int car_atlas_create(const char *path, const char *prefix, int w, int h, const int *steps)
+{
+    struct car_atlas_file   hdr = { CAR_ATLAS_MAGIC, CAR_ATLAS_VERSION, w, h, { steps[0], steps[1], steps[2] } };
+    struct car_atlas_entry *index;
+    char                    name[PATH_MAX], tmp[PATH_MAX];
+    u8                     *image, *buf;
+    u32                     offset;
+    int                     i, j, k, n = steps[0] * steps[1] * steps[2];
+    FILE                   *f = NULL;
+
+    CHK_ERR(index = calloc(n, sizeof(*index)), -(errno = ENOMEM));
+    image = malloc(w * h * 4), buf = malloc(w * h * 4 + (w * h * 4) / 255 + 16);
+    if (!image || !buf)
+    {
+        errno = ENOMEM;
+        goto error;
+    }
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    if ((f = fopen(tmp, "wb")) == NULL)
+    {
+        TRACE(ERROR, _x("failed to create '%s': %m"), tmp);
+        free(index), free(image), free(buf);
+        return -errno;
+    }
+
+    /* ...reserve space for header and index table */
+    offset = sizeof(hdr) + n * sizeof(*index);
+    if (fseek(f, offset, SEEK_SET) != 0)
+    {
+        TRACE(ERROR, _x("failed to write '%s': %m"), tmp);
+        goto error;
+    }
+
+    for (i = 0; i < steps[0]; i++)
+        for (j = 0; j < steps[1]; j++)
+            for (k = 0; k < steps[2]; k++)
+            {
+                struct car_atlas_entry *e = &index[(i * steps[1] + j) * steps[2] + k];
+                int                     W = w, H = h, format = GST_VIDEO_FORMAT_ARGB;
+                void                   *data = image;
+                int                     size;
+
+                snprintf(name, sizeof(name), "%s-%d-%d-%d.png", prefix, i, j, k);
+
+                /* ...missing images are allowed (not all views may be rendered) */
+                if (create_png(name, &W, &H, &format, &data) != 0)
+                {
+                    TRACE(INFO, _b("image '%s' skipped"), name);
+                    continue;
+                }
+
+                size = __lz4_encode(buf, image, __image_crop(image, w, h, e->bbox));
+
+                if (fwrite(buf, size, 1, f) != 1)
+                {
+                    TRACE(ERROR, _x("failed to write '%s': %m"), tmp);
+                    goto error;
+                }
+
+                e->offset = offset, e->size = size, offset += size;
+
+                TRACE(DEBUG, _b("sprite '%s': %d bytes"), name, size);
+            }
+
+    /* ...write header and index table; publish file atomically */
+    if (fseek(f, 0, SEEK_SET) != 0 || fwrite(&hdr, sizeof(hdr), 1, f) != 1 || fwrite(index, sizeof(*index), n, f) != (size_t)n || fclose(f) != 0)
+    {
+        TRACE(ERROR, _x("failed to write '%s': %m"), tmp);
+        f = NULL;
+        goto error;
+    }
+
+    f = NULL;
+
+    if (rename(tmp, path) != 0)
+    {
+        TRACE(ERROR, _x("failed to rename '%s': %m"), tmp);
+        goto error;
+    }
+
+    TRACE(INIT, _b("atlas '%s' created: %d sprites, %u KB"), path, n, offset >> 10);
+
+    free(index), free(image), free(buf);
+
+    return 0;
+
+error:
+    (f ? fclose(f) : 0), unlink(tmp);
+    free(index), free(image), free(buf);
+    return -(errno ? errno : EBADF);
+}
+
+/* ...maximal size of a sprite */
+u32 car_cache_max_size(car_cache_t *cache)
+{
+    return cache->max;
+}
+
+/* ...replace pending prefetch requests */
+void car_cache_prefetch(car_cache_t *cache, int (*step)[3], int n)
+{
+    int     m = (int)(cache->limit / cache->max) - 1;
+    int     i;
+
+    /* ...prefetched images must fit into the budget along with displayed one */
+    (n > CAR_PREFETCH_MAX ? n = CAR_PREFETCH_MAX : 0);
+    (n > m ? n = (m > 0 ? m : 0) : 0);
+
+    pthread_mutex_lock(&cache->lock);
+
+    /* ...stale requests are discarded; direction of motion has changed */
+    for (i = 0; i < n; i++)
+    {
+        cache->request[i] = __car_key(step[i]);
+    }
+
+    cache->requests = n;
+
+    pthread_cond_broadcast(&cache->wait);
+
+    pthread_mutex_unlock(&cache->lock);
+}
+
+/* ...destroy cache */
+void car_cache_destroy(car_cache_t *cache)
+{
+    GHashTableIter  iter;
+    gpointer        img;
+    int             i;
+
+    /* ...stop decoding threads */
+    pthread_mutex_lock(&cache->lock);
+    cache->exit = 1;
+    pthread_cond_broadcast(&cache->wait);
+    pthread_mutex_unlock(&cache->lock);
+
+    for (i = 0; i < CAR_CACHE_THREADS; i++)
+    {
+        pthread_join(cache->thread[i], NULL);
+    }
+
+    /* ...destroy images (no users exist) */
+    g_hash_table_iter_init(&iter, cache->table);
+    while (g_hash_table_iter_next(&iter, NULL, &img))
+    {
+        __image_free(img);
+    }
+
+    g_hash_table_destroy(cache->table);
+    (cache->atlas ? munmap((void *)cache->atlas, cache->atlas_size) : 0);
+    pthread_cond_destroy(&cache->done);
+    pthread_cond_destroy(&cache->wait);
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->prefix);
+    free(cache);
+}
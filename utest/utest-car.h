@@ -0,0 +1,65 @@
+/*******************************************************************************
+ * utest-car.h
+ *
+ * IMR unit test application - car images cache
+ *
+ * Copyright (c) 2016 Cogent Embedded Inc. ALL RIGHTS RESERVED.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#ifndef __UTEST_CAR_H
+#define __UTEST_CAR_H
+
+/*******************************************************************************
+ * Types definitions
+ ******************************************************************************/
+
+/* ...maximal number of pending prefetch requests */
+#define CAR_PREFETCH_MAX                8
+
+/* ...opaque type */
+typedef struct car_cache    car_cache_t;
+
+/*******************************************************************************
+ * External API
+ ******************************************************************************/
+
+/* ...create cache of ARGB sprites cropped to bounding box (limit is memory budget in bytes) */
+extern car_cache_t * car_cache_create(int w, int h, const char *prefix, u32 limit);
+
+/* ...attach sprites atlas (replaces PNG files) */
+extern int car_cache_atlas(car_cache_t *cache, const char *path);
+
+/* ...build sprites atlas from PNG files */
+extern int car_atlas_create(const char *path, const char *prefix, int w, int h, const int *steps);
+
+/* ...copy sprite of a view step into a buffer (decode if not cached) */
+extern int car_cache_load(car_cache_t *cache, const int *step, void *data, int *bbox);
+
+/* ...maximal size of a sprite (car plane allocation size) */
+extern u32 car_cache_max_size(car_cache_t *cache);
+
+/* ...replace pending prefetch requests (most wanted first) */
+extern void car_cache_prefetch(car_cache_t *cache, int (*step)[3], int n);
+
+/* ...destroy cache */
+extern void car_cache_destroy(car_cache_t *cache);
+
+#endif  /* __UTEST_CAR_H */
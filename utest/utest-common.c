@@ -67,6 +67,7 @@
  * Tracing configuration
  ******************************************************************************/
 
+TRACE_TAG(INIT, 1);
 TRACE_TAG(DEBUG, 0);
 
 /*******************************************************************************
@@ -361,6 +362,112 @@ int timer_source_is_active(timer_source_t *tsrc)
     return (tsrc->tag != NULL);
 }
 
+/*******************************************************************************
+ * Threads placement
+ ******************************************************************************/
+
+/* ...placement of a thread role */
+typedef struct thread_placement
+{
+    /* ...SCHED_FIFO priority (0 - default policy) */
+    int                 prio;
+
+    /* ...CPU mask (0 - default affinity) */
+    u32                 cpus;
+
+}   thread_placement_t;
+
+/* ...roles names */
+static const char * __thread_role_name[THREAD_ROLES] = {
+    "input", "imr", "mesh", "car", "loop", "display", "render", "worker", "reactor",
+};
+
+/* ...configured placement of roles */
+static thread_placement_t   __thread_placement[THREAD_ROLES];
+
+/* ...cores dedicated to completion threads (0 - no isolation) */
+static u32                  __thread_isolated;
+
+/* ...set role placement */
+int thread_placement_set(const char *role, int prio, u32 cpus)
+{
+    int     i;
+
+    for (i = 0; i < THREAD_ROLES && strcmp(role, __thread_role_name[i]); i++)
+        ;
+
+    CHK_ERR(i < THREAD_ROLES && prio >= 0 && prio <= 99, -(errno = EINVAL));
+
+    __thread_placement[i].prio = prio, __thread_placement[i].cpus = cpus;
+
+    return 0;
+}
+
+/* ...dedicate cores to completion threads (input, IMR and reactor) */
+void thread_placement_isolate(u32 cpus)
+{
+    __thread_isolated = cpus;
+}
+
+/* ...apply placement to a calling thread and report effective one */
+void thread_placement(int role)
+{
+    thread_placement_t *p = &__thread_placement[role];
+    const char         *name = __thread_role_name[role];
+    struct sched_param  param;
+    cpu_set_t           set;
+    u32                 cpus = p->cpus;
+    int                 policy, i, r;
+
+    /* ...roles without explicit mask are split between isolated and other available cores */
+    if (!cpus && __thread_isolated)
+    {
+        pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+
+        for (i = 0; i < 32; i++)
+        {
+            (CPU_ISSET(i, &set) ? cpus |= 1U << i : 0);
+        }
+
+        cpus = (role == THREAD_INPUT || role == THREAD_IMR || role == THREAD_REACTOR ? __thread_isolated : cpus & ~__thread_isolated);
+    }
+
+    if (p->prio)
+    {
+        param.sched_priority = p->prio;
+        if ((r = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param)) != 0)
+        {
+            TRACE(ERROR, _x("thread '%s': failed to set priority %d: %s"), name, p->prio, strerror(r));
+        }
+    }
+
+    if (cpus)
+    {
+        CPU_ZERO(&set);
+        for (i = 0; i < 32; i++)
+        {
+            (cpus & (1U << i) ? CPU_SET(i, &set) : 0);
+        }
+
+        if ((r = pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) != 0)
+        {
+            TRACE(ERROR, _x("thread '%s': failed to set affinity %X: %s"), name, cpus, strerror(r));
+        }
+    }
+
+    /* ...report effective placement */
+    pthread_getschedparam(pthread_self(), &policy, &param);
+    pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+
+    for (i = 0, cpus = 0; i < 32; i++)
+    {
+        (CPU_ISSET(i, &set) ? cpus |= 1U << i : 0);
+    }
+
+    TRACE(INIT, _b("thread '%s' (tid=%d): %s/%d, cpus=%X"), name, (int)gettid(),
+          (policy == SCHED_FIFO ? "fifo" : (policy == SCHED_RR ? "rr" : "other")), param.sched_priority, cpus);
+}
+
 /*******************************************************************************
  * Tracing facility
  ******************************************************************************/
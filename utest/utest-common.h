@@ -274,6 +274,18 @@ static inline u32 __get_time_usec(void)
 /* ...total number of cameras */
 #define CAMERAS_NUMBER          4
 
+/* ...pipeline threads roles */
+#define THREAD_INPUT            0
+#define THREAD_IMR              1
+#define THREAD_MESH             2
+#define THREAD_CAR              3
+#define THREAD_LOOP             4
+#define THREAD_DISPLAY          5
+#define THREAD_RENDER           6
+#define THREAD_WORKER           7
+#define THREAD_REACTOR          8
+#define THREAD_ROLES            9
+
 /*******************************************************************************
  * Forward types declarations
  ******************************************************************************/
@@ -300,6 +312,11 @@ extern void timer_source_start(timer_source_t *tsrc, u32 interval, u32 period);
 extern void timer_source_stop(timer_source_t *tsrc);
 extern int timer_source_is_active(timer_source_t *tsrc);
 
+/* ...threads placement (SCHED_FIFO priority and CPU affinity per role) */
+extern int thread_placement_set(const char *role, int prio, u32 cpus);
+extern void thread_placement_isolate(u32 cpus);
+extern void thread_placement(int role);
+
 /*******************************************************************************
  * Camera support
  ******************************************************************************/
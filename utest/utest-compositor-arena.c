@@ -0,0 +1,259 @@
+/*******************************************************************************
+ * utest-compositor-arena.c
+ *
+ * IMR unit test application - compositor memory arena
+ *
+ * Copyright (c) 2016 Cogent Embedded Inc. ALL RIGHTS RESERVED.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#define MODULE_TAG                      VSP
+
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+
+#include "utest-common.h"
+#include "utest-compositor.h"
+#include "utest-compositor-arena.h"
+
+/*******************************************************************************
+ * Tracing configuration
+ ******************************************************************************/
+
+TRACE_TAG(INIT, 1);
+TRACE_TAG(INFO, 1);
+TRACE_TAG(DEBUG, 0);
+
+/*******************************************************************************
+ * Local types definitions
+ ******************************************************************************/
+
+/* ...memory arena (single block hosting all buffers) */
+struct vsp_arena
+{
+    /* ...backing block */
+    vsp_mem_t          *mem;
+
+    /* ...DMA buffer representing the whole block */
+    vsp_dmabuf_t       *dmabuf;
+
+    /* ...allocation watermark */
+    u32                 top;
+
+    /* ...number of chunks carved from the arena */
+    int                 users;
+
+    /* ...arena is detached and is destroyed along with the last chunk */
+    int                 released;
+
+    /* ...access lock */
+    pthread_mutex_t     lock;
+};
+
+/* ...alignment of arena chunks (each chunk can still be exported on its own) */
+#define VSP_ARENA_ALIGN                 4096
+
+/* ...active arena (NULL - each buffer is a separate block) */
+static vsp_arena_t     *__vsp_arena;
+
+/*******************************************************************************
+ * Internal compositor API
+ ******************************************************************************/
+
+/* ...release arena memory */
+static void __vsp_arena_release(vsp_arena_t *arena)
+{
+    /* ...close DMA file-descriptor of the block */
+    if (arena->dmabuf)
+    {
+        vsp_dmabuf_unexport(arena->dmabuf);
+    }
+
+    TRACE(INIT, _b("memory arena destroyed (%p)"), vsp_mem_ptr(arena->mem));
+
+    vsp_arena_ops.free(arena->mem);
+    pthread_mutex_destroy(&arena->lock);
+    free(arena);
+}
+
+/* ...reserve a chunk of active arena (NULL - separate block shall be allocated) */
+vsp_arena_t * vsp_arena_reserve(u32 *size, u32 *base)
+{
+    vsp_arena_t    *arena = __vsp_arena;
+    u32             n;
+
+    if (!arena)     return NULL;
+
+    /* ...chunks are aligned to keep engines and exporter happy */
+    n = (*size + VSP_ARENA_ALIGN - 1) & ~(VSP_ARENA_ALIGN - 1);
+
+    pthread_mutex_lock(&arena->lock);
+
+    /* ...exhausted arena falls back to separate blocks */
+    if (n > vsp_mem_size(arena->mem) - arena->top)
+    {
+        pthread_mutex_unlock(&arena->lock);
+        TRACE(WARNING, _b("memory arena exhausted (%u bytes requested, %u used)"), n, vsp_arena_usage(arena));
+        return NULL;
+    }
+
+    *base = arena->top, *size = n;
+    arena->top += n, arena->users++;
+
+    pthread_mutex_unlock(&arena->lock);
+
+    TRACE(DEBUG, _b("carved %u bytes from arena at %u"), n, *base);
+
+    return arena;
+}
+
+/* ...return a chunk to the arena (detached arena is destroyed along with the last chunk) */
+void vsp_arena_unreserve(vsp_arena_t *arena, u32 base, u32 size)
+{
+    int     last;
+
+    pthread_mutex_lock(&arena->lock);
+
+    /* ...topmost chunk is reused (error paths release buffers in reverse order) */
+    (base + size == arena->top ? arena->top = base : 0);
+
+    /* ...detached arena is destroyed along with the last chunk */
+    last = (--arena->users == 0 && arena->released);
+
+    pthread_mutex_unlock(&arena->lock);
+
+    TRACE(DEBUG, _b("returned %u bytes at %u to arena"), size, base);
+
+    if (last)
+    {
+        __vsp_arena_release(arena);
+    }
+}
+
+/* ...backing block of the arena */
+vsp_mem_t * vsp_arena_block(vsp_arena_t *arena)
+{
+    return arena->mem;
+}
+
+/* ...export planes of a chunk as offsets within the whole block (planes array is set once) */
+int vsp_arena_export(vsp_arena_t *arena, u32 base, u32 length, vsp_dmabuf_t ***planes, int n, u32 *size, int *dmafd, u32 *offset)
+{
+    vsp_dmabuf_t   *dmabuf;
+    u32             o;
+    int             i;
+
+    /* ...sanity check */
+    for (i = 0, o = 0; i < n; o += size[i++])
+        ;
+
+    CHK_ERR(o <= length, -(errno = EINVAL));
+
+    /* ...block is exported once */
+    pthread_mutex_lock(&arena->lock);
+    if ((dmabuf = arena->dmabuf) == NULL)
+    {
+        dmabuf = arena->dmabuf = vsp_dmabuf_export(arena->mem, 0, vsp_mem_size(arena->mem));
+    }
+    pthread_mutex_unlock(&arena->lock);
+
+    CHK_ERR(dmabuf, -errno);
+
+    /* ...all planes reference the same DMA buffer */
+    if (!*planes)
+    {
+        CHK_ERR(*planes = calloc(n, sizeof(vsp_dmabuf_t *)), -(errno = ENOMEM));
+
+        for (i = 0; i < n; i++)
+        {
+            (*planes)[i] = dmabuf;
+        }
+    }
+
+    for (i = 0, o = base; i < n; o += size[i++])
+    {
+        dmafd[i] = vsp_dmabuf_fd(dmabuf);
+        offset[i] = o;
+        TRACE(DEBUG, _b("plane-%d: fd=%d, offset=%X, size=%u"), i, dmafd[i], offset[i], size[i]);
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * Public API
+ ******************************************************************************/
+
+/* ...create memory arena (subsequent allocations are carved from it) */
+vsp_arena_t * vsp_arena_create(u32 size)
+{
+    vsp_arena_t    *arena;
+
+    /* ...only one arena can be active */
+    CHK_ERR(!__vsp_arena, (errno = EBUSY, NULL));
+
+    /* ...allocate arena descriptor */
+    CHK_ERR(arena = calloc(1, sizeof(*arena)), (errno = ENOMEM, NULL));
+
+    /* ...allocate single backing block */
+    if ((arena->mem = vsp_arena_ops.alloc(size)) == NULL)
+    {
+        TRACE(ERROR, _x("failed to allocate memory arena (%u bytes)"), size);
+        free(arena);
+        return NULL;
+    }
+
+    pthread_mutex_init(&arena->lock, NULL);
+
+    TRACE(INIT, _b("memory arena created: %u bytes (%p)"), vsp_mem_size(arena->mem), vsp_mem_ptr(arena->mem));
+
+    return (__vsp_arena = arena);
+}
+
+/* ...amount of memory carved from the arena */
+u32 vsp_arena_usage(vsp_arena_t *arena)
+{
+    u32     top;
+
+    pthread_mutex_lock(&arena->lock);
+    top = arena->top;
+    pthread_mutex_unlock(&arena->lock);
+
+    return top;
+}
+
+/* ...detach arena (memory is released along with the last chunk) */
+void vsp_arena_destroy(vsp_arena_t *arena)
+{
+    int     last;
+
+    /* ...subsequent allocations use separate blocks */
+    (__vsp_arena == arena ? __vsp_arena = NULL : 0);
+
+    pthread_mutex_lock(&arena->lock);
+    arena->released = 1, last = (arena->users == 0);
+    pthread_mutex_unlock(&arena->lock);
+
+    if (last)
+    {
+        __vsp_arena_release(arena);
+    }
+}
@@ -0,0 +1,64 @@
+/*******************************************************************************
+ * utest-compositor-arena.h
+ *
+ * IMR unit test application - compositor memory arena
+ *
+ * Copyright (c) 2016 Cogent Embedded Inc. ALL RIGHTS RESERVED.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#ifndef __UTEST_COMPOSITOR_ARENA_H
+#define __UTEST_COMPOSITOR_ARENA_H
+
+/*******************************************************************************
+ * Backing store hooks
+ ******************************************************************************/
+
+/* ...single block hosting all chunks of the arena (mmngr or memory file) */
+typedef struct vsp_arena_ops
+{
+    /* ...allocate backing block */
+    vsp_mem_t *       (*alloc)(u32 size);
+
+    /* ...release backing block */
+    void              (*free)(vsp_mem_t *mem);
+
+}   vsp_arena_ops_t;
+
+/* ...backing store of compositor backend */
+extern const vsp_arena_ops_t    vsp_arena_ops;
+
+/*******************************************************************************
+ * Internal compositor API
+ ******************************************************************************/
+
+/* ...reserve a chunk of active arena (NULL - separate block shall be allocated) */
+extern vsp_arena_t * vsp_arena_reserve(u32 *size, u32 *base);
+
+/* ...return a chunk to the arena (detached arena is destroyed along with the last chunk) */
+extern void vsp_arena_unreserve(vsp_arena_t *arena, u32 base, u32 size);
+
+/* ...backing block of the arena */
+extern vsp_mem_t * vsp_arena_block(vsp_arena_t *arena);
+
+/* ...export planes of a chunk as offsets within the whole block (planes array is set once) */
+extern int vsp_arena_export(vsp_arena_t *arena, u32 base, u32 length, vsp_dmabuf_t ***planes, int n, u32 *size, int *dmafd, u32 *offset);
+
+#endif  /* __UTEST_COMPOSITOR_ARENA_H */
@@ -0,0 +1,185 @@
+/*******************************************************************************
+ * utest-compositor-ring.c
+ *
+ * IMR unit test application - compositor jobs completion reporting
+ *
+ * Copyright (c) 2016 Cogent Embedded Inc. ALL RIGHTS RESERVED.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#define MODULE_TAG                      VSP
+
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+
+#include "utest-common.h"
+#include "utest-compositor.h"
+#include "utest-reactor.h"
+#include "utest-compositor-ring.h"
+#include <sys/eventfd.h>
+
+/*******************************************************************************
+ * Tracing configuration
+ ******************************************************************************/
+
+TRACE_TAG(INIT, 1);
+TRACE_TAG(INFO, 1);
+TRACE_TAG(DEBUG, 0);
+
+/*******************************************************************************
+ * Completions reporting
+ ******************************************************************************/
+
+/* ...report completed jobs in submission order (called with a lock held) */
+static void __vsp_ring_report(vsp_ring_t *ring)
+{
+    vsp_status_t   *status;
+
+    /* ...another thread is reporting completed jobs; it will pick up new ones */
+    if (ring->reporting)    return;
+
+    ring->reporting = 1;
+
+    /* ...notify application on completion of the oldest jobs */
+    while (ring->tail != ring->head && (status = &ring->job[ring->tail % ring->jobs])->result <= 0)
+    {
+        void   *priv = status->priv;
+        int     r = (int)status->result;
+
+        /* ...job context may be reused by a job submitted from the callback */
+        ring->tail++;
+
+        pthread_mutex_unlock(ring->lock);
+        ring->cb(ring->cdata, priv, r);
+        pthread_mutex_lock(ring->lock);
+    }
+
+    ring->reporting = 0;
+}
+
+/* ...report completed upscaling job (called with a lock held) */
+static void __vsp_ring_scale_report(vsp_ring_t *ring)
+{
+    if (ring->scale_pending && ring->scale.result <= 0)
+    {
+        ring->scale_pending = 0;
+        pthread_mutex_unlock(ring->lock);
+        ring->scale_cb(ring->cdata, ring->scale.priv, (int)ring->scale.result);
+        pthread_mutex_lock(ring->lock);
+    }
+}
+
+/* ...reactor event processing hook */
+static int __vsp_ring_hook(void *cdata, int id, u32 events)
+{
+    vsp_ring_t     *ring = cdata;
+    eventfd_t       v;
+
+    /* ...clear signal and report all completed jobs */
+    eventfd_read(ring->evfd, &v);
+
+    pthread_mutex_lock(ring->lock);
+    __vsp_ring_report(ring);
+    __vsp_ring_scale_report(ring);
+    pthread_mutex_unlock(ring->lock);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * Internal compositor API
+ ******************************************************************************/
+
+/* ...get status of the next job (NULL if all jobs are in flight; called with a lock held) */
+vsp_status_t * vsp_ring_next(vsp_ring_t *ring)
+{
+    return (ring->head - ring->tail < (u32)ring->jobs ? &ring->job[ring->head % ring->jobs] : NULL);
+}
+
+/* ...mark job as completed (called with a lock held) */
+void vsp_ring_complete(vsp_ring_t *ring, vsp_status_t *status, long result)
+{
+    status->result = result;
+
+    /* ...completions are reported by reactor thread or right here */
+    (ring->reactor ? eventfd_write(ring->evfd, 1) : (__vsp_ring_report(ring), 0));
+}
+
+/* ...mark upscaling job as started (EBUSY if another one is in flight; called with a lock held) */
+int vsp_ring_scale_start(vsp_ring_t *ring, void *priv)
+{
+    CHK_ERR(!ring->scale_pending, -(errno = EBUSY));
+
+    ring->scale_pending = 1, ring->scale.result = 1, ring->scale.priv = priv;
+
+    return 0;
+}
+
+/* ...mark upscaling job as completed (called with a lock held) */
+void vsp_ring_scale_complete(vsp_ring_t *ring, long result)
+{
+    ring->scale.result = result;
+
+    /* ...completion is reported by reactor thread or right here */
+    (ring->reactor ? eventfd_write(ring->evfd, 1) : (__vsp_ring_scale_report(ring), 0));
+}
+
+/* ...jobs ring initialization (completions are reported by shared reactor if any) */
+int vsp_ring_init(vsp_ring_t *ring, int jobs, pthread_mutex_t *lock, vsp_callback_t cb, void *cdata)
+{
+    CHK_ERR(jobs > 0 && jobs <= VSP_JOBS_MAX, -(errno = EINVAL));
+
+    ring->jobs = jobs, ring->lock = lock;
+    ring->cb = cb, ring->cdata = cdata;
+    ring->head = ring->tail = 0;
+    ring->evfd = -1;
+
+    /* ...completions may be reported by shared reactor instead of processing threads */
+    if ((ring->reactor = reactor_get()) != NULL)
+    {
+        ring->source.hook = __vsp_ring_hook, ring->source.cdata = ring, ring->source.id = 0;
+
+        if ((ring->evfd = eventfd(0, EFD_NONBLOCK)) < 0 || reactor_poll(ring->reactor, ring->evfd, &ring->source, 1) < 0)
+        {
+            TRACE(ERROR, _x("failed to create completions signalling: %m"));
+            (ring->evfd >= 0 ? close(ring->evfd) : 0);
+            ring->reactor = NULL, ring->evfd = -1;
+            return -errno;
+        }
+    }
+
+    return 0;
+}
+
+/* ...jobs ring destruction (called without a lock held) */
+void vsp_ring_destroy(vsp_ring_t *ring)
+{
+    /* ...stop servicing completions signalling descriptor */
+    if (ring->reactor)
+    {
+        reactor_poll(ring->reactor, ring->evfd, &ring->source, 0);
+
+        /* ...hook may still be running on an event retrieved earlier */
+        reactor_sync(ring->reactor);
+        close(ring->evfd);
+        ring->reactor = NULL, ring->evfd = -1;
+    }
+}
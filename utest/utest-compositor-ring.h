@@ -0,0 +1,105 @@
+/*******************************************************************************
+ * utest-compositor-ring.h
+ *
+ * IMR unit test application - compositor jobs completion reporting
+ *
+ * Copyright (c) 2016 Cogent Embedded Inc. ALL RIGHTS RESERVED.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#ifndef __UTEST_COMPOSITOR_RING_H
+#define __UTEST_COMPOSITOR_RING_H
+
+/*******************************************************************************
+ * Types definitions
+ ******************************************************************************/
+
+/* ...job completion status */
+typedef struct vsp_status
+{
+    /* ...client data passed to completion callback */
+    void                   *priv;
+
+    /* ...job status (positive while job is in progress) */
+    long                    result;
+
+}   vsp_status_t;
+
+/* ...jobs ring shared by compositor backends (protected by compositor lock) */
+typedef struct vsp_ring
+{
+    /* ...status of jobs in flight (indexed by submission counter) */
+    vsp_status_t            job[VSP_JOBS_MAX];
+
+    /* ...number of job contexts */
+    int                     jobs;
+
+    /* ...submitted / reported jobs counters */
+    u32                     head, tail;
+
+    /* ...completion reporting is in progress */
+    int                     reporting;
+
+    /* ...jobs completion callback and client data */
+    vsp_callback_t          cb;
+    void                   *cdata;
+
+    /* ...upscaling job status and completion callback */
+    vsp_status_t            scale;
+    vsp_callback_t          scale_cb;
+
+    /* ...upscaling job completion is not yet reported */
+    int                     scale_pending;
+
+    /* ...compositor lock */
+    pthread_mutex_t        *lock;
+
+    /* ...shared reactor reporting completions (optional) */
+    reactor_t              *reactor;
+
+    /* ...completions signalling descriptor and its reactor source */
+    int                     evfd;
+    reactor_source_t        source;
+
+}   vsp_ring_t;
+
+/*******************************************************************************
+ * Internal compositor API
+ ******************************************************************************/
+
+/* ...jobs ring initialization (completions are reported by shared reactor if any) */
+extern int vsp_ring_init(vsp_ring_t *ring, int jobs, pthread_mutex_t *lock, vsp_callback_t cb, void *cdata);
+
+/* ...jobs ring destruction */
+extern void vsp_ring_destroy(vsp_ring_t *ring);
+
+/* ...get status of the next job (NULL if all jobs are in flight; called with a lock held) */
+extern vsp_status_t * vsp_ring_next(vsp_ring_t *ring);
+
+/* ...mark job as completed (called with a lock held) */
+extern void vsp_ring_complete(vsp_ring_t *ring, vsp_status_t *status, long result);
+
+/* ...mark upscaling job as started (EBUSY if another one is in flight; called with a lock held) */
+extern int vsp_ring_scale_start(vsp_ring_t *ring, void *priv);
+
+/* ...mark upscaling job as completed (called with a lock held) */
+extern void vsp_ring_scale_complete(vsp_ring_t *ring, long result);
+
+#endif  /* __UTEST_COMPOSITOR_RING_H */
@@ -0,0 +1,1434 @@
+/*******************************************************************************
+ * utest-compositor-sw.c
+ *
+ * Software (CPU) VSP compositor for IMR-based surround-view application
+ *
+ * Copyright (c) 2016 Cogent Embedded Inc. ALL RIGHTS RESERVED.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#define MODULE_TAG                      VSP
+
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+
+#include "utest-common.h"
+#include "utest-compositor.h"
+#include "utest-reactor.h"
+#include "utest-compositor-ring.h"
+#include "utest-compositor-arena.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <linux/videodev2.h>
+#include <linux/udmabuf.h>
+
+/*******************************************************************************
+ * Tracing configuration
+ ******************************************************************************/
+
+TRACE_TAG(INIT, 1);
+TRACE_TAG(INFO, 1);
+TRACE_TAG(DEBUG, 0);
+
+/*******************************************************************************
+ * Local constants definitions
+ ******************************************************************************/
+
+/* ...maximal number of compositing threads */
+#define VSP_SW_THREADS_MAX              8
+
+/* ...number of output rows processed by a thread at once */
+#define VSP_SW_BAND_ROWS                32
+
+/* ...number of pixels processed by a SIMD kernel iteration */
+#define VSP_SW_LANES                    8
+
+/*******************************************************************************
+ * Local types definitions
+ ******************************************************************************/
+
+/* ...compositor job (one per job in flight) */
+typedef struct vsp_job
+{
+    /* ...camera planes (NULL if layer is disabled) and associated alpha-planes */
+    vsp_mem_t              *camera[2], *alpha[2];
+
+    /* ...car sprite plane and its bounding box within car image */
+    vsp_mem_t              *car;
+    int                     car_bbox[4];
+
+    /* ...destination plane */
+    vsp_mem_t              *output;
+
+    /* ...next band to process and number of processed bands */
+    int                     band, done;
+
+}   vsp_job_t;
+
+/* ...source layer placement (centered with cropping) */
+typedef struct vsp_layer
+{
+    /* ...source origin of visible area */
+    int                     sx, sy;
+
+    /* ...destination origin of visible area */
+    int                     dx, dy;
+
+    /* ...visible area dimensions */
+    int                     w, h;
+
+}   vsp_layer_t;
+
+typedef struct vsp_compositor
+{
+    /* ...job contexts */
+    vsp_job_t               job[VSP_JOBS_MAX];
+
+    /* ...jobs ring (status of jobs in flight and completions reporting) */
+    vsp_ring_t              ring;
+
+    /* ...jobs ring access lock */
+    pthread_mutex_t         lock;
+
+    /* ...worker threads wake-up condition */
+    pthread_cond_t          wait;
+
+    /* ...worker threads */
+    pthread_t               thread[VSP_SW_THREADS_MAX];
+
+    /* ...number of worker threads */
+    int                     threads;
+
+    /* ...rows buffers of worker threads (accumulator and unpacked source) and their stride */
+    u16                    *rows;
+    int                     stride;
+
+    /* ...number of workers that took their rows buffers */
+    int                     workers;
+
+    /* ...worker threads termination flag */
+    int                     exit;
+
+    /* ...camera planes dimensions and format */
+    int                     w, h;
+    u32                     format;
+
+    /* ...output plane dimensions and format */
+    int                     W, H;
+    u32                     ofmt;
+
+    /* ...number of row bands of the output plane */
+    int                     bands;
+
+    /* ...camera planes placement */
+    vsp_layer_t             camera;
+
+    /* ...car image origin on the screen */
+    int                     car_pos[2];
+
+    /* ...background color (virtual layer) */
+    u32                     color;
+
+    /* ...alpha-planes upscaler (optional) */
+    struct vsp_scaler      *scl;
+
+}   vsp_compositor_t;
+
+/* ...alpha-plane upscaler */
+typedef struct vsp_scaler
+{
+    /* ...source / destination dimensions */
+    int                     w, h, W, H;
+
+    /* ...planes of the job waiting for a worker */
+    vsp_mem_t              *input, *output;
+
+}   vsp_scaler_t;
+
+/* ...DMA buffer descriptor */
+struct vsp_dmabuf
+{
+    /* ...DMA file-descriptor (udmabuf referencing memory file pages) */
+    int                 fd;
+};
+
+/* ...memory descriptor (memory file stands in for contiguous memory) */
+struct vsp_mem
+{
+    /* ...memory file-descriptor */
+    int                 fd;
+
+    /* ...user-accessible pointer */
+    void               *data;
+
+    /* ...size of a chunk */
+    unsigned long       size;
+
+    /* ...exported DMA buffers */
+    vsp_dmabuf_t      **dmabuf;
+
+    /* ...planes offsets */
+    u32                 offset[3];
+
+    /* ...arena the chunk is carved from (NULL - separate block) */
+    vsp_arena_t        *arena;
+
+    /* ...offset of the chunk within the arena */
+    u32                 base;
+};
+
+/* ...udmabuf device descriptor (negative - device is not available) */
+static int              __vsp_udmabuf = -1;
+
+/*******************************************************************************
+ * Memory allocation
+ ******************************************************************************/
+
+/* ...allocate separate memory block */
+static vsp_mem_t * __vsp_mem_alloc(u32 size)
+{
+    vsp_mem_t      *mem;
+
+    /* ...allocate memory descriptor */
+    CHK_ERR(mem = calloc(1, sizeof(*mem)), (errno = ENOMEM, NULL));
+
+    /* ...all chunks must be page-size aligned */
+    size = (size + 4095) & ~4095;
+
+    /* ...create anonymous memory file (udmabuf requires it to be sealed against shrinking) */
+    if ((mem->fd = memfd_create("vsp-mem", MFD_CLOEXEC | MFD_ALLOW_SEALING)) < 0)
+    {
+        TRACE(ERROR, _x("failed to create memory file: %m"));
+        goto error;
+    }
+
+    if (ftruncate(mem->fd, size) < 0 || fcntl(mem->fd, F_ADD_SEALS, F_SEAL_SHRINK) < 0)
+    {
+        TRACE(ERROR, _x("failed to allocate memory block (%u bytes): %m"), size);
+        goto error_fd;
+    }
+
+    if ((mem->data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, mem->fd, 0)) == MAP_FAILED)
+    {
+        TRACE(ERROR, _x("failed to map memory block (%u bytes): %m"), size);
+        goto error_fd;
+    }
+
+    mem->size = size;
+
+    TRACE(DEBUG, _b("allocated %p[%u] (fd=%d)"), mem->data, size, mem->fd);
+
+    return mem;
+
+error_fd:
+    close(mem->fd);
+
+error:
+    free(mem);
+    errno = ENOMEM;
+    return NULL;
+}
+
+/* ...destroy separate memory block */
+static void __vsp_mem_free(vsp_mem_t *mem)
+{
+    munmap(mem->data, mem->size);
+    close(mem->fd);
+
+    TRACE(DEBUG, _b("destroyed block %p"), mem->data);
+
+    free(mem);
+}
+
+/* ...allocate memory block */
+vsp_mem_t * vsp_mem_alloc(u32 size)
+{
+    vsp_arena_t    *arena;
+    vsp_mem_t      *mem, *block;
+    u32             base;
+
+    /* ...carve a chunk from the active arena if possible */
+    if ((arena = vsp_arena_reserve(&size, &base)) == NULL)
+    {
+        return __vsp_mem_alloc(size);
+    }
+
+    /* ...allocate memory descriptor */
+    if ((mem = calloc(1, sizeof(*mem))) == NULL)
+    {
+        vsp_arena_unreserve(arena, base, size);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    /* ...chunk shares memory file of the arena */
+    block = vsp_arena_block(arena);
+    mem->fd = block->fd;
+    mem->data = (u8 *)block->data + base;
+    mem->size = size;
+    mem->arena = arena;
+    mem->base = base;
+
+    TRACE(DEBUG, _b("carved %p[%u] from arena at %u"), mem->data, size, base);
+
+    return mem;
+}
+
+/* ...destroy memory block */
+void vsp_mem_free(vsp_mem_t *mem)
+{
+    vsp_arena_t    *arena = mem->arena;
+    u32             base = mem->base, size = mem->size;
+
+    if (!arena)
+    {
+        __vsp_mem_free(mem);
+        return;
+    }
+
+    TRACE(DEBUG, _b("returned %p[%u] to arena"), vsp_mem_ptr(mem), size);
+
+    /* ...planes descriptors reference the arena DMA buffer */
+    free(mem->dmabuf);
+    free(mem);
+
+    vsp_arena_unreserve(arena, base, size);
+}
+
+/* ...arena backing store */
+const vsp_arena_ops_t   vsp_arena_ops = {
+    .alloc = __vsp_mem_alloc,
+    .free = __vsp_mem_free,
+};
+
+/* ...memory buffer accessor */
+void * vsp_mem_ptr(vsp_mem_t *mem)
+{
+    return mem->data;
+}
+
+/* ...memory size */
+u32 vsp_mem_size(vsp_mem_t *mem)
+{
+    return mem->size;
+}
+
+/* ...open udmabuf device once */
+static void __vsp_udmabuf_open(void)
+{
+    if ((__vsp_udmabuf = open("/dev/udmabuf", O_RDWR | O_CLOEXEC)) < 0)
+    {
+        TRACE(ERROR, _x("udmabuf device is not available (DMA-buffers cannot be exported): %m"));
+    }
+}
+
+/* ...export DMA file-descriptor representing memory block (offset is passed by the user) */
+vsp_dmabuf_t * vsp_dmabuf_export(vsp_mem_t *mem, u32 offset, u32 size)
+{
+    static pthread_once_t   once = PTHREAD_ONCE_INIT;
+    struct udmabuf_create   create;
+    vsp_dmabuf_t           *dmabuf;
+
+    /* ...sanity check (arena chunks are exported through the arena block by vsp_buffer_export) */
+    CHK_ERR(offset + size <= mem->size && !mem->arena, (errno = EINVAL, NULL));
+
+    /* ...memory file pages are turned into DMA-buffer by udmabuf driver */
+    pthread_once(&once, __vsp_udmabuf_open);
+    CHK_ERR(__vsp_udmabuf >= 0, (errno = ENODEV, NULL));
+
+    /* ...allocate DMA-buffer descriptor */
+    CHK_ERR(dmabuf = malloc(sizeof(*dmabuf)), (errno = ENOMEM, NULL));
+
+    /* ...DMA-buffer covers the whole memory file; planes are addressed by offsets within it */
+    memset(&create, 0, sizeof(create));
+    create.memfd = mem->fd;
+    create.flags = UDMABUF_FLAGS_CLOEXEC;
+    create.offset = 0;
+    create.size = mem->size;
+
+    if ((dmabuf->fd = ioctl(__vsp_udmabuf, UDMABUF_CREATE, &create)) < 0)
+    {
+        TRACE(ERROR, _x("failed to export DMA-fd: %m"));
+        free(dmabuf);
+        return NULL;
+    }
+
+    TRACE(DEBUG, _b("exported block %p (fd=%d): offset=%u, size=%u"), mem->data, dmabuf->fd, offset, size);
+
+    return dmabuf;
+}
+
+/* ...DMA-buffer descriptor accessor */
+int vsp_dmabuf_fd(vsp_dmabuf_t *dmabuf)
+{
+    return dmabuf->fd;
+}
+
+/* ...close DMA file-descriptor */
+void vsp_dmabuf_unexport(vsp_dmabuf_t *dmabuf)
+{
+    close(dmabuf->fd);
+    free(dmabuf);
+}
+
+/* ...determine planes parameters for a given format */
+static inline int __vsp_pixfmt_planes(int w, int h, u32 fmt, u32 *size, u32 *stride)
+{
+    int     N = w * h;
+
+    switch(fmt)
+    {
+    case V4L2_PIX_FMT_GREY:
+        return size[0] = N, stride[0] = w, 1;
+    case V4L2_PIX_FMT_UYVY:
+    case V4L2_PIX_FMT_YUYV:
+    case V4L2_PIX_FMT_RGB565:
+        return size[0] = N * 2, stride[0] = w * 2, 1;
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_NV21:
+        return size[0] = N, size[1] = N >> 1, stride[0] = stride[1] = w, 2;
+    case V4L2_PIX_FMT_NV16:
+    case V4L2_PIX_FMT_NV61:
+        return size[0] = size[1] = N, stride[0] = stride[1] = w, 2;
+    case V4L2_PIX_FMT_ARGB32:
+    case V4L2_PIX_FMT_XRGB32:
+        return size[0] = N * 4, stride[0] = w * 4, 1;
+    case V4L2_PIX_FMT_YUV420:
+        return size[0] = N, size[1] = size[2] = N >> 2, stride[0] = w, stride[1] = stride[2] = w >> 1, 3;
+    default:
+        return TRACE(ERROR, _b("unrecognized format: %X: %c%c%c%c"), fmt, __v4l2_fmt(fmt)), 0;
+    }
+}
+
+/* ...allocate memory buffer pool */
+int vsp_allocate_buffers(int w, int h, u32 fmt, vsp_mem_t **output, int num)
+{
+    u32     size;
+    int     i, n;
+    u32     psize[3], stride[3], offset[3];
+
+    /* ...calculate buffer properties */
+    if ((n = __vsp_pixfmt_planes(w, h, fmt, psize, stride)) == 0)
+    {
+        TRACE(ERROR, _x("invalid format '%c%c%c%c'"), __v4l2_fmt(fmt));
+        return -(errno = EINVAL);
+    }
+
+    /* ...set offsets of the planes */
+    for (offset[0] = 0, size = psize[0], i = 1; i < n; i++)
+    {
+        offset[i] = offset[i - 1] + psize[i - 1], size += psize[i];
+    }
+    
+    /* ...allocate memory descriptors */
+    for (i = 0; i < num; i++)
+    {
+        if ((output[i] = vsp_mem_alloc(size)) == NULL)
+        {
+            TRACE(ERROR, _x("failed to allocate buffer pool"));
+            goto error;
+        }
+
+        /* ...set planes offsets */
+        memcpy(output[i]->offset, offset, sizeof(u32) * n);
+        
+        TRACE(DEBUG, _b("allocate buffer: fmt=%c%c%c%c, size=%u"), __v4l2_fmt(fmt), size);
+    }
+    
+    return 0;
+
+error:
+    /* ...destroy buffers allocated */
+    while (i--)
+    {
+        vsp_mem_free(output[i]), output[i] = NULL;
+    }
+
+    return -(errno = ENOMEM);
+}
+
+/* ...export DMA file-descriptors of memory buffer planes */
+int vsp_buffer_export(vsp_mem_t *mem, int w, int h, u32 fmt, int *dmafd, u32 *offset, u32 *stride)
+{
+    u32     size[GST_VIDEO_MAX_PLANES], o;
+    int     n;
+    int     i;
+
+    /* ...verify format */
+    CHK_ERR((n = __vsp_pixfmt_planes(w, h, fmt, size, stride)) > 0, -(errno = EINVAL));
+
+    /* ...planes of an arena chunk are addressed by offsets within a single exported block */
+    if (mem->arena)
+    {
+        return vsp_arena_export(mem->arena, mem->base, mem->size, &mem->dmabuf, n, size, dmafd, offset);
+    }
+
+    /* ...allocate dma-buffers array if needed */
+    if (!mem->dmabuf)
+    {
+        CHK_ERR(mem->dmabuf = calloc(n, sizeof(vsp_dmabuf_t *)), -(errno = ENOMEM));
+    }
+
+    /* ...all planes are in the same memory file; planes are addressed by offsets */
+    for (i = 0, o = 0; i < n; o += size[i++])
+    {
+        if (!mem->dmabuf[i] && (mem->dmabuf[i] = vsp_dmabuf_export(mem, o, size[i])) == NULL)
+        {
+            TRACE(ERROR, _x("failed to export DMA buffer: %m"));
+            goto error;
+        }
+
+        dmafd[i] = mem->dmabuf[i]->fd;
+        offset[i] = o;
+    }
+
+    TRACE(INFO, _b("exported memory (format=%c%c%c%c, %d planes)"), __v4l2_fmt(fmt), n);
+
+    return 0;
+
+error:    
+    /* ...destroy all buffers exported thus far */
+    while (i--)
+    {
+        vsp_dmabuf_unexport(mem->dmabuf[i]);
+    }
+
+    /* ...destroy DMA buffers descriptors */
+    free(mem->dmabuf), mem->dmabuf = NULL;
+    
+    return -errno;
+}
+
+/*******************************************************************************
+ * SIMD kernels (GCC vector extensions; SSE2 / NEON code is generated)
+ ******************************************************************************/
+
+/* ...SIMD kernels are enabled (scalar code is a reference implementation) */
+int     __vsp_sw_simd = 1;
+
+/* ...8 x 16-bit unsigned / signed lanes and 16 x 8-bit lanes */
+typedef u16 v8u16 __attribute__((vector_size(16)));
+typedef s16 v8s16 __attribute__((vector_size(16)));
+typedef u8  v16u8 __attribute__((vector_size(16)));
+
+/* ...byte selectors zero-extending into 16-bit lanes (16 - zero byte; lanes are little-endian) */
+static const v16u8  __m_lo8 = { 0, 16, 1, 16, 2, 16, 3, 16, 4, 16, 5, 16, 6, 16, 7, 16 };
+
+/* ...Y, U and V selectors of 4 packed YCbCr 4:2:2 pairs (UYVY, YUYV) */
+static const v16u8  __m_yuv422[2][3] = {
+    {
+        { 1, 16, 3, 16, 5, 16, 7, 16, 9, 16, 11, 16, 13, 16, 15, 16 },
+        { 0, 16, 0, 16, 4, 16, 4, 16, 8, 16, 8, 16, 12, 16, 12, 16 },
+        { 2, 16, 2, 16, 6, 16, 6, 16, 10, 16, 10, 16, 14, 16, 14, 16 },
+    },
+    {
+        { 0, 16, 2, 16, 4, 16, 6, 16, 8, 16, 10, 16, 12, 16, 14, 16 },
+        { 1, 16, 1, 16, 5, 16, 5, 16, 9, 16, 9, 16, 13, 16, 13, 16 },
+        { 3, 16, 3, 16, 7, 16, 7, 16, 11, 16, 11, 16, 15, 16, 15, 16 },
+    },
+};
+
+/* ...U and V selectors of 4 interleaved chroma pairs (NV16) */
+static const v16u8  __m_uv[2] = {
+    { 0, 16, 0, 16, 2, 16, 2, 16, 4, 16, 4, 16, 6, 16, 6, 16 },
+    { 1, 16, 1, 16, 3, 16, 3, 16, 5, 16, 5, 16, 7, 16, 7, 16 },
+};
+
+/* ...R, G, B and A bytes of 8 ARGB pixels (pair of vectors) gathered into low half */
+static const v16u8  __m_argb[4] = {
+    { 2, 6, 10, 14, 18, 22, 26, 30, 0, 0, 0, 0, 0, 0, 0, 0 },
+    { 1, 5, 9, 13, 17, 21, 25, 29, 0, 0, 0, 0, 0, 0, 0, 0 },
+    { 0, 4, 8, 12, 16, 20, 24, 28, 0, 0, 0, 0, 0, 0, 0, 0 },
+    { 3, 7, 11, 15, 19, 23, 27, 31, 0, 0, 0, 0, 0, 0, 0, 0 },
+};
+
+/* ...low bytes of 16-bit lanes of a pair of vectors interleaved */
+static const v16u8  __m_zip8 = { 0, 16, 2, 18, 4, 20, 6, 22, 8, 24, 10, 26, 12, 28, 14, 30 };
+
+/* ...low bytes of 16-bit lanes narrowed into low half */
+static const v16u8  __m_narrow = { 0, 2, 4, 6, 8, 10, 12, 14, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+/* ...number of leading pixels processed by SIMD kernels (the rest is done by scalar code) */
+static inline int __v_count(int n)
+{
+    return (__vsp_sw_simd ? n & ~(VSP_SW_LANES - 1) : 0);
+}
+
+/* ...unaligned vector load / store */
+static inline v8u16 __v_load(const u16 *p)
+{
+    v8u16   v;
+
+    return memcpy(&v, p, sizeof(v)), v;
+}
+
+static inline void __v_store(u16 *p, v8u16 v)
+{
+    memcpy(p, &v, sizeof(v));
+}
+
+/* ...load 16 bytes / 8 bytes (upper half is zero) */
+static inline v16u8 __v_load16(const u8 *p)
+{
+    v16u8   v;
+
+    return memcpy(&v, p, sizeof(v)), v;
+}
+
+static inline v16u8 __v_load8(const u8 *p)
+{
+    v16u8   v = { 0 };
+
+    return memcpy(&v, p, 8), v;
+}
+
+/* ...zero-extend selected bytes into 16-bit lanes */
+static inline v8s16 __v_widen(v16u8 v, v16u8 m)
+{
+    return (v8s16)__builtin_shuffle(v, (v16u8){ 0 }, m);
+}
+
+/* ...x / 255 with rounding (x must not exceed 255 * 255) */
+static inline v8u16 __v_div255(v8u16 x)
+{
+    return (x + 1 + (x >> 8)) >> 8;
+}
+
+static inline u16 __div255(u32 x)
+{
+    return (x + 1 + (x >> 8)) >> 8;
+}
+
+/* ...saturate lanes to 8-bit range (blending unit output is 8-bit per channel) */
+static inline v8u16 __v_sat255(v8u16 x)
+{
+    v8u16   m = (v8u16)(x > 255);
+
+    return (x & ~m) | (m & 255);
+}
+
+static inline u16 __sat255(u32 x)
+{
+    return (x > 255 ? 255 : x);
+}
+
+/* ...clamp signed lanes to 8-bit range */
+static inline v8s16 __v_clamp(v8s16 x)
+{
+    v8s16   m = (v8s16)(x > 255);
+
+    x &= ~(v8s16)(x < 0);
+
+    return (x & ~m) | (m & 255);
+}
+
+static inline u16 __clamp(int v)
+{
+    return (v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+/* ...camera layers blending: sum of alpha-weighted colors (pixels are premultiplied) */
+static void __blend_sum(u16 **acc, u16 **src, int n)
+{
+    u16    *r = acc[0], *g = acc[1], *b = acc[2], *a = acc[3];
+    u16    *sr = src[0], *sg = src[1], *sb = src[2], *sa = src[3];
+    int     i, m;
+
+    for (i = 0, m = __v_count(n); i < m; i += VSP_SW_LANES)
+    {
+        v8u16   va = __v_load(sa + i);
+
+        __v_store(r + i, __v_sat255(__v_load(r + i) + __v_div255(__v_load(sr + i) * va)));
+        __v_store(g + i, __v_sat255(__v_load(g + i) + __v_div255(__v_load(sg + i) * va)));
+        __v_store(b + i, __v_sat255(__v_load(b + i) + __v_div255(__v_load(sb + i) * va)));
+        __v_store(a + i, __v_sat255(__v_load(a + i) + va));
+    }
+
+    for (; i < n; i++)
+    {
+        r[i] = __sat255(r[i] + __div255(sr[i] * sa[i]));
+        g[i] = __sat255(g[i] + __div255(sg[i] * sa[i]));
+        b[i] = __sat255(b[i] + __div255(sb[i] * sa[i]));
+        a[i] = __sat255(a[i] + sa[i]);
+    }
+}
+
+/* ...car model blending: source-over with source alpha */
+static void __blend_over(u16 **acc, u16 **src, int n)
+{
+    u16    *r = acc[0], *g = acc[1], *b = acc[2], *a = acc[3];
+    u16    *sr = src[0], *sg = src[1], *sb = src[2], *sa = src[3];
+    int     i, m;
+
+    for (i = 0, m = __v_count(n); i < m; i += VSP_SW_LANES)
+    {
+        v8u16   va = __v_load(sa + i);
+        v8u16   vi = 255 - va;
+
+        __v_store(r + i, __v_div255(__v_load(sr + i) * va) + __v_div255(__v_load(r + i) * vi));
+        __v_store(g + i, __v_div255(__v_load(sg + i) * va) + __v_div255(__v_load(g + i) * vi));
+        __v_store(b + i, __v_div255(__v_load(sb + i) * va) + __v_div255(__v_load(b + i) * vi));
+        __v_store(a + i, va + __v_div255(__v_load(a + i) * vi));
+    }
+
+    for (; i < n; i++)
+    {
+        u32     t = 255 - sa[i];
+
+        r[i] = __div255(sr[i] * sa[i]) + __div255(r[i] * t);
+        g[i] = __div255(sg[i] * sa[i]) + __div255(g[i] * t);
+        b[i] = __div255(sb[i] * sa[i]) + __div255(b[i] * t);
+        a[i] = sa[i] + __div255(a[i] * t);
+    }
+}
+
+/* ...background blending: virtual layer under accumulated image (destination alpha) */
+static void __blend_background(u16 **acc, u32 color, int n)
+{
+    u16    *r = acc[0], *g = acc[1], *b = acc[2], *a = acc[3];
+    u16     cr = (color >> 16) & 0xFF, cg = (color >> 8) & 0xFF, cb = color & 0xFF;
+    int     i, m;
+
+    for (i = 0, m = __v_count(n); i < m; i += VSP_SW_LANES)
+    {
+        v8u16   vi = 255 - __v_load(a + i);
+
+        __v_store(r + i, __v_sat255(__v_load(r + i) + __v_div255(vi * cr)));
+        __v_store(g + i, __v_sat255(__v_load(g + i) + __v_div255(vi * cg)));
+        __v_store(b + i, __v_sat255(__v_load(b + i) + __v_div255(vi * cb)));
+    }
+
+    for (; i < n; i++)
+    {
+        u32     t = 255 - a[i];
+
+        r[i] = __sat255(r[i] + __div255(t * cr));
+        g[i] = __sat255(g[i] + __div255(t * cg));
+        b[i] = __sat255(b[i] + __div255(t * cb));
+    }
+}
+
+/*******************************************************************************
+ * Pixel formats conversion
+ ******************************************************************************/
+
+/* ...BT.601 full-range YCbCr to RGB coefficients (1.7 fixed-point; products fit 16-bit lanes) */
+#define CSC_RV                          179
+#define CSC_GU                          (-44)
+#define CSC_GV                          (-91)
+#define CSC_BU                          227
+
+/* ...BT.601 full-range RGB to YCbCr coefficients (1.7 fixed-point) */
+#define CSC_YR                          38
+#define CSC_YG                          75
+#define CSC_YB                          15
+#define CSC_UR                          (-22)
+#define CSC_UG                          (-42)
+#define CSC_UB                          64
+#define CSC_VR                          64
+#define CSC_VG                          (-54)
+#define CSC_VB                          (-10)
+
+/* ...convert single YCbCr pixel */
+static inline void __csc(u16 **dst, int i, int y, int u, int v)
+{
+    u -= 128, v -= 128;
+    dst[0][i] = __clamp(y + ((CSC_RV * v + 64) >> 7));
+    dst[1][i] = __clamp(y + ((CSC_GU * u + CSC_GV * v + 64) >> 7));
+    dst[2][i] = __clamp(y + ((CSC_BU * u + 64) >> 7));
+}
+
+/* ...convert 8 YCbCr pixels */
+static inline void __v_csc(u16 **dst, int i, v8s16 y, v8s16 u, v8s16 v)
+{
+    u -= 128, v -= 128;
+    __v_store(dst[0] + i, (v8u16)__v_clamp(y + ((CSC_RV * v + 64) >> 7)));
+    __v_store(dst[1] + i, (v8u16)__v_clamp(y + ((CSC_GU * u + CSC_GV * v + 64) >> 7)));
+    __v_store(dst[2] + i, (v8u16)__v_clamp(y + ((CSC_BU * u + 64) >> 7)));
+}
+
+/* ...unpack 8 ARGB pixels into c planar channels (R, G, B, A) */
+static inline void __v_unpack_argb(const u8 *p, int c, u16 **dst, int i)
+{
+    v16u8   lo = __v_load16(p), hi = __v_load16(p + 16);
+    int     k;
+
+    for (k = 0; k < c; k++)
+    {
+        __v_store(dst[k] + i, (v8u16)__v_widen(__builtin_shuffle(lo, hi, __m_argb[k]), __m_lo8));
+    }
+}
+
+/* ...unpack n pixels of a camera plane row starting from column x into planar RGB */
+static void __unpack_camera(vsp_compositor_t *vsp, vsp_mem_t *mem, int x, int y, int n, u16 **dst)
+{
+    const u8   *p = (const u8 *)mem->data + mem->offset[0];
+    const u8   *c;
+    int         w = vsp->w, i, k, m;
+
+    /* ...chroma pairs are aligned for SIMD kernels after odd leading pixel */
+    m = (x & 1) + __v_count(n - (x & 1));
+
+    switch (vsp->format)
+    {
+    case V4L2_PIX_FMT_UYVY:
+    case V4L2_PIX_FMT_YUYV:
+    {
+        /* ...U0 Y0 V0 Y1 or Y0 U0 Y1 V0 */
+        int             yuyv = (vsp->format == V4L2_PIX_FMT_YUYV);
+        const v16u8    *s = __m_yuv422[yuyv];
+
+        for (p += y * w * 2, i = 0; i < n; )
+        {
+            k = ((x + i) >> 1) << 2;
+
+            if (i < m && ((x + i) & 1) == 0)
+            {
+                v16u8   v = __v_load16(p + k);
+
+                __v_csc(dst, i, __v_widen(v, s[0]), __v_widen(v, s[1]), __v_widen(v, s[2]));
+                i += VSP_SW_LANES;
+            }
+            else if (yuyv)
+            {
+                __csc(dst, i, p[k + (((x + i) & 1) << 1)], p[k + 1], p[k + 3]);
+                i++;
+            }
+            else
+            {
+                __csc(dst, i, p[k + 1 + (((x + i) & 1) << 1)], p[k], p[k + 2]);
+                i++;
+            }
+        }
+        break;
+    }
+
+    case V4L2_PIX_FMT_NV16:
+        /* ...luma plane followed by interleaved UV plane of the same size */
+        c = (const u8 *)mem->data + mem->offset[1] + y * w, p += y * w;
+        for (i = 0; i < n; )
+        {
+            k = (x + i) & ~1;
+
+            if (i < m && ((x + i) & 1) == 0)
+            {
+                v16u8   v = __v_load8(c + k);
+
+                __v_csc(dst, i, __v_widen(__v_load8(p + x + i), __m_lo8), __v_widen(v, __m_uv[0]), __v_widen(v, __m_uv[1]));
+                i += VSP_SW_LANES;
+            }
+            else
+            {
+                __csc(dst, i, p[x + i], c[k], c[k + 1]);
+                i++;
+            }
+        }
+        break;
+
+    case V4L2_PIX_FMT_ARGB32:
+        /* ...B G R A (alpha is taken from the alpha-plane) */
+        for (p += (y * w + x) * 4, i = 0, m = __v_count(n); i < m; i += VSP_SW_LANES, p += 4 * VSP_SW_LANES)
+        {
+            __v_unpack_argb(p, 3, dst, i);
+        }
+
+        for (; i < n; i++, p += 4)
+        {
+            dst[0][i] = p[2], dst[1][i] = p[1], dst[2][i] = p[0];
+        }
+        break;
+    }
+}
+
+/* ...unpack n pixels of an alpha-plane row */
+static inline void __unpack_alpha(const u8 *p, int n, u16 *dst)
+{
+    int     i, m;
+
+    for (i = 0, m = __v_count(n); i < m; i += VSP_SW_LANES)
+    {
+        __v_store(dst + i, (v8u16)__v_widen(__v_load8(p + i), __m_lo8));
+    }
+
+    for (; i < n; i++)
+    {
+        dst[i] = p[i];
+    }
+}
+
+/* ...unpack n pixels of ARGB row into planar RGBA */
+static inline void __unpack_argb(const u8 *p, int n, u16 **dst)
+{
+    int     i, m;
+
+    for (i = 0, m = __v_count(n); i < m; i += VSP_SW_LANES, p += 4 * VSP_SW_LANES)
+    {
+        __v_unpack_argb(p, 4, dst, i);
+    }
+
+    for (; i < n; i++, p += 4)
+    {
+        dst[0][i] = p[2], dst[1][i] = p[1], dst[2][i] = p[0], dst[3][i] = p[3];
+    }
+}
+
+/* ...pack accumulated planar image into opaque ARGB row */
+static inline void __pack_argb(u16 **src, int n, u8 *p)
+{
+    int     i, m;
+
+    for (i = 0, m = __v_count(n); i < m; i += VSP_SW_LANES, p += 4 * VSP_SW_LANES)
+    {
+        v16u8   bg = __builtin_shuffle((v16u8)__v_load(src[2] + i), (v16u8)__v_load(src[1] + i), __m_zip8);
+        v16u8   ra = __builtin_shuffle((v16u8)__v_load(src[0] + i), (v16u8){ 0 } + 0xFF, __m_zip8);
+        v8u16   lo = __builtin_shuffle((v8u16)bg, (v8u16)ra, (v8u16){ 0, 8, 1, 9, 2, 10, 3, 11 });
+        v8u16   hi = __builtin_shuffle((v8u16)bg, (v8u16)ra, (v8u16){ 4, 12, 5, 13, 6, 14, 7, 15 });
+
+        memcpy(p, &lo, sizeof(lo)), memcpy(p + 16, &hi, sizeof(hi));
+    }
+
+    for (; i < n; i++, p += 4)
+    {
+        p[0] = src[2][i], p[1] = src[1][i], p[2] = src[0][i], p[3] = 0xFF;
+    }
+}
+
+/* ...pack accumulated planar image into RGB565 row */
+static inline void __pack_rgb565(u16 **src, int n, u16 *p)
+{
+    int     i, m;
+
+    for (i = 0, m = __v_count(n); i < m; i += VSP_SW_LANES)
+    {
+        __v_store(p + i, ((__v_load(src[0] + i) >> 3) << 11) | ((__v_load(src[1] + i) >> 2) << 5) | (__v_load(src[2] + i) >> 3));
+    }
+
+    for (; i < n; i++)
+    {
+        p[i] = ((src[0][i] >> 3) << 11) | ((src[1][i] >> 2) << 5) | (src[2][i] >> 3);
+    }
+}
+
+/* ...RGB to YCbCr conversion */
+static inline u8 __rgb_y(int r, int g, int b)
+{
+    return (u8)((CSC_YR * r + CSC_YG * g + CSC_YB * b + 64) >> 7);
+}
+
+static inline u8 __rgb_u(int r, int g, int b)
+{
+    return (u8)__clamp(((CSC_UR * r + CSC_UG * g + CSC_UB * b + 64) >> 7) + 128);
+}
+
+static inline u8 __rgb_v(int r, int g, int b)
+{
+    return (u8)__clamp(((CSC_VR * r + CSC_VG * g + CSC_VB * b + 64) >> 7) + 128);
+}
+
+/* ...pack a pair of pixels starting from i into Y0/Y1 and averaged chroma */
+static inline void __pack_yuv_pair(u16 **src, int i, u8 *y, u8 *c)
+{
+    int     r = (src[0][i] + src[0][i + 1] + 1) >> 1;
+    int     g = (src[1][i] + src[1][i + 1] + 1) >> 1;
+    int     b = (src[2][i] + src[2][i + 1] + 1) >> 1;
+
+    y[0] = __rgb_y(src[0][i], src[1][i], src[2][i]);
+    y[1] = __rgb_y(src[0][i + 1], src[1][i + 1], src[2][i + 1]);
+    (c ? c[0] = __rgb_u(r, g, b), c[1] = __rgb_v(r, g, b) : 0);
+}
+
+/* ...pack 8 pixels starting from i into luma lanes and chroma lanes (U and V of a pair alternate) */
+static inline void __v_pack_yuv(u16 **src, int i, v8u16 *y, v8u16 *c)
+{
+    static const v8u16  even = { 0, 0, 2, 2, 4, 4, 6, 6 }, odd = { 1, 1, 3, 3, 5, 5, 7, 7 };
+    v8u16   r = __v_load(src[0] + i), g = __v_load(src[1] + i), b = __v_load(src[2] + i);
+    v8s16   ra = (v8s16)((__builtin_shuffle(r, even) + __builtin_shuffle(r, odd) + 1) >> 1);
+    v8s16   ga = (v8s16)((__builtin_shuffle(g, even) + __builtin_shuffle(g, odd) + 1) >> 1);
+    v8s16   ba = (v8s16)((__builtin_shuffle(b, even) + __builtin_shuffle(b, odd) + 1) >> 1);
+    v8s16   u = __v_clamp(((CSC_UR * ra + CSC_UG * ga + CSC_UB * ba + 64) >> 7) + 128);
+    v8s16   v = __v_clamp(((CSC_VR * ra + CSC_VG * ga + CSC_VB * ba + 64) >> 7) + 128);
+
+    *y = (CSC_YR * r + CSC_YG * g + CSC_YB * b + 64) >> 7;
+    *c = (v8u16)__builtin_shuffle(u, v, (v8s16){ 0, 9, 2, 11, 4, 13, 6, 15 });
+}
+
+/* ...pack accumulated planar image into UYVY row (n is even) */
+static inline void __pack_uyvy(u16 **src, int n, u8 *p)
+{
+    int     i, m;
+    u8      y[2], c[2];
+
+    for (i = 0, m = __v_count(n); i < m; i += VSP_SW_LANES, p += 2 * VSP_SW_LANES)
+    {
+        v8u16   vy, vc;
+
+        __v_pack_yuv(src, i, &vy, &vc);
+        vc |= vy << 8;
+        memcpy(p, &vc, sizeof(vc));
+    }
+
+    for (; i < n; i += 2, p += 4)
+    {
+        __pack_yuv_pair(src, i, y, c);
+        p[0] = c[0], p[1] = y[0], p[2] = c[1], p[3] = y[1];
+    }
+}
+
+/* ...pack accumulated planar image into NV12 luma row and (optionally) chroma row (n is even) */
+static inline void __pack_nv12(u16 **src, int n, u8 *p, u8 *c)
+{
+    int     i, m;
+
+    for (i = 0, m = __v_count(n); i < m; i += VSP_SW_LANES)
+    {
+        v8u16   vy, vc;
+        v16u8   t;
+
+        __v_pack_yuv(src, i, &vy, &vc);
+        t = __builtin_shuffle((v16u8)vy, __m_narrow);
+        memcpy(p + i, &t, VSP_SW_LANES);
+
+        if (c)
+        {
+            t = __builtin_shuffle((v16u8)vc, __m_narrow);
+            memcpy(c + i, &t, VSP_SW_LANES);
+        }
+    }
+
+    for (; i < n; i += 2)
+    {
+        __pack_yuv_pair(src, i, p + i, (c ? c + i : NULL));
+    }
+}
+
+/* ...pack accumulated row y into output buffer */
+static void __pack_output(vsp_compositor_t *vsp, u16 **src, vsp_mem_t *mem, int y)
+{
+    u8     *p = (u8 *)mem->data + mem->offset[0];
+    int     W = vsp->W;
+
+    switch (vsp->ofmt)
+    {
+    case V4L2_PIX_FMT_ARGB32:
+        __pack_argb(src, W, p + y * W * 4);
+        break;
+
+    case V4L2_PIX_FMT_RGB565:
+        __pack_rgb565(src, W, (u16 *)(p + y * W * 2));
+        break;
+
+    case V4L2_PIX_FMT_UYVY:
+        __pack_uyvy(src, W, p + y * W * 2);
+        break;
+
+    case V4L2_PIX_FMT_NV12:
+        /* ...chroma is taken from even rows (vertical decimation) */
+        __pack_nv12(src, W, p + y * W, (y & 1 ? NULL : (u8 *)mem->data + mem->offset[1] + (y >> 1) * W));
+        break;
+    }
+}
+
+/*******************************************************************************
+ * Compositing
+ ******************************************************************************/
+
+/* ...calculate placement of a source centered on the screen (with cropping) */
+static inline void __layer_setup(vsp_layer_t *l, int x, int y, int w, int h, int W, int H)
+{
+    /* ...position of source origin on the screen */
+    l->sx = (x < 0 ? -x : 0), l->dx = (x < 0 ? 0 : x);
+    l->sy = (y < 0 ? -y : 0), l->dy = (y < 0 ? 0 : y);
+
+    /* ...visible area */
+    l->w = (w - l->sx < W - l->dx ? w - l->sx : W - l->dx);
+    l->h = (h - l->sy < H - l->dy ? h - l->sy : H - l->dy);
+    (l->w < 0 ? l->w = 0 : 0), (l->h < 0 ? l->h = 0 : 0);
+}
+
+/* ...process a band of output rows */
+static void __vsp_band_process(vsp_compositor_t *vsp, vsp_job_t *job, int band, u16 **acc, u16 **src)
+{
+    vsp_layer_t     car;
+    int             y0 = band * VSP_SW_BAND_ROWS;
+    int             y1 = (y0 + VSP_SW_BAND_ROWS < vsp->H ? y0 + VSP_SW_BAND_ROWS : vsp->H);
+    int             bw = job->car_bbox[2] - job->car_bbox[0];
+    int             bh = job->car_bbox[3] - job->car_bbox[1];
+    vsp_layer_t    *l = &vsp->camera;
+    int             y, k, i, n;
+
+    /* ...place car sprite on the screen */
+    __layer_setup(&car, vsp->car_pos[0] + job->car_bbox[0], vsp->car_pos[1] + job->car_bbox[1], bw, bh, vsp->W, vsp->H);
+
+    for (y = y0; y < y1; y++)
+    {
+        u16    *a[4];
+
+        /* ...reset accumulator (transparent black) */
+        for (k = 0; k < 4; k++)
+        {
+            memset(acc[k], 0, vsp->W * sizeof(u16));
+        }
+
+        /* ...camera planes blended with alpha-planes (sum of alpha-levels) */
+        for (k = 0; k < 2 && y >= l->dy && y < l->dy + l->h; k++)
+        {
+            const u8   *alpha;
+
+            if (!job->camera[k])    continue;
+
+            n = l->w;
+            alpha = (const u8 *)job->alpha[k]->data + (l->sy + y - l->dy) * vsp->w + l->sx;
+            __unpack_camera(vsp, job->camera[k], l->sx, l->sy + y - l->dy, n, src);
+            __unpack_alpha(alpha, n, src[3]);
+
+            for (i = 0; i < 4; i++)     a[i] = acc[i] + l->dx;
+            __blend_sum(a, src, n);
+        }
+
+        /* ...car model over the cameras */
+        if (y >= car.dy && y < car.dy + car.h && car.w > 0)
+        {
+            n = car.w;
+            __unpack_argb((const u8 *)job->car->data + ((car.sy + y - car.dy) * bw + car.sx) * 4, n, src);
+
+            for (i = 0; i < 4; i++)     a[i] = acc[i] + car.dx;
+            __blend_over(a, src, n);
+        }
+
+        /* ...background under everything */
+        __blend_background(acc, vsp->color, vsp->W);
+
+        /* ...convert into output format */
+        __pack_output(vsp, acc, job->output, y);
+    }
+}
+
+/* ...upscale alpha-plane (bilinear, 16.16 fixed-point; pixel centers are aligned) */
+static void __vsp_scale(vsp_scaler_t *scl, const u8 *s, u8 *d)
+{
+    s32             dx, dy, fy;
+    int             x, y;
+
+    dx = (scl->w << 16) / scl->W;
+    dy = (scl->h << 16) / scl->H;
+
+    for (y = 0, fy = (dy >> 1) - 0x8000; y < scl->H; y++, fy += dy)
+    {
+        u32         y0 = (fy < 0 ? 0 : fy) >> 16, wy = (fy < 0 ? 0 : (fy >> 8) & 0xFF);
+        const u8   *r0 = s + y0 * scl->w;
+        const u8   *r1 = (y0 + 1 < (u32)scl->h ? r0 + scl->w : r0);
+        s32         fx;
+
+        for (x = 0, fx = (dx >> 1) - 0x8000; x < scl->W; x++, fx += dx)
+        {
+            u32     x0 = (fx < 0 ? 0 : fx) >> 16, wx = (fx < 0 ? 0 : (fx >> 8) & 0xFF);
+            u32     x1 = (x0 + 1 < (u32)scl->w ? x0 + 1 : x0);
+            u32     t = r0[x0] * (256 - wx) + r0[x1] * wx;
+            u32     b = r1[x0] * (256 - wx) + r1[x1] * wx;
+
+            *d++ = (t * (256 - wy) + b * wy + (1 << 15)) >> 16;
+        }
+    }
+}
+
+/* ...compositing thread */
+static void * vsp_worker_thread(void *arg)
+{
+    vsp_compositor_t   *vsp = arg;
+    u16                *acc[4], *src[4];
+    u16                *rows;
+    int                 stride = vsp->stride;
+    int                 k;
+
+    thread_placement(THREAD_WORKER);
+
+    pthread_mutex_lock(&vsp->lock);
+
+    /* ...take rows buffers preallocated for a worker */
+    rows = vsp->rows + vsp->workers++ * 8 * stride;
+
+    for (k = 0; k < 4; k++)
+    {
+        acc[k] = rows + k * stride, src[k] = rows + (k + 4) * stride;
+    }
+
+    while (!vsp->exit)
+    {
+        vsp_job_t  *job = NULL;
+        u32         j;
+        int         b;
+
+        /* ...find oldest job with unprocessed bands */
+        for (j = vsp->ring.tail; j != vsp->ring.head; j++)
+        {
+            if (vsp->job[j % vsp->ring.jobs].band < vsp->bands)
+            {
+                job = &vsp->job[j % vsp->ring.jobs];
+                break;
+            }
+        }
+
+        /* ...upscaling job is taken by an idle worker */
+        if (!job && vsp->scl && vsp->scl->input)
+        {
+            vsp_scaler_t   *scl = vsp->scl;
+            vsp_mem_t      *input = scl->input;
+
+            scl->input = NULL;
+
+            pthread_mutex_unlock(&vsp->lock);
+
+            __vsp_scale(scl, input->data, scl->output->data);
+
+            pthread_mutex_lock(&vsp->lock);
+
+            TRACE(DEBUG, _b("scale job completed"));
+            vsp_ring_scale_complete(&vsp->ring, 0);
+            continue;
+        }
+
+        if (!job)
+        {
+            pthread_cond_wait(&vsp->wait, &vsp->lock);
+            continue;
+        }
+
+        b = job->band++;
+
+        pthread_mutex_unlock(&vsp->lock);
+
+        __vsp_band_process(vsp, job, b, acc, src);
+
+        pthread_mutex_lock(&vsp->lock);
+
+        /* ...complete job once all bands are processed */
+        if (++job->done == vsp->bands)
+        {
+            TRACE(DEBUG, _b("job #%u completed"), j);
+            vsp_ring_complete(&vsp->ring, &vsp->ring.job[job - vsp->job], 0);
+        }
+    }
+
+    pthread_mutex_unlock(&vsp->lock);
+
+    return NULL;
+}
+
+/* ...precompile jobs for all combinations of pool buffers (CPU jobs reference buffers directly) */
+int vsp_job_templates_init(vsp_compositor_t *vsp, vsp_mem_t **camera, int nc, vsp_mem_t **alpha, int na, vsp_mem_t **car, int ncar, vsp_mem_t **output, int no)
+{
+    CHK_ERR(nc > 0 && na > 0 && ncar > 0 && no > 0, -(errno = EINVAL));
+
+    return 0;
+}
+
+/* ...job submission (disabled camera plane has NULL input; called from a single thread at a time) */
+int vsp_job_submit(vsp_compositor_t *vsp, vsp_mem_t **input, vsp_mem_t *output, const int *car, void *priv)
+{
+    vsp_status_t   *status;
+    vsp_job_t      *job;
+
+    pthread_mutex_lock(&vsp->lock);
+
+    /* ...get free job context */
+    if ((status = vsp_ring_next(&vsp->ring)) == NULL)
+    {
+        pthread_mutex_unlock(&vsp->lock);
+        TRACE(ERROR, _x("all jobs are in flight"));
+        return -(errno = EBUSY);
+    }
+
+    job = &vsp->job[status - vsp->ring.job];
+
+    /* ...set input planes (car model is always present) */
+    job->camera[0] = input[0], job->alpha[0] = input[4];
+    job->camera[1] = input[2], job->alpha[1] = input[6];
+    job->car = input[8];
+    memcpy(job->car_bbox, car, sizeof(job->car_bbox));
+    job->output = output;
+    job->band = job->done = 0;
+    status->priv = priv, status->result = 1;
+
+    TRACE(DEBUG, _b("job #%u submitted (in flight: %u)"), vsp->ring.head, vsp->ring.head - vsp->ring.tail + 1);
+
+    /* ...pass job to compositing threads */
+    vsp->ring.head++;
+    pthread_cond_broadcast(&vsp->wait);
+
+    pthread_mutex_unlock(&vsp->lock);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * Alpha-planes upscaling
+ ******************************************************************************/
+
+/* ...upscale alpha-plane (single job in flight; completion is passed to scaler callback) */
+int vsp_alpha_scale(vsp_compositor_t *vsp, vsp_mem_t *input, vsp_mem_t *output, void *priv)
+{
+    vsp_scaler_t   *scl = vsp->scl;
+    int             r;
+
+    /* ...scaler must be configured */
+    CHK_ERR(scl, -(errno = EINVAL));
+
+    /* ...pass a job to the workers unless one is in progress */
+    pthread_mutex_lock(&vsp->lock);
+
+    if ((r = vsp_ring_scale_start(&vsp->ring, priv)) == 0)
+    {
+        scl->input = input, scl->output = output;
+        pthread_cond_signal(&vsp->wait);
+    }
+
+    pthread_mutex_unlock(&vsp->lock);
+
+    return r;
+}
+
+/* ...alpha-planes upscaler initialization (w*h GREY plane to W*H GREY plane) */
+int vsp_scaler_init(vsp_compositor_t *vsp, int w, int h, int W, int H, vsp_callback_t cb)
+{
+    vsp_scaler_t   *scl;
+
+    CHK_ERR(scl = calloc(1, sizeof(*scl)), -(errno = ENOMEM));
+
+    scl->w = w, scl->h = h, scl->W = W, scl->H = H;
+    vsp->scl = scl, vsp->ring.scale_cb = cb;
+
+    TRACE(INIT, _b("alpha-planes upscaler initialized: %d*%d -> %d*%d"), w, h, W, H);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * Entry points
+ ******************************************************************************/
+
+/* ...module initialization function (jobs - number of jobs in flight) */
+vsp_compositor_t * compositor_init(int w, int h, u32 ifmt, int W, int H, u32 ofmt, int cw, int ch, int jobs, vsp_callback_t cb, void *cdata)
+{
+    extern u32              __bg_color;
+    vsp_compositor_t       *vsp;
+    pthread_attr_t          attr;
+    int                     i, r;
+
+    /* ...verify supported formats */
+    CHK_ERR(ifmt == V4L2_PIX_FMT_UYVY || ifmt == V4L2_PIX_FMT_YUYV || ifmt == V4L2_PIX_FMT_NV16 || ifmt == V4L2_PIX_FMT_ARGB32, (errno = EINVAL, NULL));
+    CHK_ERR(ofmt == V4L2_PIX_FMT_ARGB32 || ofmt == V4L2_PIX_FMT_RGB565 || ofmt == V4L2_PIX_FMT_UYVY || ofmt == V4L2_PIX_FMT_NV12, (errno = EINVAL, NULL));
+
+    /* ...YCbCr output formats are horizontally (and, for NV12, vertically) subsampled */
+    CHK_ERR(ofmt == V4L2_PIX_FMT_ARGB32 || ofmt == V4L2_PIX_FMT_RGB565 || (W & 1) == 0, (errno = EINVAL, NULL));
+    CHK_ERR(ofmt != V4L2_PIX_FMT_NV12 || (H & 1) == 0, (errno = EINVAL, NULL));
+    CHK_ERR(jobs > 0 && jobs <= VSP_JOBS_MAX, (errno = EINVAL, NULL));
+
+    /* ...allocate compositor data */
+    CHK_ERR(vsp = calloc(1, sizeof(*vsp)), (errno = ENOMEM, NULL));
+
+    vsp->w = w, vsp->h = h, vsp->format = ifmt;
+    vsp->W = W, vsp->H = H, vsp->ofmt = ofmt;
+    vsp->bands = (H + VSP_SW_BAND_ROWS - 1) / VSP_SW_BAND_ROWS;
+    vsp->color = __bg_color;
+
+    /* ...camera planes fill w*h area; car image is centered within it (with cropping) */
+    __layer_setup(&vsp->camera, 0, 0, w, h, W, H);
+    vsp->car_pos[0] = (cw > w ? -((cw - w) >> 1) : (w - cw) >> 1);
+    vsp->car_pos[1] = (ch > h ? -((ch - h) >> 1) : (h - ch) >> 1);
+
+    pthread_mutex_init(&vsp->lock, NULL);
+    pthread_cond_init(&vsp->wait, NULL);
+
+    /* ...set jobs ring; completions may be reported by shared reactor instead of worker threads */
+    if (vsp_ring_init(&vsp->ring, jobs, &vsp->lock, cb, cdata) < 0)
+    {
+        compositor_destroy(vsp);
+        return NULL;
+    }
+
+    /* ...create compositing threads */
+    vsp->threads = sysconf(_SC_NPROCESSORS_ONLN);
+    (vsp->threads < 1 ? vsp->threads = 1 : (vsp->threads > VSP_SW_THREADS_MAX ? vsp->threads = VSP_SW_THREADS_MAX : 0));
+
+    /* ...allocate rows buffers of all workers (8 rows each) */
+    vsp->stride = (W + VSP_SW_LANES - 1) & ~(VSP_SW_LANES - 1);
+
+    if (posix_memalign((void **)&vsp->rows, 16, vsp->threads * 8 * vsp->stride * sizeof(u16)) != 0)
+    {
+        TRACE(ERROR, _x("failed to allocate rows buffers"));
+        vsp->rows = NULL, vsp->threads = 0;
+        compositor_destroy(vsp);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    /* ...initialize thread attributes (joinable, 128KB stack) */
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    pthread_attr_setstacksize(&attr, 128 << 10);
+
+    for (i = 0, r = 0; i < vsp->threads && r == 0; i++)
+    {
+        r = pthread_create(&vsp->thread[i], &attr, vsp_worker_thread, vsp);
+    }
+
+    pthread_attr_destroy(&attr);
+
+    if (r != 0)
+    {
+        TRACE(ERROR, _x("failed to create compositing thread: %d"), r);
+        vsp->threads = i - 1;
+        compositor_destroy(vsp);
+        errno = r;
+        return NULL;
+    }
+
+    TRACE(INIT, _b("CPU compositor initialized: %d*%d[%c%c%c%c] -> %d*%d[%c%c%c%c], %d jobs, %d threads"), w, h, __v4l2_fmt(ifmt), W, H, __v4l2_fmt(ofmt), jobs, vsp->threads);
+
+    return vsp;
+}
+
+/* ...module destruction */
+void compositor_destroy(vsp_compositor_t *vsp)
+{
+    int     i;
+
+    /* ...stop compositing threads (jobs in flight are not reported) */
+    pthread_mutex_lock(&vsp->lock);
+    vsp->exit = 1;
+    pthread_cond_broadcast(&vsp->wait);
+    pthread_mutex_unlock(&vsp->lock);
+
+    for (i = 0; i < vsp->threads; i++)
+    {
+        pthread_join(vsp->thread[i], NULL);
+    }
+
+    /* ...stop servicing completions signalling descriptor */
+    vsp_ring_destroy(&vsp->ring);
+
+    pthread_cond_destroy(&vsp->wait);
+    pthread_mutex_destroy(&vsp->lock);
+    free(vsp->rows);
+    free(vsp->scl);
+    free(vsp);
+}
@@ -0,0 +1,436 @@
+/*******************************************************************************
+ * utest-compositor-test.c
+ *
+ * IMR unit test application - software compositor quality test
+ *
+ * Copyright (c) 2016 Cogent Embedded Inc. ALL RIGHTS RESERVED.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#define MODULE_TAG                      TEST
+
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+
+#include "utest-common.h"
+#include "utest-compositor.h"
+#include <math.h>
+#include <getopt.h>
+#include <linux/videodev2.h>
+
+/*******************************************************************************
+ * Tracing configuration
+ ******************************************************************************/
+
+TRACE_TAG(INIT, 1);
+TRACE_TAG(INFO, 1);
+TRACE_TAG(DEBUG, 0);
+
+/*******************************************************************************
+ * Global variables
+ ******************************************************************************/
+
+/* ...log level (errors only by default) */
+int     LOG_LEVEL = 0;
+
+/* ...background color of the compositor */
+u32     __bg_color = 0xFF202020;
+
+/* ...SIMD kernels of software compositor are enabled */
+extern int  __vsp_sw_simd;
+
+/*******************************************************************************
+ * Local constants definitions
+ ******************************************************************************/
+
+/* ...relative width of a seam between adjacent cameras */
+#define TEST_SEAM                       0.3
+
+/* ...minimal acceptable PSNR of composed image for 1/2 and 1/4 alpha scales */
+#define TEST_PSNR_2                     32.0
+#define TEST_PSNR_4                     28.0
+
+/*******************************************************************************
+ * Local types definitions
+ ******************************************************************************/
+
+/* ...difference between two images */
+typedef struct test_diff
+{
+    /* ...maximal absolute error */
+    int                 max;
+
+    /* ...mean absolute error */
+    double              mean;
+
+    /* ...peak signal-to-noise ratio (dB) */
+    double              psnr;
+
+}   test_diff_t;
+
+/*******************************************************************************
+ * Jobs completion
+ ******************************************************************************/
+
+static pthread_mutex_t  __lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   __wait = PTHREAD_COND_INITIALIZER;
+
+/* ...number of completed jobs */
+static int              __done;
+
+/* ...compositor and upscaler jobs completion callback */
+static void __job_callback(void *data, void *priv, int result)
+{
+    (result != 0 ? TRACE(ERROR, _x("job failed: %d"), result) : 0);
+
+    pthread_mutex_lock(&__lock);
+    __done++;
+    pthread_cond_signal(&__wait);
+    pthread_mutex_unlock(&__lock);
+}
+
+/* ...wait until total number of completed jobs reaches n */
+static void __job_wait(int n)
+{
+    pthread_mutex_lock(&__lock);
+
+    while (__done < n)
+    {
+        pthread_cond_wait(&__wait, &__lock);
+    }
+
+    pthread_mutex_unlock(&__lock);
+}
+
+/*******************************************************************************
+ * Test images
+ ******************************************************************************/
+
+/* ...blend mask of a set (0 - left/right, 1 - front/rear) sampled at w*h pixel centers */
+static void __mask_render(u8 *p, int w, int h, int set)
+{
+    int     x, y;
+
+    for (y = 0; y < h; y++)
+    {
+        for (x = 0; x < w; x++, p++)
+        {
+            double  dx = (x + 0.5) / w - 0.5, dy = (y + 0.5) / h - 0.5;
+            double  ax = fabs(dx), ay = fabs(dy);
+            double  t = (ay - ax) / (ax + ay + 1e-9) / TEST_SEAM + 0.5;
+
+            /* ...smooth transition across diagonal seams */
+            t = (t < 0 ? 0 : (t > 1 ? 1 : t)), t = t * t * (3 - 2 * t);
+
+            /* ...hard edges at the borders of cameras coverage and around the car */
+            if (dx * dx + dy * dy > 0.48 * 0.48 || (ax < 0.12 && ay < 0.2))
+            {
+                *p = 0;
+            }
+            else
+            {
+                *p = (u8)lrint(255 * (set ? t : 1 - t));
+            }
+        }
+    }
+}
+
+/* ...camera plane of a set: luma ramp with fine checker texture (UYVY) */
+static void __camera_render(u8 *p, int w, int h, int set)
+{
+    int     x, y;
+
+    for (y = 0; y < h; y++)
+    {
+        for (x = 0; x < w; x += 2, p += 4)
+        {
+            int     r = (set ? y * 219 / h : x * 219 / w);
+            int     c = (((x >> 3) ^ (y >> 3)) & 1 ? 16 : -16);
+
+            p[0] = (set ? 200 : 90), p[1] = p[3] = 16 + r + c, p[2] = (set ? 90 : 200);
+        }
+    }
+}
+
+/* ...compare first c channels of n pixels of two images (bpp bytes per pixel) */
+static void __diff(const u8 *a, const u8 *b, int n, int bpp, int c, test_diff_t *d)
+{
+    u64     sum = 0, sq = 0;
+    int     i, k, e;
+
+    for (i = 0, d->max = 0; i < n; i++, a += bpp, b += bpp)
+    {
+        for (k = 0; k < c; k++)
+        {
+            e = abs((int)a[k] - (int)b[k]);
+            sum += e, sq += e * e;
+            (e > d->max ? d->max = e : 0);
+        }
+    }
+
+    d->mean = (double)sum / ((double)n * c);
+    d->psnr = (sq ? 10 * log10(255.0 * 255.0 * n * c / sq) : 99.0);
+}
+
+/*******************************************************************************
+ * Reduced-resolution alpha-planes quality
+ ******************************************************************************/
+
+/* ...compare composition using upscaled 1/s alpha-planes against full-resolution ones */
+static int __alpha_quality(int W, int H, int s)
+{
+    vsp_compositor_t   *vsp;
+    vsp_mem_t          *camera[2], *alpha[2], *render[2], *scaled[2], *output[2], *car;
+    vsp_mem_t          *input[9];
+    int                 bbox[4] = { 0, 0, 0, 0 };
+    int                 w = W / s, h = H / s;
+    test_diff_t         d[3];
+    u32                 t0, t1;
+    int                 k, n;
+
+    /* ...compositor with alpha-planes upscaler */
+    CHK_ERR(vsp = compositor_init(W, H, V4L2_PIX_FMT_UYVY, W, H, V4L2_PIX_FMT_ARGB32, 16, 16, 2, __job_callback, NULL), -errno);
+    CHK_API(vsp_scaler_init(vsp, w, h, W, H, __job_callback));
+
+    /* ...allocate planes */
+    CHK_API(vsp_allocate_buffers(W, H, V4L2_PIX_FMT_UYVY, camera, 2));
+    CHK_API(vsp_allocate_buffers(W, H, V4L2_PIX_FMT_GREY, alpha, 2));
+    CHK_API(vsp_allocate_buffers(W, H, V4L2_PIX_FMT_GREY, scaled, 2));
+    CHK_API(vsp_allocate_buffers(w, h, V4L2_PIX_FMT_GREY, render, 2));
+    CHK_API(vsp_allocate_buffers(W, H, V4L2_PIX_FMT_ARGB32, output, 2));
+    CHK_API(vsp_allocate_buffers(16, 16, V4L2_PIX_FMT_ARGB32, &car, 1));
+
+    /* ...render the masks at full and reduced resolution */
+    for (k = 0; k < 2; k++)
+    {
+        __camera_render(vsp_mem_ptr(camera[k]), W, H, k);
+        __mask_render(vsp_mem_ptr(alpha[k]), W, H, k);
+        __mask_render(vsp_mem_ptr(render[k]), w, h, k);
+    }
+
+    /* ...upscale reduced planes (one job at a time) */
+    for (k = 0, n = __done, t0 = __get_time_usec(); k < 2; k++)
+    {
+        CHK_API(vsp_alpha_scale(vsp, render[k], scaled[k], NULL));
+        __job_wait(++n);
+    }
+
+    t1 = __get_time_usec();
+
+    /* ...compose the scene with both sets of alpha-planes (car sprite is empty) */
+    for (k = 0; k < 2; k++)
+    {
+        input[0] = input[1] = camera[0], input[2] = input[3] = camera[1];
+        input[4] = input[5] = (k ? scaled[0] : alpha[0]);
+        input[6] = input[7] = (k ? scaled[1] : alpha[1]);
+        input[8] = car;
+
+        CHK_API(vsp_job_submit(vsp, input, output[k], bbox, NULL));
+    }
+
+    __job_wait(n + 2);
+
+    /* ...alpha-planes and composed image differences */
+    __diff(vsp_mem_ptr(alpha[0]), vsp_mem_ptr(scaled[0]), W * H, 1, 1, &d[0]);
+    __diff(vsp_mem_ptr(alpha[1]), vsp_mem_ptr(scaled[1]), W * H, 1, 1, &d[1]);
+    __diff(vsp_mem_ptr(output[0]), vsp_mem_ptr(output[1]), W * H, 4, 3, &d[2]);
+
+    printf("alpha 1/%d (%d*%d -> %d*%d, upscaling %u us):\n", s, w, h, W, H, (t1 - t0) / 2);
+    printf("    alpha-0:   max=%3d, mean=%.3f, psnr=%.2f dB\n", d[0].max, d[0].mean, d[0].psnr);
+    printf("    alpha-1:   max=%3d, mean=%.3f, psnr=%.2f dB\n", d[1].max, d[1].mean, d[1].psnr);
+    printf("    composed:  max=%3d, mean=%.3f, psnr=%.2f dB\n", d[2].max, d[2].mean, d[2].psnr);
+    printf("    alpha memory: %u KB -> %u KB per plane\n", (u32)(W * H) >> 10, (u32)(w * h) >> 10);
+
+    /* ...release resources */
+    compositor_destroy(vsp);
+
+    for (k = 0; k < 2; k++)
+    {
+        vsp_mem_free(camera[k]), vsp_mem_free(alpha[k]), vsp_mem_free(scaled[k]);
+        vsp_mem_free(render[k]), vsp_mem_free(output[k]);
+    }
+
+    vsp_mem_free(car);
+
+    return (d[2].psnr >= (s == 2 ? TEST_PSNR_2 : TEST_PSNR_4) ? 0 : 1);
+}
+
+/*******************************************************************************
+ * SIMD kernels against scalar reference
+ ******************************************************************************/
+
+/* ...fill memory with pseudo-random bytes */
+static void __random_fill(u8 *p, u32 size, unsigned int *seed)
+{
+    while (size--)
+    {
+        *p++ = (u8)rand_r(seed);
+    }
+}
+
+/* ...compose frames and return average time per frame (us) */
+static u32 __compose(vsp_compositor_t *vsp, vsp_mem_t **input, vsp_mem_t *output, const int *bbox, int frames)
+{
+    u32     t0 = __get_time_usec();
+    int     k, n;
+
+    for (k = 0, n = __done; k < frames; k++)
+    {
+        CHK_API(vsp_job_submit(vsp, input, output, bbox, NULL));
+        __job_wait(++n);
+    }
+
+    return (__get_time_usec() - t0) / frames;
+}
+
+/* ...compare SIMD and scalar compositing of random planes for all formats (W is not a multiple of lanes) */
+static int __simd_check(int W, int H, int frames)
+{
+    static const u32    ifmt[] = { V4L2_PIX_FMT_UYVY, V4L2_PIX_FMT_YUYV, V4L2_PIX_FMT_NV16, V4L2_PIX_FMT_ARGB32 };
+    static const u32    ofmt[] = { V4L2_PIX_FMT_ARGB32, V4L2_PIX_FMT_RGB565, V4L2_PIX_FMT_UYVY, V4L2_PIX_FMT_NV12 };
+    vsp_compositor_t   *vsp;
+    vsp_mem_t          *camera[2], *alpha[2], *output[2], *car;
+    vsp_mem_t          *input[9];
+    int                 cw = W / 2, ch = H / 2;
+    int                 bbox[4] = { 3, 5, cw - 4, ch - 2 };
+    unsigned int        seed = 1;
+    u32                 t[2];
+    int                 i, o, k, r = 0;
+
+    for (i = 0; i < (int)(sizeof(ifmt) / sizeof(ifmt[0])); i++)
+    {
+        for (o = 0; o < (int)(sizeof(ofmt) / sizeof(ofmt[0])); o++)
+        {
+            CHK_ERR(vsp = compositor_init(W, H, ifmt[i], W, H, ofmt[o], cw, ch, 1, __job_callback, NULL), -errno);
+
+            /* ...random cameras, alpha-planes and car sprite */
+            CHK_API(vsp_allocate_buffers(W, H, ifmt[i], camera, 2));
+            CHK_API(vsp_allocate_buffers(W, H, V4L2_PIX_FMT_GREY, alpha, 2));
+            CHK_API(vsp_allocate_buffers(bbox[2] - bbox[0], bbox[3] - bbox[1], V4L2_PIX_FMT_ARGB32, &car, 1));
+            CHK_API(vsp_allocate_buffers(W, H, ofmt[o], output, 2));
+
+            for (k = 0; k < 2; k++)
+            {
+                __random_fill(vsp_mem_ptr(camera[k]), vsp_mem_size(camera[k]), &seed);
+                __random_fill(vsp_mem_ptr(alpha[k]), vsp_mem_size(alpha[k]), &seed);
+            }
+
+            __random_fill(vsp_mem_ptr(car), vsp_mem_size(car), &seed);
+
+            input[0] = input[1] = camera[0], input[2] = input[3] = camera[1];
+            input[4] = input[5] = alpha[0], input[6] = input[7] = alpha[1];
+            input[8] = car;
+
+            /* ...scalar reference and SIMD kernels */
+            for (k = 0; k < 2; k++)
+            {
+                __vsp_sw_simd = k;
+                t[k] = __compose(vsp, input, output[k], bbox, frames);
+            }
+
+            k = memcmp(vsp_mem_ptr(output[0]), vsp_mem_ptr(output[1]), vsp_mem_size(output[0]));
+
+            printf("simd %c%c%c%c -> %c%c%c%c: %s, scalar %u us, simd %u us (%.2fx)\n",
+                   __v4l2_fmt(ifmt[i]), __v4l2_fmt(ofmt[o]), (k ? "MISMATCH" : "identical"), t[0], t[1], (double)t[0] / (t[1] ? t[1] : 1));
+
+            r |= (k != 0);
+
+            compositor_destroy(vsp);
+
+            for (k = 0; k < 2; k++)
+            {
+                vsp_mem_free(camera[k]), vsp_mem_free(alpha[k]), vsp_mem_free(output[k]);
+            }
+
+            vsp_mem_free(car);
+        }
+    }
+
+    return r;
+}
+
+/*******************************************************************************
+ * Entry point
+ ******************************************************************************/
+
+int main(int argc, char **argv)
+{
+    int     W = 1280, H = 800, frames = 10;
+    int     opt, r = 0, s;
+
+    while ((opt = getopt(argc, argv, "W:H:n:v:")) >= 0)
+    {
+        switch (opt)
+        {
+        case 'W':
+            W = atoi(optarg);
+            break;
+
+        case 'H':
+            H = atoi(optarg);
+            break;
+
+        case 'n':
+            frames = atoi(optarg);
+            break;
+
+        case 'v':
+            LOG_LEVEL = atoi(optarg);
+            break;
+
+        default:
+            fprintf(stderr, "usage: %s [-W width] [-H height] [-n frames] [-v level]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    TRACE_INIT("Compositor test");
+
+    /* ...planes must be divisible by the largest alpha scale factor */
+    if (W <= 0 || H <= 0 || (W & 7) || (H & 3) || frames <= 0)
+    {
+        fprintf(stderr, "invalid dimensions: %d*%d\n", W, H);
+        return 1;
+    }
+
+    /* ...reduced-resolution alpha-planes quality against full-resolution rendering */
+    for (s = 2; s <= 4; s <<= 1)
+    {
+        if ((opt = __alpha_quality(W, H, s)) < 0)
+        {
+            TRACE(ERROR, _x("alpha 1/%d test failed: %m"), s);
+        }
+
+        r |= (opt != 0);
+    }
+
+    /* ...SIMD kernels must match scalar code exactly (odd width exercises scalar tails) */
+    if ((opt = __simd_check(W - 2, H, frames)) < 0)
+    {
+        TRACE(ERROR, _x("SIMD test failed: %m"));
+    }
+
+    r |= (opt != 0);
+
+    printf("%s\n", (r ? "FAILED" : "PASSED"));
+
+    return r;
+}
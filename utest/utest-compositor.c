@@ -33,6 +33,9 @@
 #include "utest-common.h"
 #include "utest-compositor.h"
 #include "utest-app.h"
+#include "utest-reactor.h"
+#include "utest-compositor-ring.h"
+#include "utest-compositor-arena.h"
 #include <vspm_public.h>
 #include <mmngr_user_public.h>
 #include <mmngr_buf_user_public.h>
@@ -55,6 +58,7 @@ typedef struct vsp_src_t            VSP_SRC_T;
 typedef struct vsp_dst_t            VSP_DST_T;
 typedef struct vsp_alpha_unit_t     VSP_ALPHA_T;
 typedef struct vsp_bru_t            VSP_BRU_T;
+typedef struct vsp_uds_t            VSP_UDS_T;
 typedef struct vsp_bld_ctrl_t       VSP_BLEND_CTRL_T;
 typedef struct vsp_bld_vir_t        VSP_BLEND_VIRTUAL_T;
 typedef struct vsp_ctrl_t           VSP_CTRL_T;
@@ -70,6 +74,7 @@ typedef T_VSP_IN                    VSP_SRC_T;
 typedef T_VSP_OUT                   VSP_DST_T;
 typedef T_VSP_ALPHA                 VSP_ALPHA_T;
 typedef T_VSP_BRU                   VSP_BRU_T;
+typedef T_VSP_UDS                   VSP_UDS_T;
 typedef T_VSP_BLEND_CONTROL         VSP_BLEND_CTRL_T;
 typedef T_VSP_BLEND_VIRTUAL         VSP_BLEND_VIRTUAL_T;
 typedef T_VSP_CTRL                  VSP_CTRL_T;
@@ -84,7 +89,8 @@ typedef unsigned long               VSPM_HANDLE_T;
  * Local types definitions
  ******************************************************************************/
 
-typedef struct vsp_compositor
+/* ...compositor job parameters set */
+typedef struct vsp_params
 {
     /* ...source pads configuration */
 	VSP_SRC_T               src_par[3];
@@ -113,23 +119,103 @@ typedef struct vsp_compositor
     /* ...another function? - tbd */
 	VSPM_JOB_T              vspm_ip;
 
+    /* ...active source pads mask */
+    u32                     layers;
+
+    /* ...active car sprite bounding box within car image */
+    int                     car_bbox[4];
+
+}   vsp_params_t;
+
+/* ...compositor job (one per job in flight) */
+typedef struct vsp_job
+{
+    /* ...parameters set for buffers not covered by templates */
+    vsp_params_t            own;
+
     /* ...display list memory */
     vsp_mem_t              *dl;
 
+    /* ...owning compositor */
+    struct vsp_compositor  *vsp;
+
+}   vsp_job_t;
+
+/* ...kinds of registered pool buffers */
+enum {
+    VSP_POOL_CAMERA_0,
+    VSP_POOL_CAMERA_1,
+    VSP_POOL_ALPHA_0,
+    VSP_POOL_ALPHA_1,
+    VSP_POOL_CAR,
+    VSP_POOL_OUTPUT,
+    VSP_POOL_NUMBER,
+};
+
+/* ...maximal number of precompiled job templates */
+#define VSP_TEMPLATES_MAX           1024
+
+typedef struct vsp_compositor
+{
+    /* ...job parameters sets */
+    vsp_job_t               job[VSP_JOBS_MAX];
+
+    /* ...jobs ring (status of jobs in flight and completions reporting) */
+    vsp_ring_t              ring;
+
+    /* ...jobs ring access lock */
+    pthread_mutex_t         lock;
+
     /* ...driver handle */
     VSPM_HANDLE_T           handle;
 
-    /* ...processing callback */
-    vsp_callback_t          cb;
-    
-    /* ...callback client data */
-    void                   *cdata;
+    /* ...car image origin on the screen */
+    int                     car_pos[2];
+
+    /* ...alpha-planes upscaler (optional) */
+    struct vsp_scaler      *scl;
 
     /* ...input parameters for cameras */
     u32                     format;
 
+    /* ...pipeline configuration (used for templates precompilation) */
+    int                     w, h, W, H, cw, ch;
+    u32                     ofmt;
+
+    /* ...registered pool buffers of each kind */
+    vsp_mem_t             **pool[VSP_POOL_NUMBER];
+    int                     pool_num[VSP_POOL_NUMBER];
+
+    /* ...precompiled job templates for all combinations of pool buffers */
+    vsp_params_t           *tmpl;
+
 }   vsp_compositor_t;
 
+/* ...alpha-plane upscaling job (GREY plane is processed as luma of NV12 image) */
+typedef struct vsp_scaler
+{
+    /* ...source / destination pads configuration */
+    VSP_SRC_T               src_par;
+    VSP_DST_T               dst_par;
+
+    /* ...up-down scaler configuration */
+    VSP_UDS_T               uds_par;
+
+    /* ...control module (pipeline description) */
+    VSP_CTRL_T              ctrl_par;
+
+    /* ...job control structure */
+    VSP_START_T             vsp_par;
+    VSPM_JOB_T              vspm_ip;
+
+    /* ...display list memory */
+    vsp_mem_t              *dl;
+
+    /* ...neutral source chroma plane and discarded destination chroma plane */
+    vsp_mem_t              *chroma[2];
+
+}   vsp_scaler_t;
+
 /* ...DMA buffer descriptor */
 struct vsp_dmabuf
 {
@@ -163,14 +249,23 @@ struct vsp_mem
     
     /* ...number of planes */
     u32                 offset[3];
+
+    /* ...position of a buffer in a registered pool */
+    int                 index;
+
+    /* ...arena the chunk is carved from (NULL - separate block) */
+    vsp_arena_t        *arena;
+
+    /* ...offset of the chunk within the arena */
+    u32                 base;
 };
-    
+
 /*******************************************************************************
  * Memory allocation
  ******************************************************************************/
 
-/* ...allocate contiguous block */
-vsp_mem_t * vsp_mem_alloc(u32 size)
+/* ...allocate separate contiguous block */
+static vsp_mem_t * __vsp_mem_alloc(u32 size)
 {
     vsp_mem_t      *mem;
     int             err;
@@ -206,8 +301,8 @@ vsp_mem_t * vsp_mem_alloc(u32 size)
     return NULL;
 }
 
-/* ...destroy contiguous memory block */
-void vsp_mem_free(vsp_mem_t *mem)
+/* ...destroy separate contiguous block */
+static void __vsp_mem_free(vsp_mem_t *mem)
 {
     /* ...free allocated memory */
     mmngr_free_in_user(mem->id);
@@ -218,6 +313,69 @@ void vsp_mem_free(vsp_mem_t *mem)
     free(mem);
 }
 
+/* ...allocate memory block */
+vsp_mem_t * vsp_mem_alloc(u32 size)
+{
+    vsp_arena_t    *arena;
+    vsp_mem_t      *mem, *block;
+    u32             base;
+
+    /* ...carve a chunk from the active arena if possible */
+    if ((arena = vsp_arena_reserve(&size, &base)) == NULL)
+    {
+        return __vsp_mem_alloc(size);
+    }
+
+    /* ...allocate memory descriptor */
+    if ((mem = calloc(1, sizeof(*mem))) == NULL)
+    {
+        vsp_arena_unreserve(arena, base, size);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    /* ...chunk shares contiguous block of the arena */
+    block = vsp_arena_block(arena);
+    mem->id = block->id;
+    mem->user_virt_addr = block->user_virt_addr + base;
+    mem->phy_addr = block->phy_addr + base;
+    mem->hard_addr = block->hard_addr + base;
+    mem->size = size;
+    mem->arena = arena;
+    mem->base = base;
+
+    TRACE(DEBUG, _b("carved %p[%u] from arena at %u (pa=%08lx)"), (void *)(uintptr_t)mem->user_virt_addr, size, base, mem->hard_addr);
+
+    return mem;
+}
+
+/* ...destroy memory block */
+void vsp_mem_free(vsp_mem_t *mem)
+{
+    vsp_arena_t    *arena = mem->arena;
+    u32             base = mem->base, size = mem->size;
+
+    if (!arena)
+    {
+        __vsp_mem_free(mem);
+        return;
+    }
+
+    TRACE(DEBUG, _b("returned %p[%u] to arena"), vsp_mem_ptr(mem), size);
+
+    /* ...planes descriptors reference the arena DMA buffer */
+    free(mem->dmabuf);
+    free(mem);
+
+    vsp_arena_unreserve(arena, base, size);
+}
+
+/* ...arena backing store */
+const vsp_arena_ops_t   vsp_arena_ops = {
+    .alloc = __vsp_mem_alloc,
+    .free = __vsp_mem_free,
+};
+
 /* ...memory buffer accessor */
 void * vsp_mem_ptr(vsp_mem_t *mem)
 {
@@ -293,7 +451,7 @@ void vsp_dmabuf_unexport(vsp_dmabuf_t *dmabuf)
  * VSPM job processing
  ******************************************************************************/
 
-/* ...processing completion callback */
+/* ...processing completion callback (jobs are reported in submission order) */
 #ifdef __VSPM_GEN3
 static void vspm_job_callback(unsigned long job_id, long result, void *user_data)
 #else
@@ -301,10 +459,11 @@ static void vspm_job_callback(unsigned long job_id, long result, unsigned long u
 #endif
 {
 #ifdef __VSPM_GEN3
-    vsp_compositor_t   *vsp = user_data;
+    vsp_job_t          *job = user_data;
 #else
-    vsp_compositor_t   *vsp = (void *)(uintptr_t)user_data;
+    vsp_job_t          *job = (void *)(uintptr_t)user_data;
 #endif
+    vsp_compositor_t   *vsp = job->vsp;
     sigset_t            set;
 
     /* ...unblock signal (allow interruption once processing is complete) */
@@ -320,8 +479,12 @@ static void vspm_job_callback(unsigned long job_id, long result, unsigned long u
         TRACE(DEBUG, _b("job #%lx completed"), job_id);
     }
 
-    /* ...notify application on processing completion */
-    vsp->cb(vsp->cdata, (result ? -EBADF : 0));
+    pthread_mutex_lock(&vsp->lock);
+
+    /* ...mark job is complete */
+    vsp_ring_complete(&vsp->ring, &vsp->ring.job[job - vsp->job], (result ? -EBADF : 0));
+
+    pthread_mutex_unlock(&vsp->lock);
 }
 
 static inline void __vsp_set_addr(VSP_SRC_T *src, vsp_mem_t *input)
@@ -331,52 +494,282 @@ static inline void __vsp_set_addr(VSP_SRC_T *src, vsp_mem_t *input)
     src->addr_c1 = __ADDR_CAST(input->hard_addr + input->offset[2]);
 }
 
-/* ...job submission */
-int vsp_job_submit(vsp_compositor_t *vsp, vsp_mem_t **input, vsp_mem_t *output)
+/* ...select active source pads and blending order */
+static inline void __vsp_layers_setup(vsp_params_t *par, u32 mask)
+{
+    static const u32    lay[3] = { VSP_LAY_1, VSP_LAY_2, VSP_LAY_3 };
+    VSP_SRC_T          *src[3] = { NULL, NULL, NULL };
+    VSP_BLEND_CTRL_T   *bld[3] = { NULL, NULL, NULL };
+    u32                 order = 0;
+    int                 k, n;
+
+    /* ...do nothing if set of layers is not changed */
+    if (par->layers == mask)    return;
+
+    /* ...put active pads in original order; first one is not blended */
+    for (k = n = 0; k < 3; k++)
+    {
+        if ((mask & (1 << k)) == 0)     continue;
+
+        /* ...camera planes use alpha-sum, car model uses its own alpha */
+        (n > 0 ? bld[n - 1] = &par->bld_par[k < 2 ? 0 : 1] : NULL);
+        order |= lay[n] << (4 * n);
+        src[n++] = &par->src_par[k];
+    }
+
+    /* ...background is always blended last */
+    bld[n - 1] = &par->bld_par[2];
+    order |= VSP_LAY_VIRTUAL << (4 * n);
+
+    /* ...update job parameters */
+    par->bru_par.lay_order = order;
+#ifdef __VSPM_GEN3
+    par->bru_par.blend_unit_a = bld[0];
+    par->bru_par.blend_unit_b = bld[1];
+    par->bru_par.blend_unit_c = bld[2];
+    par->vsp_par.src_par[0] = src[0];
+    par->vsp_par.src_par[1] = src[1];
+    par->vsp_par.src_par[2] = src[2];
+#else
+    par->bru_par.blend_control_a = bld[0];
+    par->bru_par.blend_control_b = bld[1];
+    par->bru_par.blend_control_c = bld[2];
+    par->vsp_par.src1_par = src[0];
+    par->vsp_par.src2_par = src[1];
+    par->vsp_par.src3_par = src[2];
+#endif
+    par->vsp_par.rpf_num = n;
+    par->layers = mask;
+
+    TRACE(DEBUG, _b("active layers: %X (order=%X)"), mask, order);
+}
+
+/* ...place car sprite on the screen */
+static inline void __vsp_car_setup(vsp_params_t *par, const int *pos, const int *bbox)
+{
+    VSP_SRC_T  *src = &par->src_par[2];
+    int         x = pos[0] + bbox[0], y = pos[1] + bbox[1];
+
+    /* ...do nothing if geometry is not changed */
+    if (!memcmp(par->car_bbox, bbox, sizeof(par->car_bbox)))    return;
+
+    /* ...sprite rows are packed; crop part lying outside of the screen */
+    src->stride = (bbox[2] - bbox[0]) * 4;
+    src->width = bbox[2] - bbox[0];
+    src->height = bbox[3] - bbox[1];
+    src->x_offset = (x < 0 ? -x : 0), src->x_position = (x < 0 ? 0 : x);
+    src->y_offset = (y < 0 ? -y : 0), src->y_position = (y < 0 ? 0 : y);
+
+    memcpy(par->car_bbox, bbox, sizeof(par->car_bbox));
+
+    TRACE(DEBUG, _b("car sprite: (%d,%d)-(%d,%d)"), bbox[0], bbox[1], bbox[2], bbox[3]);
+}
+
+/* ...bind parameters set to particular input / output buffers */
+static void __vsp_params_bind(vsp_params_t *par, vsp_mem_t **input, vsp_mem_t *output)
+{
+    /* ...update set of active layers (car model is always present) */
+    __vsp_layers_setup(par, (input[0] ? 1 << 0 : 0) | (input[2] ? 1 << 1 : 0) | (1 << 2));
+
+    /* ...set input buffers and transparency planes addresses */
+    if (input[0])
+    {
+        __vsp_set_addr(&par->src_par[0], input[0]);
+        par->alpha_par[0].addr_a = __ADDR_CAST(input[4]->hard_addr);
+    }
+
+    if (input[2])
+    {
+        __vsp_set_addr(&par->src_par[1], input[2]);
+        par->alpha_par[1].addr_a = __ADDR_CAST(input[6]->hard_addr);
+    }
+
+    __vsp_set_addr(&par->src_par[2], input[8]);
+
+    /* ...set destination planes addresses (chroma plane is used by semi-planar formats only) */
+    par->dst_par.addr = __ADDR_CAST(output->hard_addr + output->offset[0]);
+    par->dst_par.addr_c0 = __ADDR_CAST(output->hard_addr + output->offset[1]);
+}
+
+/* ...position of a buffer in a registered pool (negative if buffer is not registered) */
+static inline int __vsp_pool_index(vsp_compositor_t *vsp, int kind, vsp_mem_t *mem)
+{
+    int     i = mem->index;
+
+    return (i < vsp->pool_num[kind] && vsp->pool[kind][i] == mem ? i : -1);
+}
+
+/* ...select precompiled template for a buffers combination (NULL if not available) */
+static vsp_params_t * __vsp_template(vsp_compositor_t *vsp, vsp_mem_t **input, vsp_mem_t *output)
+{
+    int     S = 1 + vsp->pool_num[VSP_POOL_CAMERA_0] * vsp->pool_num[VSP_POOL_ALPHA_0];
+    int     key = 0, k, c, a;
+
+    if (!vsp->tmpl)     return NULL;
+
+    /* ...camera set is either disabled or selects a pair of camera and alpha buffers */
+    for (k = 0; k < 2; k++)
+    {
+        if (!input[2 * k])
+        {
+            key *= S;
+        }
+        else if ((c = __vsp_pool_index(vsp, VSP_POOL_CAMERA_0 + k, input[2 * k])) < 0 ||
+                 (a = __vsp_pool_index(vsp, VSP_POOL_ALPHA_0 + k, input[4 + 2 * k])) < 0)
+        {
+            return NULL;
+        }
+        else
+        {
+            key = key * S + 1 + c * vsp->pool_num[VSP_POOL_ALPHA_0] + a;
+        }
+    }
+
+    /* ...car image and output buffers */
+    if ((c = __vsp_pool_index(vsp, VSP_POOL_CAR, input[8])) < 0)        return NULL;
+    if ((a = __vsp_pool_index(vsp, VSP_POOL_OUTPUT, output)) < 0)      return NULL;
+
+    return &vsp->tmpl[(key * vsp->pool_num[VSP_POOL_CAR] + c) * vsp->pool_num[VSP_POOL_OUTPUT] + a];
+}
+
+/* ...job submission (disabled camera plane has NULL input; called from a single thread at a time) */
+int vsp_job_submit(vsp_compositor_t *vsp, vsp_mem_t **input, vsp_mem_t *output, const int *car, void *priv)
 {
+    vsp_status_t   *status;
+    vsp_job_t      *job;
+    vsp_params_t   *par;
     unsigned long   job_id;
     long            err;
     sigset_t        set;
 
-    /* ...set input buffers addresses */
-    __vsp_set_addr(&vsp->src_par[0], input[0]);
-    __vsp_set_addr(&vsp->src_par[1], input[2]);
-    __vsp_set_addr(&vsp->src_par[2], input[8]);
+    /* ...get free parameters set */
+    pthread_mutex_lock(&vsp->lock);
+    status = vsp_ring_next(&vsp->ring);
+    pthread_mutex_unlock(&vsp->lock);
+
+    CHK_ERR(status, -(errno = EBUSY));
+
+    job = &vsp->job[status - vsp->ring.job];
 
-    /* ...set transparency plane addresses */
-    vsp->alpha_par[0].addr_a = __ADDR_CAST(input[4]->hard_addr);
-    vsp->alpha_par[1].addr_a = __ADDR_CAST(input[6]->hard_addr);
+    /* ...select precompiled template; jobs in flight never share it as output buffer is a part of the key */
+    if ((par = __vsp_template(vsp, input, output)) == NULL)
+    {
+        /* ...buffers are not registered; patch own parameters set */
+        __vsp_params_bind(par = &job->own, input, output);
+    }
 
-    /* ...set destination plane address */
-    vsp->dst_par.addr = __ADDR_CAST(output->hard_addr);
+    /* ...update car sprite geometry */
+    __vsp_car_setup(par, vsp->car_pos, car);
 
-#if 0
 #ifdef __VSPM_GEN3
-    BUG(vsp->src_par[0].alpha->asel != VSP_ALPHA_NUM2, _x("invalid alpha"));
-    BUG(vsp->src_par[1].alpha->asel != VSP_ALPHA_NUM2, _x("invalid alpha"));
-#else
-    BUG(vsp->src_par[0].alpha_blend->asel != VSP_ALPHA_NUM2, _x("invalid alpha"));
-    BUG(vsp->src_par[1].alpha_blend->asel != VSP_ALPHA_NUM2, _x("invalid alpha"));
-#endif
+    /* ...display list belongs to a job slot */
+	par->vsp_par.dl_par.hard_addr = __ADDR_CAST(job->dl->hard_addr);
+	par->vsp_par.dl_par.virt_addr = (void *)(uintptr_t)job->dl->user_virt_addr;
+	par->vsp_par.dl_par.tbl_num = 128 + 64 * 8;
 #endif
 
+    /* ...put job into the ring before it may complete */
+    status->priv = priv, status->result = 1;
+    pthread_mutex_lock(&vsp->lock);
+    vsp->ring.head++;
+    pthread_mutex_unlock(&vsp->lock);
+
     /* ...block all signals for a duration of the job */
     sigfillset(&set);
     pthread_sigmask(SIG_BLOCK, &set, NULL);
 
     /* ...submit a job (use "default" priority 126 - tbd) */
 #ifdef __VSPM_GEN3
-    err = vspm_entry_job(vsp->handle, &job_id, 126, &vsp->vspm_ip, vsp, vspm_job_callback);
+    err = vspm_entry_job(vsp->handle, &job_id, 126, &par->vspm_ip, job, vspm_job_callback);
+#else
+    err = VSPM_lib_Entry(vsp->handle, &job_id, 126, &par->vspm_ip, (unsigned long)(uintptr_t)job, vspm_job_callback);
+#endif
+
+    TRACE(DEBUG, _b("job #%lx submitted: %ld (in flight: %u)"), job_id, err, vsp->ring.head - vsp->ring.tail);
+
+    if (err < 0)
+    {
+        /* ...unblock the signals and drop the job (no later job is submitted yet) */
+        pthread_sigmask(SIG_UNBLOCK, &set, NULL);
+        pthread_mutex_lock(&vsp->lock);
+        vsp->ring.head--;
+        pthread_mutex_unlock(&vsp->lock);
+        return -(errno = EBADFD);
+    }
+
+    return 0;
+}
+
+/* ...upscaling job completion callback */
+#ifdef __VSPM_GEN3
+static void vspm_scale_callback(unsigned long job_id, long result, void *user_data)
+#else
+static void vspm_scale_callback(unsigned long job_id, long result, unsigned long user_data)
+#endif
+{
+#ifdef __VSPM_GEN3
+    vsp_compositor_t   *vsp = user_data;
 #else
-    err = VSPM_lib_Entry(vsp->handle, &job_id, 126, &vsp->vspm_ip, (unsigned long)(uintptr_t)vsp, vspm_job_callback);
+    vsp_compositor_t   *vsp = (void *)(uintptr_t)user_data;
 #endif
+    sigset_t            set;
+
+    /* ...unblock signal (allow interruption once processing is complete) */
+    sigfillset(&set);
+    pthread_sigmask(SIG_UNBLOCK, &set, NULL);
+
+    TRACE(DEBUG, _b("scale job #%lx completed: %ld"), job_id, result);
+
+    pthread_mutex_lock(&vsp->lock);
+
+    /* ...mark job is complete */
+    vsp_ring_scale_complete(&vsp->ring, (result ? -EBADF : 0));
+
+    pthread_mutex_unlock(&vsp->lock);
+}
 
-    TRACE(DEBUG, _b("job #%lx submitted: %ld"), job_id, err);
+/* ...upscale alpha-plane (single job in flight; completion is passed to scaler callback) */
+int vsp_alpha_scale(vsp_compositor_t *vsp, vsp_mem_t *input, vsp_mem_t *output, void *priv)
+{
+    vsp_scaler_t   *scl = vsp->scl;
+    unsigned long   job_id;
+    long            err;
+    sigset_t        set;
+
+    /* ...scaler must be configured and idle */
+    CHK_ERR(scl, -(errno = EINVAL));
+
+    pthread_mutex_lock(&vsp->lock);
+    err = vsp_ring_scale_start(&vsp->ring, priv);
+    pthread_mutex_unlock(&vsp->lock);
+
+    CHK_API(err);
+
+    /* ...luma is the alpha-plane; chroma planes are constant */
+    scl->src_par.addr = __ADDR_CAST(input->hard_addr);
+    scl->dst_par.addr = __ADDR_CAST(output->hard_addr);
+
+    /* ...block all signals for a duration of the job */
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+#ifdef __VSPM_GEN3
+    err = vspm_entry_job(vsp->handle, &job_id, 126, &scl->vspm_ip, vsp, vspm_scale_callback);
+#else
+    err = VSPM_lib_Entry(vsp->handle, &job_id, 126, &scl->vspm_ip, (unsigned long)(uintptr_t)vsp, vspm_scale_callback);
+#endif
 
-    /* ...unblock the signals in case of error */
-    (err < 0 ? pthread_sigmask(SIG_UNBLOCK, &set, NULL) : 0);
+    TRACE(DEBUG, _b("scale job #%lx submitted: %ld"), job_id, err);
 
-    CHK_ERR(err >= 0, -(errno = EBADFD));
+    if (err < 0)
+    {
+        /* ...unblock the signals and drop the job */
+        pthread_sigmask(SIG_UNBLOCK, &set, NULL);
+        pthread_mutex_lock(&vsp->lock);
+        vsp->ring.scale_pending = 0;
+        pthread_mutex_unlock(&vsp->lock);
+        return -(errno = EBADFD);
+    }
 
     return 0;
 }
@@ -462,18 +855,52 @@ static inline void vsp_alpha_setup(VSP_ALPHA_T *alpha_par, int w, int h, int mas
 }
 
 /* ...destination pad setup */
-static inline void vsp_dst_setup(VSP_DST_T *dst_par, int w, int h, u32 fmt)
+static inline int vsp_dst_setup(VSP_DST_T *dst_par, int w, int h, u32 fmt)
 {
-    /* ...specify ARGB image stride */
-    dst_par->stride = w * 4;
+    switch (fmt)
+    {
+    case V4L2_PIX_FMT_ARGB32:
+        dst_par->stride = w * 4;
+        dst_par->format = VSP_OUT_PRGB8888;
+        dst_par->swap = VSP_SWAP_L | VSP_SWAP_LL;
+        dst_par->csc = VSP_CSC_OFF;
+        break;
+
+    case V4L2_PIX_FMT_RGB565:
+        dst_par->stride = w * 2;
+        dst_par->format = VSP_OUT_RGB565;
+        dst_par->swap = VSP_SWAP_W | VSP_SWAP_L | VSP_SWAP_LL;
+        dst_par->csc = VSP_CSC_OFF;
+        break;
+
+    case V4L2_PIX_FMT_UYVY:
+        dst_par->stride = w * 2;
+        dst_par->format = VSP_OUT_YUV422_INT0_YUY2;
+        dst_par->swap = VSP_SWAP_W | VSP_SWAP_L | VSP_SWAP_LL;
+        dst_par->csc = VSP_CSC_ON;
+        break;
+
+    case V4L2_PIX_FMT_NV12:
+        dst_par->stride = w;
+        dst_par->stride_c = w;
+        dst_par->format = VSP_OUT_YUV420_SEMI_NV12;
+        dst_par->swap = VSP_SWAP_B | VSP_SWAP_W | VSP_SWAP_L | VSP_SWAP_LL;
+        dst_par->csc = VSP_CSC_ON;
+        break;
+
+    default:
+        TRACE(ERROR, _x("unsupported output format '%c%c%c%c'"), __v4l2_fmt(fmt));
+        return -(errno = EINVAL);
+    }
+
+    /* ...specify format-independent destination pad configuration */
     dst_par->width = w;
     dst_par->height = h;
-    dst_par->format = VSP_OUT_PRGB8888;
-    dst_par->swap = VSP_SWAP_L | VSP_SWAP_LL;
     dst_par->pxa = VSP_PAD_IN;
-    dst_par->csc = VSP_CSC_OFF;
     dst_par->iturbt = VSP_ITURBT_601;
     dst_par->clrcng = VSP_FULL_COLOR;
+
+    return 0;
 }
 
 /* ...setup blending unit */
@@ -541,6 +968,8 @@ static inline u32 __vsp_pixfmt_size(int w, int h, u32 fmt)
     case V4L2_PIX_FMT_UYVY:     return 2 * w * h;
     case V4L2_PIX_FMT_YUYV:     return 2 * w * h;
     case V4L2_PIX_FMT_NV16:     return 2 * w * h;
+    case V4L2_PIX_FMT_NV12:     return 3 * w * h / 2;
+    case V4L2_PIX_FMT_RGB565:   return 2 * w * h;
     case V4L2_PIX_FMT_ARGB32:   return 4 * w * h;
     default:                    return 0;
     }
@@ -557,6 +986,7 @@ static inline int __vsp_pixfmt_planes(int w, int h, u32 fmt, u32 *size, u32 *str
         return size[0] = N, stride[0] = w, 1;
     case V4L2_PIX_FMT_UYVY:
     case V4L2_PIX_FMT_YUYV:
+    case V4L2_PIX_FMT_RGB565:
         return size[0] = N * 2, stride[0] = w * 2, 1;
     case V4L2_PIX_FMT_NV12:
     case V4L2_PIX_FMT_NV21:
@@ -638,6 +1068,12 @@ int vsp_buffer_export(vsp_mem_t *mem, int w, int h, u32 fmt, int *dmafd, u32 *of
     /* ...verify format */
     CHK_ERR((n = __vsp_pixfmt_planes(w, h, fmt, size, stride)) > 0, -(errno = EINVAL));
 
+    /* ...planes of an arena chunk are addressed by offsets within a single exported block */
+    if (mem->arena)
+    {
+        return vsp_arena_export(mem->arena, mem->base, mem->size, &mem->dmabuf, n, size, dmafd, offset);
+    }
+
     /* ...check if buffer is mapped already */
     if (mem->dmabuf)
     {
@@ -695,15 +1131,107 @@ error:
     return -errno;
 }
 
+/* ...job parameters set initialization (pipeline configuration is taken from compositor) */
+static int vsp_params_init(vsp_compositor_t *vsp, vsp_params_t *par)
+{
+    int     w = vsp->w, h = vsp->h, W = vsp->W, H = vsp->H, cw = vsp->cw, ch = vsp->ch;
+    u32     ifmt = vsp->format, ofmt = vsp->ofmt;
+
+    /* ...source pad setup - left + right cameras plane */
+    vsp_src_setup(&par->src_par[0], w, h, ifmt, w, h);
+    vsp_alpha_setup(&par->alpha_par[0], w, h, 1);
+#ifdef __VSPM_GEN3
+    par->src_par[0].alpha = &par->alpha_par[0];
+#else
+    par->src_par[0].alpha_blend = &par->alpha_par[0];
+#endif
+
+    /* ...source pad setup - front + center; exact copy of left + right plane */
+    memcpy(&par->src_par[1], &par->src_par[0], sizeof(VSP_SRC_T));
+    vsp_alpha_setup(&par->alpha_par[1], w, h, 0);
+#ifdef __VSPM_GEN3
+    par->src_par[1].alpha = &par->alpha_par[1];
+#else
+    par->src_par[1].alpha_blend = &par->alpha_par[1];
+#endif
+
+    /* ...car image pad setup; native ARGB */
+    vsp_src_setup(&par->src_par[2], cw, ch, V4L2_PIX_FMT_ARGB32, w, h);
+
+    /* ...save car image origin (sprites are positioned relative to it) */
+    vsp->car_pos[0] = (int)par->src_par[2].x_position - (int)par->src_par[2].x_offset;
+    vsp->car_pos[1] = (int)par->src_par[2].y_position - (int)par->src_par[2].y_offset;
+    par->car_bbox[2] = cw, par->car_bbox[3] = ch;
+    vsp_alpha_setup(&par->alpha_par[2], -1, -1, 0);
+#ifdef __VSPM_GEN3
+    par->src_par[2].alpha = &par->alpha_par[2];
+#else
+    par->src_par[2].alpha_blend = &par->alpha_par[2];
+#endif
+    
+    /* ...destination pad setup */
+    CHK_API(vsp_dst_setup(&par->dst_par, W, H, ofmt));
+
+    /* ...blending unit setup */
+    par->vsp_par.rpf_num = vsp_bru_setup(&par->bru_par, par->bld_par, &par->vir_par, w, h);
+    
+    /* ...control structure setup */
+    par->ctrl_par.bru = &par->bru_par;
+
+    /* ...setup VSP job parameters */
+    par->vsp_par.use_module = VSP_BRU_USE;
+#ifdef __VSPM_GEN3
+    par->vsp_par.src_par[0] = &par->src_par[0];
+    par->vsp_par.src_par[1] = &par->src_par[1];
+    par->vsp_par.src_par[2] = &par->src_par[2];
+#else
+    par->vsp_par.src1_par = &par->src_par[0];
+    par->vsp_par.src2_par = &par->src_par[1];
+    par->vsp_par.src3_par = &par->src_par[2];
+#endif
+    par->vsp_par.dst_par = &par->dst_par;
+    par->vsp_par.ctrl_par = &par->ctrl_par;
+    par->layers = (1 << 3) - 1;
+
+    /* ...prepare job descriptor */
+#ifdef __VSPM_GEN3
+	par->vspm_ip.type = VSPM_TYPE_VSP_AUTO;
+	par->vspm_ip.par.vsp = &par->vsp_par;
+#else
+	par->vspm_ip.uhType = VSPM_TYPE_VSP_AUTO;
+	par->vspm_ip.unionIpParam.ptVsp = &par->vsp_par;
+#endif
+
+    return 0;
+}
+
+/* ...job slot initialization */
+static int vsp_job_init(vsp_compositor_t *vsp, vsp_job_t *job)
+{
+    /* ...job belongs to compositor */
+    job->vsp = vsp;
+
+    /* ...parameters set for buffers not covered by templates */
+    CHK_API(vsp_params_init(vsp, &job->own));
+
+#ifdef __VSPM_GEN3
+    /* ...allocate DL memory (size is hardcoded?) */
+    CHK_ERR(job->dl = vsp_mem_alloc((128 + 64 * 8) * 32/* 8 */), -(errno = ENOMEM));
+#endif
+
+    return 0;
+}
+
 /*******************************************************************************
  * Entry points
  ******************************************************************************/
 
-/* ...module initialization function */
-vsp_compositor_t * compositor_init(int w, int h, u32 ifmt, int W, int H, u32 ofmt, int cw, int ch, vsp_callback_t cb, void *cdata)
+/* ...module initialization function (jobs - number of jobs in flight) */
+vsp_compositor_t * compositor_init(int w, int h, u32 ifmt, int W, int H, u32 ofmt, int cw, int ch, int jobs, vsp_callback_t cb, void *cdata)
 {
     vsp_compositor_t       *vsp;
     long                    err;
+    int                     i;
 #ifdef __VSPM_GEN3
     struct vspm_init_t      init_par;
 #endif
@@ -711,8 +1239,15 @@ vsp_compositor_t * compositor_init(int w, int h, u32 ifmt, int W, int H, u32 ofm
     /* ...allocate compositor data */
     CHK_ERR(vsp = calloc(1, sizeof(*vsp)), (errno = ENOMEM, NULL));
 
-    /* ...save completion callback data */
-    vsp->cb = cb, vsp->cdata = cdata;
+    /* ...set jobs ring; completions may be reported by shared reactor instead of driver thread */
+    pthread_mutex_init(&vsp->lock, NULL);
+
+    if (vsp_ring_init(&vsp->ring, jobs, &vsp->lock, cb, cdata) < 0)
+    {
+        pthread_mutex_destroy(&vsp->lock);
+        free(vsp);
+        return NULL;
+    }
 
     /* ...initialize VSPM driver */
 #ifdef __VSPM_GEN3
@@ -730,80 +1265,188 @@ vsp_compositor_t * compositor_init(int w, int h, u32 ifmt, int W, int H, u32 ofm
         goto error;
     }
 
-    /* ...source pad setup - left + right cameras plane */
-    vsp_src_setup(&vsp->src_par[0], w, h, ifmt, w, h);
-    vsp_alpha_setup(&vsp->alpha_par[0], w, h, 1);
-#ifdef __VSPM_GEN3
-    vsp->src_par[0].alpha = &vsp->alpha_par[0];
-#else
-    vsp->src_par[0].alpha_blend = &vsp->alpha_par[0];
-#endif
+    /* ...save pipeline configuration */
+    vsp->w = w, vsp->h = h, vsp->format = ifmt;
+    vsp->W = W, vsp->H = H, vsp->ofmt = ofmt;
+    vsp->cw = cw, vsp->ch = ch;
 
-    /* ...source pad setup - front + center; exact copy of left + right plane */
-    memcpy(&vsp->src_par[1], &vsp->src_par[0], sizeof(VSP_SRC_T));
-    vsp_alpha_setup(&vsp->alpha_par[1], w, h, 0);
-#ifdef __VSPM_GEN3
-    vsp->src_par[1].alpha = &vsp->alpha_par[1];
-#else
-    vsp->src_par[1].alpha_blend = &vsp->alpha_par[1];
-#endif
+    /* ...prepare parameters sets of the jobs */
+    for (i = 0; i < vsp->ring.jobs; i++)
+    {
+        if (vsp_job_init(vsp, &vsp->job[i]) != 0)
+        {
+            TRACE(ERROR, _x("failed to initialize job #%d: %m"), i);
+            goto error;
+        }
+    }
 
-    /* ...car image pad setup; native ARGB */
-    vsp_src_setup(&vsp->src_par[2], cw, ch, ofmt, w, h);
-    vsp_alpha_setup(&vsp->alpha_par[2], -1, -1, 0);
-#ifdef __VSPM_GEN3
-    vsp->src_par[2].alpha = &vsp->alpha_par[2];
-#else
-    vsp->src_par[2].alpha_blend = &vsp->alpha_par[2];
-#endif
-    
-    /* ...destination pad setup */
-    vsp_dst_setup(&vsp->dst_par, W, H, ofmt);
+    TRACE(INIT, _b("VSPM compositor initialized: %d*%d[%d] -> %d*%d[%d], %d jobs"), w, h, ifmt, W, H, ofmt, jobs);
 
-    /* ...blending unit setup */
-    vsp->vsp_par.rpf_num = vsp_bru_setup(&vsp->bru_par, vsp->bld_par, &vsp->vir_par, w, h);
+    return vsp;
+
+error:
+    /* ...destroy display lists of initialized jobs */
+    for (i = 0; i < vsp->ring.jobs; i++)
+    {
+        if (vsp->job[i].dl)     vsp_mem_free(vsp->job[i].dl);
+    }
+
+    /* ...destroy memory */
+    vsp_ring_destroy(&vsp->ring);
+    free(vsp);
     
-    /* ...control structure setup */
-    vsp->ctrl_par.bru = &vsp->bru_par;
+    return NULL;
+}
 
-    /* ...setup VSP job parameters */
-    vsp->vsp_par.use_module = VSP_BRU_USE;
+/* ...precompile jobs for all combinations of pool buffers (camera and alpha sets hold two pools each) */
+int vsp_job_templates_init(vsp_compositor_t *vsp, vsp_mem_t **camera, int nc, vsp_mem_t **alpha, int na, vsp_mem_t **car, int ncar, vsp_mem_t **output, int no)
+{
+    vsp_mem_t     **pool;
+    vsp_mem_t      *input[9];
+    int             S = 1 + nc * na, N = S * S * ncar * no;
+    int             i, k, t;
+
+    /* ...templates can be created only once */
+    CHK_ERR(!vsp->tmpl, -(errno = EBUSY));
+    CHK_ERR(nc > 0 && na > 0 && ncar > 0 && no > 0, -(errno = EINVAL));
+
+    /* ...keep memory footprint reasonable; submission falls back to patching */
+    if (N > VSP_TEMPLATES_MAX)
+    {
+        TRACE(INIT, _b("too many buffers combinations (%d); job templates disabled"), N);
+        return 0;
+    }
+
+    /* ...save registered buffers */
+    CHK_ERR(pool = malloc((2 * nc + 2 * na + ncar + no) * sizeof(*pool)), -(errno = ENOMEM));
+    CHK_ERR(vsp->tmpl = calloc(N, sizeof(vsp_params_t)), (free(pool), -(errno = ENOMEM)));
+
+    vsp->pool[VSP_POOL_CAMERA_0] = pool, vsp->pool_num[VSP_POOL_CAMERA_0] = nc;
+    vsp->pool[VSP_POOL_CAMERA_1] = pool + nc, vsp->pool_num[VSP_POOL_CAMERA_1] = nc;
+    vsp->pool[VSP_POOL_ALPHA_0] = pool + 2 * nc, vsp->pool_num[VSP_POOL_ALPHA_0] = na;
+    vsp->pool[VSP_POOL_ALPHA_1] = pool + 2 * nc + na, vsp->pool_num[VSP_POOL_ALPHA_1] = na;
+    vsp->pool[VSP_POOL_CAR] = pool + 2 * nc + 2 * na, vsp->pool_num[VSP_POOL_CAR] = ncar;
+    vsp->pool[VSP_POOL_OUTPUT] = pool + 2 * nc + 2 * na + ncar, vsp->pool_num[VSP_POOL_OUTPUT] = no;
+    memcpy(vsp->pool[VSP_POOL_CAMERA_0], camera, 2 * nc * sizeof(*pool));
+    memcpy(vsp->pool[VSP_POOL_ALPHA_0], alpha, 2 * na * sizeof(*pool));
+    memcpy(vsp->pool[VSP_POOL_CAR], car, ncar * sizeof(*pool));
+    memcpy(vsp->pool[VSP_POOL_OUTPUT], output, no * sizeof(*pool));
+
+    /* ...mark position of each buffer in its pool */
+    for (k = 0; k < VSP_POOL_NUMBER; k++)
+    {
+        for (i = 0; i < vsp->pool_num[k]; i++)
+        {
+            vsp->pool[k][i]->index = i;
+        }
+    }
+
+    /* ...prepare parameters set for each combination (same key layout as in a lookup) */
+    for (t = 0; t < N; t++)
+    {
+        vsp_params_t   *par = &vsp->tmpl[t];
+        int             o = t % no, c = (t / no) % ncar, key = t / no / ncar;
+
+        memset(input, 0, sizeof(input));
+
+        for (k = 1; k >= 0; k--, key /= S)
+        {
+            if ((i = key % S) == 0)     continue;
+
+            input[2 * k] = input[2 * k + 1] = vsp->pool[VSP_POOL_CAMERA_0 + k][(i - 1) / na];
+            input[4 + 2 * k] = input[5 + 2 * k] = vsp->pool[VSP_POOL_ALPHA_0 + k][(i - 1) % na];
+        }
+
+        input[8] = vsp->pool[VSP_POOL_CAR][c];
+
+        CHK_API(vsp_params_init(vsp, par));
+        __vsp_params_bind(par, input, vsp->pool[VSP_POOL_OUTPUT][o]);
+    }
+
+    TRACE(INIT, _b("precompiled %d job templates (%u bytes)"), N, (u32)(N * sizeof(vsp_params_t)));
+
+    return 0;
+}
+
+/* ...alpha-planes upscaler initialization (w*h GREY plane to W*H GREY plane) */
+int vsp_scaler_init(vsp_compositor_t *vsp, int w, int h, int W, int H, vsp_callback_t cb)
+{
+    vsp_scaler_t   *scl;
+
+    /* ...allocate scaler data */
+    CHK_ERR(scl = calloc(1, sizeof(*scl)), -(errno = ENOMEM));
+    vsp->ring.scale_cb = cb;
+
+    /* ...allocate chroma planes of NV12 images (source is neutral grey) */
+    CHK_ERR(scl->chroma[0] = vsp_mem_alloc(w * h / 2), -(errno = ENOMEM));
+    CHK_ERR(scl->chroma[1] = vsp_mem_alloc(W * H / 2), -(errno = ENOMEM));
+    memset(vsp_mem_ptr(scl->chroma[0]), 0x80, w * h / 2);
+
+    /* ...source pad: alpha-plane as a luma of NV12 image; no color conversion */
+    scl->src_par.addr_c0 = __ADDR_CAST(scl->chroma[0]->hard_addr);
+    scl->src_par.stride = w;
+    scl->src_par.stride_c = w;
+    scl->src_par.width = w;
+    scl->src_par.height = h;
+    scl->src_par.format = VSP_IN_YUV420_SEMI_NV12;
+    scl->src_par.swap = VSP_SWAP_B | VSP_SWAP_W | VSP_SWAP_L | VSP_SWAP_LL;
+    scl->src_par.pwd = VSP_LAYER_PARENT;
+    scl->src_par.cipm = VSP_CIPM_BI_LINEAR;
+    scl->src_par.csc = VSP_CSC_OFF;
+    scl->src_par.iturbt = VSP_ITURBT_601;
+    scl->src_par.clrcng = VSP_FULL_COLOR;
+    scl->src_par.connect = VSP_UDS_USE;
+
+    /* ...bilinear upscaling (ratio is 4.12 fixed-point input/output) */
+    scl->uds_par.amd = VSP_AMD;
+    scl->uds_par.clip = VSP_CLIP_OFF;
+    scl->uds_par.alpha = VSP_ALPHA_OFF;
+    scl->uds_par.complement = VSP_COMPLEMENT_BIL;
+    scl->uds_par.x_ratio = (u16)((w << 12) / W);
+    scl->uds_par.y_ratio = (u16)((h << 12) / H);
+    scl->uds_par.connect = 0;
+
+    /* ...destination pad: full-resolution luma; chroma is discarded */
+    scl->dst_par.addr_c0 = __ADDR_CAST(scl->chroma[1]->hard_addr);
+    scl->dst_par.stride = W;
+    scl->dst_par.stride_c = W;
+    scl->dst_par.width = W;
+    scl->dst_par.height = H;
+    scl->dst_par.format = VSP_OUT_YUV420_SEMI_NV12;
+    scl->dst_par.swap = VSP_SWAP_B | VSP_SWAP_W | VSP_SWAP_L | VSP_SWAP_LL;
+    scl->dst_par.pxa = VSP_PAD_P;
+    scl->dst_par.csc = VSP_CSC_OFF;
+    scl->dst_par.iturbt = VSP_ITURBT_601;
+    scl->dst_par.clrcng = VSP_FULL_COLOR;
+
+    /* ...job parameters */
+    scl->ctrl_par.uds = &scl->uds_par;
+    scl->vsp_par.rpf_num = 1;
+    scl->vsp_par.use_module = VSP_UDS_USE;
 #ifdef __VSPM_GEN3
-    vsp->vsp_par.src_par[0] = &vsp->src_par[0];
-    vsp->vsp_par.src_par[1] = &vsp->src_par[1];
-    vsp->vsp_par.src_par[2] = &vsp->src_par[2];
+    scl->vsp_par.src_par[0] = &scl->src_par;
 #else
-    vsp->vsp_par.src1_par = &vsp->src_par[0];
-    vsp->vsp_par.src2_par = &vsp->src_par[1];
-    vsp->vsp_par.src3_par = &vsp->src_par[2];
+    scl->vsp_par.src1_par = &scl->src_par;
 #endif
-    vsp->vsp_par.dst_par = &vsp->dst_par;
-    vsp->vsp_par.ctrl_par = &vsp->ctrl_par;
+    scl->vsp_par.dst_par = &scl->dst_par;
+    scl->vsp_par.ctrl_par = &scl->ctrl_par;
 
 #ifdef __VSPM_GEN3
     /* ...allocate DL memory (size is hardcoded?) */
-    CHK_ERR(vsp->dl = vsp_mem_alloc((128 + 64 * 8) * 32/* 8 */), (errno = ENOMEM, NULL));
-	vsp->vsp_par.dl_par.hard_addr = __ADDR_CAST(vsp->dl->hard_addr);
-	vsp->vsp_par.dl_par.virt_addr = (void *)(uintptr_t)vsp->dl->user_virt_addr;
-	vsp->vsp_par.dl_par.tbl_num = 128 + 64 * 8;
-#endif
-
-    /* ...prepare job descriptor */
-#ifdef __VSPM_GEN3
-	vsp->vspm_ip.type = VSPM_TYPE_VSP_AUTO;
-	vsp->vspm_ip.par.vsp = &vsp->vsp_par;
+    CHK_ERR(scl->dl = vsp_mem_alloc((128 + 64 * 8) * 32/* 8 */), -(errno = ENOMEM));
+	scl->vsp_par.dl_par.hard_addr = __ADDR_CAST(scl->dl->hard_addr);
+	scl->vsp_par.dl_par.virt_addr = (void *)(uintptr_t)scl->dl->user_virt_addr;
+	scl->vsp_par.dl_par.tbl_num = 128 + 64 * 8;
+	scl->vspm_ip.type = VSPM_TYPE_VSP_AUTO;
+	scl->vspm_ip.par.vsp = &scl->vsp_par;
 #else
-	vsp->vspm_ip.uhType = VSPM_TYPE_VSP_AUTO;
-	vsp->vspm_ip.unionIpParam.ptVsp = &vsp->vsp_par;
+	scl->vspm_ip.uhType = VSPM_TYPE_VSP_AUTO;
+	scl->vspm_ip.unionIpParam.ptVsp = &scl->vsp_par;
 #endif
 
-    TRACE(INIT, _b("VSPM compositor initialized: %d*%d[%d] -> %d*%d[%d]"), w, h, ifmt, W, H, ofmt);
+    vsp->scl = scl;
 
-    return vsp;
+    TRACE(INIT, _b("alpha-planes upscaler initialized: %d*%d -> %d*%d"), w, h, W, H);
 
-error:
-    /* ...destroy memory */
-    free(vsp);
-    
-    return NULL;
+    return 0;
 }
@@ -34,12 +34,17 @@
 typedef struct vsp_compositor   vsp_compositor_t;
 typedef struct vsp_mem          vsp_mem_t;
 typedef struct vsp_dmabuf       vsp_dmabuf_t;
+typedef struct vsp_arena        vsp_arena_t;
 
 /*******************************************************************************
  * Compositor processing callback
  ******************************************************************************/
 
-typedef void (*vsp_callback_t)(void *data, int result);
+/* ...maximal number of compositor jobs in flight */
+#define VSP_JOBS_MAX                    4
+
+/* ...job completion callback (jobs are reported in submission order) */
+typedef void (*vsp_callback_t)(void *data, void *priv, int result);
 
 /*******************************************************************************
  * Public API
@@ -66,12 +71,21 @@ extern int vsp_dmabuf_fd(vsp_dmabuf_t *dmabuf);
 /* ...close DMA file-descriptor */
 extern void vsp_dmabuf_unexport(vsp_dmabuf_t *dmabuf);
 
+/* ...contiguous memory arena creation (subsequent allocations are carved from it) */
+extern vsp_arena_t * vsp_arena_create(u32 size);
+
+/* ...amount of memory carved from the arena */
+extern u32 vsp_arena_usage(vsp_arena_t *arena);
+
+/* ...arena destruction (memory is released along with the last chunk) */
+extern void vsp_arena_destroy(vsp_arena_t *arena);
+
 /*******************************************************************************
  * Compositor API
  ******************************************************************************/
 
-/* ...module initialization function */
-extern vsp_compositor_t * compositor_init(int w, int h, u32 ifmt, int W, int H, u32 ofmt, int cw, int ch, vsp_callback_t cb, void *cdata);
+/* ...module initialization function (jobs - number of jobs in flight) */
+extern vsp_compositor_t * compositor_init(int w, int h, u32 ifmt, int W, int H, u32 ofmt, int cw, int ch, int jobs, vsp_callback_t cb, void *cdata);
 
 /* ...module destruction */
 extern void compositor_destroy(vsp_compositor_t *vsp);
@@ -82,7 +96,16 @@ extern int vsp_allocate_buffers(int w, int h, u32 fmt, vsp_mem_t **output, int n
 /* ...export DMA file-descriptor representing contiguous block */
 extern int vsp_buffer_export(vsp_mem_t *mem, int w, int h, u32 format, int *dmafd, u32 *offset, u32 *stride);
 
-/* ...job submission */
-extern int vsp_job_submit(vsp_compositor_t *vsp, vsp_mem_t **input, vsp_mem_t *output);
+/* ...precompile jobs for all combinations of registered pool buffers */
+extern int vsp_job_templates_init(vsp_compositor_t *vsp, vsp_mem_t **camera, int nc, vsp_mem_t **alpha, int na, vsp_mem_t **car, int ncar, vsp_mem_t **output, int no);
+
+/* ...job submission (NULL camera plane disables the layer; car is a sprite with a bounding box) */
+extern int vsp_job_submit(vsp_compositor_t *vsp, vsp_mem_t **input, vsp_mem_t *output, const int *car, void *priv);
+
+/* ...alpha-planes upscaler initialization (completion callback receives compositor client data) */
+extern int vsp_scaler_init(vsp_compositor_t *vsp, int w, int h, int W, int H, vsp_callback_t cb);
+
+/* ...asynchronous alpha-plane upscaling (single job in flight) */
+extern int vsp_alpha_scale(vsp_compositor_t *vsp, vsp_mem_t *input, vsp_mem_t *output, void *priv);
 
 #endif  /* __UTEST_COMPOSITOR_H */
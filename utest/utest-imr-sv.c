@@ -40,6 +40,10 @@
 #include "utest-compositor.h"
 #include "utest-png.h"
 #include "utest-math.h"
+#include "utest-alpha.h"
+#include "utest-car.h"
+#include "utest-snapshot.h"
+#include "utest-pool.h"
 #include <linux/videodev2.h>
 
 /*******************************************************************************
@@ -52,6 +56,25 @@ extern char * imr_dev_name[];
 /* ...mesh data (tbd - move to track configuration) */
 extern char * __mesh_file_name;
 
+/* ...buffer pools depths and automatic sizing profile */
+extern int    __pool_depth[POOL_STAGES];
+extern char * __pool_profile;
+
+/* ...compositor output format (tbd - move to display configuration) */
+extern u32 __vsp_format;
+
+/* ...contiguous memory arena size in MB (0 - separate blocks) */
+extern int __vsp_arena_size;
+
+/* ...pending frames limit of latest-frame-wins mode (0 - disabled) */
+extern int __latest_depth;
+
+/* ...per-camera dispatch mode and frames matching window (ms) */
+extern int __camera_dispatch, __sync_window;
+
+/* ...camera stall timeout in ms (0 - watchdog disabled) */
+extern int __stall_timeout;
+
 /*******************************************************************************
  * Tracing configuration
  ******************************************************************************/
@@ -93,13 +116,36 @@ TRACE_TAG(DEBUG, 1);
 
 #define VSP_ALPHA_0                     VSP_ALPHA_RIGHT
 
-/* ...size of compositor buffers pool */
-#define VSP_POOL_SIZE                   2
+/* ...maximal size of compositor buffers pool (actual depths are runtime parameters) */
+#define VSP_POOL_SIZE                   POOL_DEPTH_MAX
+
+/* ...number of compositor jobs in flight */
+#define VSP_JOBS_NUMBER                 2
+
+/* ...compositor readiness flag: reduced alpha-planes of next job are not upscaled yet */
+#define SV_VSP_SCALE                    (1 << (VSP_NUMBER + 1))
+
+/* ...input readiness flag: camera engines have too many pending jobs */
+#define SV_INPUT_BACKLOG                (1 << (CAMERAS_NUMBER + 1))
+
+/* ...number of frames sets open at a time in per-camera dispatch mode */
+#define SV_SETS_NUMBER                  4
 
 /*******************************************************************************
  * Local types definitions
  ******************************************************************************/
 
+/* ...frames set descriptor */
+typedef struct sv_set
+{
+    /* ...reference timestamp (first frame of a set) */
+    u64                 pts;
+
+    /* ...visible cameras mask of a set */
+    u32                 mask;
+
+}   sv_set_t;
+
 typedef struct imr_sview
 {
     /* ...application callback */
@@ -120,8 +166,11 @@ typedef struct imr_sview
     /* ...pending VSP buffers queue (waiting for compositing) */
     GQueue              vsp_pending[VSP_NUMBER + CAMERAS_NUMBER];
 
-    /* ...currently processed VSP buffers */
-    GstBuffer          *vsp_buffers[VSP_NUMBER + CAMERAS_NUMBER];
+    /* ...VSP buffers of the jobs in flight */
+    GstBuffer          *vsp_buffers[VSP_JOBS_NUMBER][VSP_NUMBER + CAMERAS_NUMBER];
+
+    /* ...submitted compositor jobs counter and number of jobs in flight */
+    u32                 vsp_head, vsp_jobs;
 
     /* ...VSP queues access lock */
     pthread_mutex_t     vsp_lock;
@@ -144,11 +193,53 @@ typedef struct imr_sview
     /* ...last update sequence number */
     u32                 last_update;
 
+    /* ...buffer pools depths (camera planes, alpha planes, compositor output) */
+    int                 pool_size[POOL_STAGES];
+
+    /* ...stages latency statistics (automatic pools sizing) */
+    pool_stat_t        *pool_stat;
+
+    /* ...contiguous memory arena hosting all planes */
+    vsp_arena_t        *arena;
+
     /* ...IMR output buffers (inputs to the compositor) */
     vsp_mem_t          *camera_plane[2][VSP_POOL_SIZE];
 
-    /* ...alpha-planes IMR output buffers */
+    /* ...alpha-planes compositor buffers (single plane per set if rendered at reduced resolution) */
     vsp_mem_t          *alpha_plane[2][VSP_POOL_SIZE];
+
+    /* ...alpha-planes IMR output buffers (same as above unless rendered at reduced resolution) */
+    vsp_mem_t          *alpha_render[2][VSP_POOL_SIZE];
+
+    /* ...alpha-planes rendering scale factor */
+    int                 alpha_scale;
+
+    /* ...reduced planes held by compositor planes and the plane being upscaled */
+    vsp_mem_t          *alpha_scaled[2], *alpha_scaling;
+
+    /* ...alpha-planes areas rendered since last clearing (x0, y0, x1, y1) */
+    int                 alpha_dirty[2][VSP_POOL_SIZE][4];
+
+    /* ...alpha-masks cache */
+    alpha_cache_t      *alpha_cache;
+
+    /* ...cached masks of staged view (alpha-planes are not rendered) */
+    alpha_mask_t       *alpha_hit;
+
+    /* ...masks of staged view being recorded */
+    alpha_mask_t       *alpha_rec;
+
+    /* ...rendered masks set pending compression (planes and areas are kept until next update) */
+    alpha_mask_t       *alpha_done;
+    vsp_mem_t          *alpha_src[ALPHA_MASK_PLANES];
+    int                 alpha_box[ALPHA_MASK_PLANES][4];
+
+    /* ...masks set is being compressed by background thread */
+    int                 alpha_busy;
+
+    /* ...masks compression thread and its wake-up condition */
+    pthread_t           alpha_thread;
+    pthread_cond_t      alpha_wait;
     
     /* ...alpha plane, car model buffers - tbd */
     vsp_mem_t          *alpha_input[1], *car_plane[2];
@@ -162,14 +253,29 @@ typedef struct imr_sview
     /* ...active alpha-plane output buffers */
     GstBuffer          *alpha_active[4];
     
+    /* ...staged alpha-plane output buffers (rendered for a pending view) */
+    GstBuffer          *alpha_next[4];
+
     /* ...car image buffers */
     GstBuffer          *car_buffer[2];
 
     /* ...active car-model buffer */
     GstBuffer          *car_active;
 
-    /* ...image to use for car rendering */
-    char               *car_image;
+    /* ...staged car-model buffer */
+    GstBuffer          *car_next;
+
+    /* ...car sprites bounding boxes within car image (per car buffer) */
+    int                 car_bbox[2][4];
+
+    /* ...staged view components readiness flag (alpha-planes and car image) */
+    u32                 update_pending;
+
+    /* ...active/staged view visible cameras mask */
+    u32                 camera_mask, camera_mask_next;
+
+    /* ...decoded car images cache */
+    car_cache_t        *car_cache;
 
     /* ...mesh configuration update thread handle */
     pthread_t           mesh_thread;
@@ -185,6 +291,36 @@ typedef struct imr_sview
 
     /* ...input (camera) buffers readiness flag */
     u32                 input_ready;
+
+    /* ...maximal number of pending input sets (latest-frame-wins mode; 0 - unbounded) */
+    int                 input_depth;
+
+    /* ...number of input sets dropped */
+    u32                 input_dropped;
+
+    /* ...per-camera dispatch mode (engines start on frame arrival) */
+    int                 dispatch;
+
+    /* ...frames matching window of per-camera dispatch (nanoseconds) */
+    u64                 window;
+
+    /* ...descriptors of the sets cameras can join */
+    sv_set_t            sets[SV_SETS_NUMBER];
+
+    /* ...sequence number of a set next camera frame is assigned to */
+    u32                 camera_seq[CAMERAS_NUMBER];
+
+    /* ...last frame of a camera (repeated for the sets camera has missed) */
+    GstBuffer          *camera_last[CAMERAS_NUMBER];
+
+    /* ...camera stall timeout (microseconds; 0 - watchdog disabled) */
+    u32                 stall_timeout;
+
+    /* ...cameras last frames arrival time (microseconds) */
+    u32                 camera_ts[CAMERAS_NUMBER];
+
+    /* ...stalled cameras mask */
+    u32                 camera_stalled;
     
     /* ...VSP buffers readiness flag */
     u32                 vsp_ready;
@@ -255,8 +391,17 @@ typedef struct imr_sview
 /* ...car model update condition  */
 #define APP_FLAG_CAR_UPDATE             (1 << 14)
 
-/* ...buffer clearing mask */
-#define APP_FLAG_CLEAR_BUFFER           (1 << 16)
+/* ...staged configuration latched at a frame boundary */
+#define APP_FLAG_VIEW_SWITCH            (1 << 15)
+
+/* ...cameras watchdog is armed (first frame received) */
+#define APP_FLAG_WATCHDOG               (1 << 17)
+
+/* ...rendered masks set is handed to compression thread */
+#define APP_FLAG_ALPHA_COMPRESS         (1 << 18)
+
+/* ...snapshot writer (output accessor has no engine handle) */
+static snapshot_writer_t   *__snapshot;
 
 /*******************************************************************************
  * Mesh processing
@@ -277,30 +422,86 @@ static __mat4x4 __v_matrix = {
  * Compositor interface
  ******************************************************************************/
 
+/* ...upscale reduced alpha-planes of next job; return non-zero if job is deferred (called with VSP lock held) */
+static int __vsp_alpha_upscale(imr_sview_t *sv)
+{
+    int     p;
+
+    /* ...compositor reads planes rendered by the engines */
+    if (sv->alpha_scale <= 1)   return 0;
+
+    for (p = 0; p < 2; p++)
+    {
+        GstBuffer  *a = g_queue_peek_head(&sv->vsp_pending[VSP_ALPHA_0 + 2 * p]);
+        GstBuffer  *b = g_queue_peek_head(&sv->vsp_pending[VSP_ALPHA_0 + 2 * p + 1]);
+        vsp_mem_t  *mem;
+
+        /* ...hidden set has no alpha-plane */
+        if (a == NULL && (a = b) == NULL)   continue;
+
+        /* ...skip the set if compositor plane holds upscaled copy of the buffer already */
+        if ((mem = sv->alpha_render[p][gst_buffer_get_imr_meta(a)->index]) == sv->alpha_scaled[p])    continue;
+
+        /* ...hold composition until the plane is upscaled */
+        sv->vsp_ready |= SV_VSP_SCALE;
+
+        /* ...compositor plane is read by the jobs in flight; start once they are completed */
+        if (sv->vsp_jobs > 0)   return 1;
+
+        sv->alpha_scaling = mem;
+
+        if (vsp_alpha_scale(sv->vsp, mem, sv->alpha_plane[p][0], (void *)(intptr_t)p) == 0)     return 1;
+
+        /* ...compose with stale plane rather than stall the pipeline */
+        TRACE(ERROR, _x("alpha-%d: upscaling failed: %m"), p);
+        sv->alpha_scaled[p] = mem, sv->alpha_scaling = NULL;
+        sv->vsp_ready &= ~SV_VSP_SCALE;
+    }
+
+    return 0;
+}
+
 /* ...trigger surround-view scene composition if possible (called with VSP lock held) */
 static int __vsp_compose(imr_sview_t *sv)
 {
     vsp_mem_t      *mem[VSP_NUMBER];
-    GstBuffer     **buf = sv->vsp_buffers;
+    GstBuffer     **buf = sv->vsp_buffers[sv->vsp_head % VSP_JOBS_NUMBER];
     int             i;
 
     /* ...all buffers must be available */
     BUG(sv->vsp_ready != 0, _x("invalid state: %x"), sv->vsp_ready);
+
+    /* ...alpha-planes of the job may need upscaling first */
+    if (__vsp_alpha_upscale(sv))    return 0;
     
     /* ...collect memory descriptors */
     for (i = 0; i < VSP_NUMBER; i++)
     {
         GQueue         *queue = &sv->vsp_pending[i];
         GstBuffer      *buffer = g_queue_pop_head(queue);
-        imr_meta_t     *meta = gst_buffer_get_imr_meta(buffer);
 
         /* ...save buffer in the VSP processing array (keep ownership) */
-        buf[i] = buffer, mem[i] = meta->priv;
+        buf[i] = buffer, mem[i] = (buffer ? gst_buffer_get_imr_meta(buffer)->priv : NULL);
 
         /* ...check if queue gets empty */
         (g_queue_is_empty(queue) ? sv->vsp_ready |= 1 << i : 0);
     }
 
+    /* ...hidden cameras have no alpha-plane; disable layer if both cameras of a set are hidden */
+    for (i = 0; i < CAMERAS_NUMBER; i += 2)
+    {
+        vsp_mem_t     **a = &mem[VSP_ALPHA_0 + i];
+
+        if (a[0] == NULL && a[1] == NULL)
+        {
+            mem[i] = mem[i + 1] = NULL;
+        }
+        else
+        {
+            (a[0] == NULL ? a[0] = a[1] : (a[1] == NULL ? a[1] = a[0] : NULL));
+        }
+    }
+
     /* ...make sure memory buffers are same for cameras */
     BUG(mem[VSP_CAMERA_LEFT] != mem[VSP_CAMERA_RIGHT], _x("left/right buffers mismatch: %p != %p"), mem[VSP_CAMERA_LEFT], mem[VSP_CAMERA_RIGHT]);
     BUG(mem[VSP_CAMERA_FRONT] != mem[VSP_CAMERA_REAR], _x("front/rear buffers mismatch: %p != %p"), mem[VSP_CAMERA_FRONT], mem[VSP_CAMERA_REAR]);
@@ -316,24 +517,26 @@ static int __vsp_compose(imr_sview_t *sv)
         buf[VSP_NUMBER + i] = g_queue_pop_head(&sv->vsp_pending[VSP_NUMBER + i]);
     }
 
-    /* ...mark buffer processing is ongoing */
-    sv->vsp_ready |= 1 << VSP_NUMBER;
+    /* ...output buffer is held until display returns it */
+    pool_stat_get(sv->pool_stat, POOL_OUTPUT, gst_buffer_get_imr_meta(buf[VSP_OUTPUT])->index);
+
+    /* ...submit a job to compositor (buffers are returned in completion callback) */
+    CHK_ERR(vsp_job_submit(sv->vsp, mem, mem[VSP_OUTPUT], sv->car_bbox[gst_buffer_get_imr_meta(buf[VSP_CAR])->index], buf) == 0, -(errno = EBADFD));
 
-    /* ...submit a job to compositor */
-    CHK_ERR(vsp_job_submit(sv->vsp, mem, mem[VSP_OUTPUT]) == 0, -(errno = EBADFD));
+    /* ...block composition if all jobs are in flight */
+    sv->vsp_head++;
+    (++sv->vsp_jobs == VSP_JOBS_NUMBER ? sv->vsp_ready |= 1 << VSP_NUMBER : 0);
 
-    TRACE(DEBUG, _b("job submitted..."));
+    TRACE(DEBUG, _b("job submitted (in flight: %u)"), sv->vsp_jobs);
 
     return 0;
 }
 
-/* ...submit particular buffer to a compositor (called with a VSP lock held) */
+/* ...submit particular buffer to a compositor (NULL marks unused layer; called with a VSP lock held) */
 static int __vsp_submit_buffer(imr_sview_t *sv, int i, GstBuffer *buffer)
 {
-    imr_meta_t     *meta = gst_buffer_get_imr_meta(buffer);
-
     /* ...place buffer into pending IMR queue */
-    g_queue_push_tail(&sv->vsp_pending[i], gst_buffer_ref(buffer));
+    g_queue_push_tail(&sv->vsp_pending[i], (buffer ? gst_buffer_ref(buffer) : NULL));
 
     /* ...submit processing task if all buffers are available */
     if ((sv->vsp_ready &= ~(1 << i)) == 0)
@@ -342,17 +545,20 @@ static int __vsp_submit_buffer(imr_sview_t *sv, int i, GstBuffer *buffer)
     }
     else
     {
-        TRACE(DEBUG, _b("buffer #<%d,%d> submitted: render-mask: %X"), i, meta->index, sv->vsp_ready);
+        TRACE(DEBUG, _b("buffer #<%d,%d> submitted: render-mask: %X"), i, (buffer ? gst_buffer_get_imr_meta(buffer)->index : -1), sv->vsp_ready);
     }
 
     return 0;
 }
 
-/* ...compositor processing callback */
-static void vsp_callback(void *data, int result)
+/* ...submission of held input sets (defined along with input job processing) */
+static inline int __sv_input_resume(imr_sview_t *sv);
+
+/* ...compositor processing callback (called in jobs submission order) */
+static void vsp_callback(void *data, void *priv, int result)
 {
     imr_sview_t    *sv = data;
-    GstBuffer     **buf = sv->vsp_buffers;
+    GstBuffer     **buf = priv;
     u32             sequence = sv->sequence_out;
     int             i;
     
@@ -362,39 +568,13 @@ static void vsp_callback(void *data, int result)
     /* ...update output buffers sequence counter */
     sv->sequence_out = sequence + 1;
 
-    /* ...test if we need to update current alpha- and car-model buffers */
-    if ((sv->flags & APP_FLAG_UPDATE) && (sequence == sv->last_update))
+    /* ...test if first frame of a new view has been composed */
+    if ((sv->flags & APP_FLAG_VIEW_SWITCH) && (sequence == sv->last_update))
     {
-        /* ...latch new buffers for subsequent jobs - tbd */ 
-        for (i = 0; i < CAMERAS_NUMBER; i++)
-        {
-            sv->alpha_active[i] = gst_buffer_ref(buf[VSP_ALPHA_0 + i]);
-        }
-
-        /* ...latch active car buffer */
-        sv->car_active = gst_buffer_ref(buf[VSP_CAR]);
-
-        /* ...we might have submitted some number of jobs already */
-        pthread_mutex_lock(&sv->vsp_lock);
-
-        /* ...submit remaining number of jobs (compositing is now disabled) */
-        while (++sequence != sv->sequence)
-        {
-            /* ...submit alpha buffers */
-            for (i = 0; i < CAMERAS_NUMBER; i++)
-            {
-                __vsp_submit_buffer(sv, VSP_ALPHA_0 + i, sv->alpha_active[i]);
-            }
-
-            /* ...submit car buffers */
-            __vsp_submit_buffer(sv, VSP_CAR, sv->car_active);
-        }
-
-        /* ...unlock VSP queues */
-        pthread_mutex_unlock(&sv->vsp_lock);
+        /* ...all engines have switched; allow next update sequence */
+        sv->flags &= ~(APP_FLAG_UPDATE | APP_FLAG_VIEW_SWITCH);
 
-        /* ...clear update sequence flag */
-        sv->flags &= ~APP_FLAG_UPDATE;
+        TRACE(DEBUG, _b("view switch completed: sequence=%u"), sequence);
     }
 
     /* ...release the lock before passing control to the application */
@@ -403,16 +583,38 @@ static void vsp_callback(void *data, int result)
     /* ...should I pass auxiliary buffers as well? ---everything at once? - tbd */
     sv->cb->ready(sv->cdata, buf);
 
+    /* ...camera plane of the first engine returns to the pool */
+    if (buf[0])
+    {
+        pool_stat_put(sv->pool_stat, POOL_CAMERA, gst_buffer_get_imr_meta(buf[0])->index);
+    }
+
     /* ...release all processed buffers */
     for (i = 0; i < VSP_NUMBER + CAMERAS_NUMBER; i++)
     {
-        gst_buffer_unref(buf[i]);
+        (buf[i] ? gst_buffer_unref(buf[i]) : 0);
+    }
+
+    /* ...released camera planes let engines take pending jobs; resume held input */
+    if (sv->input_depth)
+    {
+        pthread_mutex_lock(&sv->lock);
+
+        if (__sv_input_resume(sv) < 0)
+        {
+            TRACE(ERROR, _x("failed to resume input: %m"));
+        }
+
+        pthread_mutex_unlock(&sv->lock);
     }
 
     /* ...lock VSP data access */
     pthread_mutex_lock(&sv->vsp_lock);
 
-    /* ...clear compositing flag and submit another job if possible */
+    /* ...release job slot; deferred upscaling may start once all jobs are completed */
+    (--sv->vsp_jobs == 0 && !sv->alpha_scaling ? sv->vsp_ready &= ~SV_VSP_SCALE : 0);
+
+    /* ...submit another job if possible */
     if ((sv->vsp_ready &= ~(1 << VSP_NUMBER)) == 0)
     {
         __vsp_compose(sv);
@@ -422,94 +624,423 @@ static void vsp_callback(void *data, int result)
     pthread_mutex_unlock(&sv->vsp_lock);
 }
 
+/* ...alpha-plane upscaling completion callback */
+static void vsp_scale_callback(void *data, void *priv, int result)
+{
+    imr_sview_t    *sv = data;
+    int             p = (int)(intptr_t)priv;
+
+    if (result != 0)
+    {
+        TRACE(ERROR, _x("alpha-%d: upscaling failed: %d"), p, result);
+    }
+
+    /* ...lock VSP data access */
+    pthread_mutex_lock(&sv->vsp_lock);
+
+    /* ...failed job leaves stale plane; compose anyway rather than stall the pipeline */
+    sv->alpha_scaled[p] = sv->alpha_scaling, sv->alpha_scaling = NULL;
+
+    /* ...resume composition (next set is checked the same way) */
+    if ((sv->vsp_ready &= ~SV_VSP_SCALE) == 0)
+    {
+        __vsp_compose(sv);
+    }
+
+    /* ...unlock VSP data access */
+    pthread_mutex_unlock(&sv->vsp_lock);
+}
+
 /*******************************************************************************
  * Input job processing interface
  ******************************************************************************/
 
 extern __scalar     __sphere_gain;
 
-/* ...setup IMR engines for a processing (called with an application lock held) */
-static int __sv_map_setup(imr_sview_t *sv)
+/* ...prepare IMR engines configurations (called without a lock; no concurrent updates) */
+static int __sv_map_setup(imr_sview_t *sv, imr_cfg_t **cfg, u32 *mask, alpha_mask_t **hit)
 {
     __vec2     *uv[CAMERAS_NUMBER], *a[CAMERAS_NUMBER];
     __vec3     *xy[CAMERAS_NUMBER];
     int         n[CAMERAS_NUMBER];
     int         i;
     
+    /* ...check if alpha-planes of a view are cached */
+    *hit = alpha_cache_lookup(sv->alpha_cache, sv->step);
+
     /* ...calculate projection transformations of the points (single-threaded?) */
     CHK_API(mesh_translate(sv->mesh, uv, a, xy, n, sv->pvm_matrix, __sphere_gain));
 
     /* ...setup individual engines */
-    for (i = 0; i < CAMERAS_NUMBER; i++)
+    for (i = 0, *mask = 0; i < CAMERAS_NUMBER; i++)
     {
         TRACE(INFO, _b("engine-%d mesh setup: n = %d"), i, n[i]);
 
         /* ...create new configuration - tbd - not that simple */
-        CHK_ERR(sv->imr_cfg[i + IMR_CAMERA_0] = imr_cfg_create(sv->imr, i + IMR_CAMERA_0, uv[i][0], xy[i][0], n[i]), -errno);
-        CHK_ERR(sv->imr_cfg[i + IMR_ALPHA_0] = imr_cfg_create(sv->imr, i + IMR_ALPHA_0, a[i][0], xy[i][0], n[i]), -errno);
+        CHK_ERR(cfg[i + IMR_CAMERA_0] = imr_cfg_create(sv->imr, i + IMR_CAMERA_0, uv[i][0], xy[i][0], n[i]), -errno);
+        if (*hit)
+        {
+            /* ...alpha-plane is taken from the cache */
+            cfg[i + IMR_ALPHA_0] = NULL;
+        }
+        else
+        {
+            CHK_ERR(cfg[i + IMR_ALPHA_0] = imr_cfg_create(sv->imr, i + IMR_ALPHA_0, a[i][0], xy[i][0], n[i]), -errno);
+        }
+
+        /* ...camera is visible if its mesh has any primitives after clipping */
+        (imr_cfg_num(cfg[i + IMR_CAMERA_0]) > 0 ? *mask |= 1 << i : 0);
 
         TRACE(INFO, _b("engine-%d configured"), i);
     }
 
+    TRACE(INFO, _b("visible cameras mask: %X, alpha-masks %s"), *mask, (*hit ? "cached" : "rendered"));
+
     return 0;
 }
 
-/* ...submit new input job to IMR engines (function called with a lock held) */
-static int __sv_job_submit(imr_sview_t *sv)
+/* ...latch staged view configuration (called with a lock held) */
+static inline void __sv_view_switch(imr_sview_t *sv, GstBuffer **release)
+{
+    int     i;
+
+    /* ...protect sequence numbers accessed by engine preparation hook */
+    pthread_mutex_lock(&sv->vsp_lock);
+
+    /* ...swap alpha-planes (old buffers are released by the caller) */
+    for (i = 0; i < CAMERAS_NUMBER; i++)
+    {
+        release[i] = sv->alpha_active[i];
+        sv->alpha_active[i] = sv->alpha_next[i], sv->alpha_next[i] = NULL;
+    }
+
+    /* ...swap car-model buffer */
+    release[CAMERAS_NUMBER] = sv->car_active;
+    sv->car_active = sv->car_next, sv->car_next = NULL;
+
+    /* ...latch visible cameras set */
+    sv->camera_mask = sv->camera_mask_next;
+
+    /* ...masks of a view are compressed once it is live */
+    if (sv->alpha_done)
+    {
+        sv->flags |= APP_FLAG_ALPHA_COMPRESS;
+        pthread_cond_signal(&sv->alpha_wait);
+    }
+
+    /* ...cameras engines apply new configuration starting from current job */
+    sv->last_update = sv->sequence;
+    sv->flags |= APP_FLAG_VIEW_SWITCH;
+
+    pthread_mutex_unlock(&sv->vsp_lock);
+
+    TRACE(DEBUG, _b("view switch: sequence=%u"), sv->last_update);
+}
+
+/* ...update camera engines backlog readiness flag (called with a lock held) */
+static inline void __sv_backlog_update(imr_sview_t *sv)
+{
+    int     i, k, n;
+
+    /* ...engines queues are unbounded unless latest-frame-wins mode is active */
+    if (sv->input_depth == 0)   return;
+
+    for (i = n = 0; i < CAMERAS_NUMBER; i++)
+    {
+        k = imr_engine_pending(sv->imr, IMR_CAMERA_0 + i);
+        (k > n ? n = k : 0);
+    }
+
+    (n >= sv->input_depth ? (sv->input_ready |= SV_INPUT_BACKLOG) : (sv->input_ready &= ~SV_INPUT_BACKLOG));
+}
+
+/* ...replace last frame of a camera (called with a lock held) */
+static inline void __sv_camera_last(imr_sview_t *sv, int i, GstBuffer *buffer)
+{
+    (sv->camera_last[i] ? gst_buffer_unref(sv->camera_last[i]) : 0);
+    sv->camera_last[i] = gst_buffer_ref(buffer);
+}
+
+/* ...register camera frame arrival; return stalled cameras mask (called with a lock held) */
+static u32 __sv_watchdog(imr_sview_t *sv, int i)
+{
+    u32     ts = __get_time_usec();
+    u32     stalled = 0;
+    int     j;
+
+    /* ...watchdog is disabled */
+    if (sv->stall_timeout == 0)     return 0;
+
+    /* ...cameras are not stalled until the very first frame arrives */
+    if ((sv->flags & APP_FLAG_WATCHDOG) == 0)
+    {
+        for (j = 0; j < CAMERAS_NUMBER; j++)
+        {
+            sv->camera_ts[j] = ts;
+        }
+
+        sv->flags |= APP_FLAG_WATCHDOG;
+    }
+
+    sv->camera_ts[i] = ts;
+
+    /* ...camera has stalled if it has not delivered a frame within a timeout */
+    for (j = 0; j < CAMERAS_NUMBER; j++)
+    {
+        (ts - sv->camera_ts[j] > sv->stall_timeout ? stalled |= 1 << j : 0);
+    }
+
+    if (stalled != sv->camera_stalled)
+    {
+        TRACE(INFO, _b("stalled cameras: %X -> %X"), sv->camera_stalled, stalled);
+        sv->camera_stalled = stalled;
+    }
+
+    return stalled;
+}
+
+/* ...open new frames set: latch view, submit alpha-planes and car-model (called with a lock held) */
+static int __sv_set_open(imr_sview_t *sv, u64 pts)
 {
     u32         sequence = sv->sequence;
-    GstBuffer  *buffer[CAMERAS_NUMBER];
+    sv_set_t   *set = &sv->sets[sequence % SV_SETS_NUMBER];
+    GstBuffer  *release[CAMERAS_NUMBER + 1] = { NULL };
     int         i;
 
+    /* ...switch to staged view configuration at the frame boundary */
+    if ((sv->flags & (APP_FLAG_UPDATE | APP_FLAG_VIEW_SWITCH)) == APP_FLAG_UPDATE && sv->update_pending == 0)
+    {
+        __sv_view_switch(sv, release);
+    }
+
+    /* ...save set descriptor for the cameras joining it */
+    set->pts = pts, set->mask = sv->camera_mask;
+
+    /* ...plane of a stalled camera without a frame to repeat is blanked */
+    for (i = 0; i < CAMERAS_NUMBER; i++)
+    {
+        ((sv->camera_stalled & (1 << i)) && !sv->camera_last[i] ? set->mask &= ~(1 << i) : 0);
+    }
+
+    /* ...increment sequence number */
+    sv->sequence = sequence + 1;
+
+    /* ...select alpha-plane and car-model buffers for a given job */
+    pthread_mutex_lock(&sv->vsp_lock);
+
+    /* ...submit all alpha-buffers of active view */
+    for (i = 0; i < CAMERAS_NUMBER; i++)
+    {
+        /* ...make sure we have active alpha buffer */
+        BUG(!sv->alpha_active[i], _x("camera-%d: alpha-buffer is not ready"), i);
+
+        /* ...pass current buffer for use with camera plane (hidden camera has no layer) */
+        __vsp_submit_buffer(sv, VSP_ALPHA_0 + i, (set->mask & (1 << i) ? sv->alpha_active[i] : NULL));
+    }
+
+    /* ...submit car model buffer */
+    __vsp_submit_buffer(sv, VSP_CAR, sv->car_active);
+
+    /* ...unlock VSP queues */
+    pthread_mutex_unlock(&sv->vsp_lock);
+
+    /* ...release buffers of previous view (outside of VSP lock) */
+    for (i = 0; i < CAMERAS_NUMBER + 1; i++)
+    {
+        (release[i] ? gst_buffer_unref(release[i]) : 0);
+    }
+
+    TRACE(DEBUG, _b("set opened: sequence=%u"), sequence);
+
+    return 0;
+}
+
+/* ...submit camera frame to its engine as a part of next set (called with a lock held) */
+static int __sv_camera_push(imr_sview_t *sv, int i, GstBuffer *buffer)
+{
+    u32     sequence = sv->camera_seq[i]++;
+
+    /* ...input buffer is held in the global pending queue until a set is composed */
+    pthread_mutex_lock(&sv->vsp_lock);
+    g_queue_push_tail(&sv->vsp_pending[VSP_NUMBER + i], (buffer ? gst_buffer_ref(buffer) : NULL));
+    pthread_mutex_unlock(&sv->vsp_lock);
+
+    /* ...submit to an engine for processing (increases refcount); hidden or blanked camera bypasses it */
+    if (buffer && (sv->sets[sequence % SV_SETS_NUMBER].mask & (1 << i)))
+    {
+        return CHK_API(imr_engine_push_buffer(sv->imr, i, buffer));
+    }
+    else
+    {
+        return CHK_API(imr_engine_skip(sv->imr, i));
+    }
+}
+
+/* ...submit new input job to IMR engines (function called with a lock held) */
+static int __sv_job_submit(imr_sview_t *sv)
+{
+    GstBuffer  *buffer;
+    int         i, r;
+
     /* ...all buffers must be available */
     BUG(sv->input_ready != 0, _x("invalid state: %x"), sv->input_ready);
 
+    /* ...all cameras join a set at once */
+    CHK_API(__sv_set_open(sv, GST_CLOCK_TIME_NONE));
+
     /* ...submit the buffers to the engines */
     for (i = 0; i < CAMERAS_NUMBER; i++)
     {
         /* ...get buffer from the head of the pending input queue */
-        buffer[i] = g_queue_pop_head(&sv->input[i]);
+        buffer = g_queue_pop_head(&sv->input[i]);
+
+        if (buffer == NULL)
+        {
+            /* ...stalled camera repeats its last frame (or its plane is blanked) */
+            r = __sv_camera_push(sv, i, sv->camera_last[i]);
+        }
+        else
+        {
+            /* ...keep last frame of a camera if watchdog is enabled */
+            (sv->stall_timeout ? __sv_camera_last(sv, i, buffer) : 0);
+
+            /* ...pass buffer to an engine (and release ownership) */
+            r = __sv_camera_push(sv, i, buffer);
+            gst_buffer_unref(buffer);
+        }
+
+        CHK_API(r);
 
-        /* ...submit to an engine for processing (increases refcount) */
-        CHK_API(imr_engine_push_buffer(sv->imr, i, buffer[i]));
-        
         /* ...check if queue gets empty */
         (g_queue_is_empty(&sv->input[i]) ? sv->input_ready |= 1 << i : 0);
     }
 
-    /* ...increment sequence number */
-    sv->sequence = sequence + 1;
+    /* ...hold further input if engines have enough work queued */
+    __sv_backlog_update(sv);
 
-    /* ...select alpha-plane and car-model buffers for a given job */
-    pthread_mutex_lock(&sv->vsp_lock);
+    TRACE(DEBUG, _b("job submitted: sequence=%u"), sv->sequence - 1);
+
+    return 0;
+}
+
+/* ...drop the oldest pending input set (called with a lock held) */
+static inline void __sv_input_drop(imr_sview_t *sv)
+{
+    int     i;
+
+    for (i = 0; i < CAMERAS_NUMBER; i++)
+    {
+        GstBuffer  *buffer = g_queue_pop_head(&sv->input[i]);
+
+        (buffer ? gst_buffer_unref(buffer) : 0);
+    }
+
+    sv->input_dropped++;
+
+    TRACE(DEBUG, _b("input set dropped (total: %u)"), sv->input_dropped);
+}
+
+/* ...submit held input sets once engines have drained (called with a lock held) */
+static inline int __sv_input_resume(imr_sview_t *sv)
+{
+    __sv_backlog_update(sv);
+
+    while (sv->input_ready == 0)
+    {
+        CHK_API(__sv_job_submit(sv));
+    }
+
+    return 0;
+}
 
-    /* ...submit alpha / car buffers if no active update sequence is ongoing */
-    if ((sv->flags & APP_FLAG_UPDATE) == 0)
+/* ...dispatch camera frame on arrival; sets are joined by the compositor (called with a lock held) */
+static int __sv_camera_dispatch(imr_sview_t *sv, int i, GstBuffer *buffer)
+{
+    GstClockTime    ts = GST_BUFFER_PTS(buffer);
+    u32             stalled = __sv_watchdog(sv, i);
+    sv_set_t       *set;
+    u32             s;
+    int             j;
+
+    /* ...find the oldest open set frame belongs to; sets camera has missed repeat its last frame */
+    for (s = sv->camera_seq[i]; s != sv->sequence; s++)
     {
-        /* ...submit all alpha-buffers */
-        for (i = 0; i < CAMERAS_NUMBER; i++)
+        set = &sv->sets[s % SV_SETS_NUMBER];
+
+        /* ...without timestamps frames are matched by arrival order */
+        if (sv->window == 0 || !GST_CLOCK_TIME_IS_VALID(ts) || !GST_CLOCK_TIME_IS_VALID(set->pts))
+        {
+            break;
+        }
+
+        /* ...frame captured before the set is stale */
+        if (ts + sv->window < set->pts)
         {
-            /* ...make sure we have active alpha buffer */
-            BUG(!sv->alpha_active[i], _x("camera-%d: alpha-buffer is not ready"), i);
+            goto drop;
+        }
 
-            /* ...pass current buffer for use with camera plane */
-            __vsp_submit_buffer(sv, VSP_ALPHA_0 + i, sv->alpha_active[i]);
+        /* ...frame is within the set window */
+        if (ts <= set->pts + sv->window)
+        {
+            break;
         }
 
-        /* ...submit car model buffer */
-        __vsp_submit_buffer(sv, VSP_CAR, sv->car_active);
+        TRACE(DEBUG, _b("camera-%d: set #%u missed"), i, s);
+
+        CHK_API(__sv_camera_push(sv, i, sv->camera_last[i]));
     }
 
-    /* ...save input buffers in the global pending queue (move ownership) */
-    for (i = 0; i < CAMERAS_NUMBER; i++)
+    /* ...frame opens a new set */
+    if (s == sv->sequence)
     {
-        g_queue_push_tail(&sv->vsp_pending[VSP_NUMBER + i], buffer[i]);
+        /* ...re-evaluate engines backlog */
+        __sv_backlog_update(sv);
+
+        /* ...first set is opened once every live camera has delivered a frame */
+        for (j = 0; j < CAMERAS_NUMBER && (j == i || sv->camera_last[j] || (stalled & (1 << j))); j++)
+            ;
+
+        /* ...input is held until view is ready and engines have drained */
+        if (j < CAMERAS_NUMBER || (sv->input_ready & ~((1 << CAMERAS_NUMBER) - 1)))
+        {
+            goto drop;
+        }
+
+        /* ...cameras lagging behind by all open sets repeat their last frames */
+        for (j = 0; j < CAMERAS_NUMBER; j++)
+        {
+            while (sv->sequence - sv->camera_seq[j] >= SV_SETS_NUMBER)
+            {
+                TRACE(DEBUG, _b("camera-%d: set #%u forced"), j, sv->camera_seq[j]);
+
+                CHK_API(__sv_camera_push(sv, j, sv->camera_last[j]));
+            }
+        }
+
+        CHK_API(__sv_set_open(sv, ts));
+
+        /* ...stalled cameras do not hold the sets; they repeat last frame or get blanked */
+        for (j = 0; j < CAMERAS_NUMBER; j++)
+        {
+            while ((stalled & (1 << j)) && sv->camera_seq[j] != sv->sequence)
+            {
+                CHK_API(__sv_camera_push(sv, j, sv->camera_last[j]));
+            }
+        }
     }
 
-    /* ...unlock VSP queues */
-    pthread_mutex_unlock(&sv->vsp_lock);
+    /* ...start camera engine right away */
+    __sv_camera_last(sv, i, buffer);
 
-    TRACE(DEBUG, _b("job submitted: sequence=%u"), sequence);
+    return CHK_API(__sv_camera_push(sv, i, buffer));
+
+drop:
+    /* ...frame is not processed but may still be repeated */
+    __sv_camera_last(sv, i, buffer);
+
+    sv->input_dropped++;
+
+    TRACE(DEBUG, _b("camera-%d: frame dropped (total: %u)"), i, sv->input_dropped);
 
     return 0;
 }
@@ -521,11 +1052,106 @@ static inline int __sv_alpha_update(imr_sview_t *sv)
     
     for (i = 0; i < CAMERAS_NUMBER; i++)
     {
-        /* ...make sure there is no active buffer */
-        BUG(sv->alpha_active[i], _x("alpha-%d: invalid state: %p"), i, sv->alpha_active[i]);
+        /* ...make sure there is no staged buffer */
+        BUG(sv->alpha_next[i], _x("alpha-%d: invalid state: %p"), i, sv->alpha_next[i]);
+
+        /* ...push alpha-plane input buffer (rendered into inactive buffer) */
+        if ((sv->camera_mask_next & (1 << i)) && !sv->alpha_hit)
+        {
+            CHK_API(imr_engine_push_buffer(sv->imr, IMR_ALPHA_0 + i, sv->alpha_buffer));
+        }
+        else
+        {
+            /* ...hidden camera or cached mask; keep engine buffers in step with the set */
+            CHK_API(imr_engine_skip(sv->imr, IMR_ALPHA_0 + i));
+        }
+    }
+
+    return 0;
+}
+
+/* ...compress rendered masks set and insert it into the cache (called without a lock) */
+static void __sv_alpha_compress(imr_sview_t *sv, alpha_mask_t *mask, vsp_mem_t **src, int (*box)[4])
+{
+    int     p;
+
+    /* ...read planes from uncached memory outside of completion path */
+    for (p = 0; p < ALPHA_MASK_PLANES; p++)
+    {
+        if (alpha_mask_encode(mask, p, vsp_mem_ptr(src[p]), box[p]) != 0)
+        {
+            TRACE(ERROR, _x("alpha-%d: failed to record mask: %m"), p);
+            alpha_mask_destroy(mask);
+            return;
+        }
+    }
+
+    alpha_cache_insert(sv->alpha_cache, mask);
+}
+
+/* ...masks compression thread (keeps compression and storage off the view-change path) */
+static void * alpha_compress_thread(void *arg)
+{
+    imr_sview_t     *sv = arg;
+    alpha_mask_t    *done;
+    vsp_mem_t       *src[ALPHA_MASK_PLANES];
+    int              box[ALPHA_MASK_PLANES][4];
+
+    thread_placement(THREAD_MESH);
 
-        /* ...push alpha-plane input buffer (use sequence id of next job to submit) */
-        CHK_API(imr_engine_push_buffer(sv->imr, IMR_ALPHA_0 + i, sv->alpha_buffer));
+    pthread_mutex_lock(&sv->lock);
+
+    while (1)
+    {
+        /* ...wait for a masks set (pending set is compressed before termination) */
+        while ((sv->flags & (APP_FLAG_ALPHA_COMPRESS | APP_FLAG_EOS)) == 0)
+        {
+            pthread_cond_wait(&sv->alpha_wait, &sv->lock);
+        }
+
+        if (!(sv->flags & APP_FLAG_ALPHA_COMPRESS))     break;
+
+        /* ...take masks set (planes are not overwritten until compression is done) */
+        done = sv->alpha_done, sv->alpha_done = NULL;
+        memcpy(src, sv->alpha_src, sizeof(src));
+        memcpy(box, sv->alpha_box, sizeof(box));
+        sv->flags &= ~APP_FLAG_ALPHA_COMPRESS, sv->alpha_busy = 1;
+
+        pthread_mutex_unlock(&sv->lock);
+
+        /* ...compress masks and persist them */
+        (done ? __sv_alpha_compress(sv, done, src, box), 0 : 0);
+        alpha_cache_flush(sv->alpha_cache);
+
+        pthread_mutex_lock(&sv->lock);
+
+        /* ...resume mesh thread waiting for the planes */
+        sv->alpha_busy = 0;
+        pthread_cond_broadcast(&sv->alpha_wait);
+    }
+
+    pthread_mutex_unlock(&sv->lock);
+
+    TRACE(INIT, _b("masks compression thread terminated"));
+
+    return NULL;
+}
+
+/* ...staged view component is ready (called with a lock held) */
+static inline int __sv_update_ready(imr_sview_t *sv, u32 mask)
+{
+    /* ...clear component readiness flag */
+    if ((sv->update_pending &= ~mask) != 0)     return 0;
+
+    TRACE(DEBUG, _b("view update staged: sequence=%u"), sv->sequence);
+
+    /* ...view is switched with next input job; force it if input was held */
+    if (sv->input_ready & (1 << CAMERAS_NUMBER))
+    {
+        if ((sv->input_ready &= ~(1 << CAMERAS_NUMBER)) == 0)
+        {
+            return __sv_job_submit(sv);
+        }
     }
 
     return 0;
@@ -565,12 +1191,61 @@ static void __sv_matrix_update(imr_sview_t *sv, int rx, int ry, int rz, int ts)
     sv->scl_acc = (sv->scl_acc < 0.75 ? 0.75 : (sv->scl_acc > 1.5 ? 1.5 : sv->scl_acc));
 }
 
+/* ...add valid step displaced from current one into prefetch list */
+static inline int __sv_car_step(int (*list)[3], int n, const int *step, int d0, int d1, int d2)
+{
+    extern int  __steps[3];
+    int         s[3] = { step[0] + d0, (step[1] + d1 + __steps[1]) % __steps[1], step[2] + d2 };
+    int         k;
+
+    /* ...tilt and scale are saturated; azimuth wraps around */
+    if ((u32)s[0] >= (u32)__steps[0] || (u32)s[2] >= (u32)__steps[2])  return n;
+    if (n == CAR_PREFETCH_MAX || !memcmp(s, step, sizeof(s)))           return n;
+
+    for (k = 0; k < n; k++)
+    {
+        if (!memcmp(s, list[k], sizeof(s)))     return n;
+    }
+
+    return memcpy(list[n], s, sizeof(s)), n + 1;
+}
+
+/* ...prefetch car images in a direction of motion (called with a lock held) */
+static inline void __sv_car_prefetch(imr_sview_t *sv, const int *prev, const int *step)
+{
+    extern int  __steps[3];
+    int         list[CAR_PREFETCH_MAX][3];
+    int         d[3], e[3];
+    int         k, n;
+
+    /* ...direction of motion per axis (shortest way for azimuth) */
+    for (k = 0; k < 3; k++)
+    {
+        d[k] = step[k] - prev[k];
+        (k == 1 && 2 * d[k] > __steps[1] ? d[k] -= __steps[1] : 0);
+        (k == 1 && 2 * d[k] < -__steps[1] ? d[k] += __steps[1] : 0);
+        d[k] = (d[k] > 0) - (d[k] < 0);
+    }
+
+    /* ...extrapolate motion two steps ahead */
+    n = __sv_car_step(list, 0, step, d[0], d[1], d[2]);
+    n = __sv_car_step(list, n, step, 2 * d[0], 2 * d[1], 2 * d[2]);
+
+    /* ...then immediate neighbours, forward direction first */
+    for (k = 0; k < 3; k++)
+    {
+        memset(e, 0, sizeof(e)), e[k] = (d[k] ? d[k] : 1);
+        n = __sv_car_step(list, n, step, e[0], e[1], e[2]);
+        n = __sv_car_step(list, n, step, -e[0], -e[1], -e[2]);
+    }
+
+    car_cache_prefetch(sv->car_cache, list, n);
+}
+
 static inline int __sv_map_changed(imr_sview_t *sv)
 {
     int                 step[3];
-    char                buffer[256];
     extern int          __steps[3];
-    extern char        *__model;
 
     /* ...check out if we crossed the boundaries */
     step[0] = (int)floor(sv->rot_acc[0] / -80 * __steps[0] + 0.5);
@@ -590,6 +1265,9 @@ static inline int __sv_map_changed(imr_sview_t *sv)
     
     /* ...ignore update if we have same steps array */
     if (!memcmp(step, sv->step, sizeof(sv->step)))  return 0;
+
+    /* ...start decoding of car images we are likely to need next */
+    __sv_car_prefetch(sv, sv->step, step);
     
     /* ...update current steps */
     memcpy(sv->step, step, sizeof(sv->step));
@@ -599,16 +1277,7 @@ static inline int __sv_map_changed(imr_sview_t *sv)
     sv->rot_acc[2] = 360.0 * step[1] / __steps[1];
     sv->scl_acc = 0.75 + 0.75 * step[2] / __steps[2];
 
-    /* ...drop previous image */
-    (sv->car_image ? free(sv->car_image) : 0);
-
-    /* ...prepare filename */
-    snprintf(buffer, sizeof(buffer), "%s-%d-%d-%d.png", __model, step[0], step[1], step[2]);
-
-    /* ...make a copy of string */
-    sv->car_image = strdup(buffer);
-
-    TRACE(INFO, _b("select image '%s'"), sv->car_image);
+    TRACE(INFO, _b("select image %d/%d/%d"), step[0], step[1], step[2]);
 
     return 1;
 }
@@ -617,6 +1286,12 @@ static inline int __sv_map_changed(imr_sview_t *sv)
 static void * mesh_update_thread(void *arg)
 {
     imr_sview_t     *sv = arg;
+    imr_cfg_t       *cfg[IMR_NUMBER];
+    alpha_mask_t    *hit;
+    u32              mask;
+    int              r;
+
+    thread_placement(THREAD_MESH);
 
     /* ...protect intenal app data */
     pthread_mutex_lock(&sv->lock);
@@ -637,28 +1312,60 @@ static void * mesh_update_thread(void *arg)
             goto out;
         }
         
-        /* ...update IMR mappings */
-        if (__sv_map_setup(sv) != 0)
+        /* ...masks of a view superseded before going live are compressed anyway */
+        if (sv->alpha_done)
+        {
+            sv->flags |= APP_FLAG_ALPHA_COMPRESS;
+            pthread_cond_signal(&sv->alpha_wait);
+        }
+
+        /* ...release the lock - input keeps flowing with current view */
+        pthread_mutex_unlock(&sv->lock);
+
+        /* ...calculate IMR mappings for a new view */
+        r = __sv_map_setup(sv, cfg, &mask, &hit);
+
+        /* ...reacquire application lock */
+        pthread_mutex_lock(&sv->lock);
+
+        if (r != 0)
         {
             TRACE(ERROR, _x("maps update failed: %m"));
             goto out;
         }
 
+        /* ...publish configurations (accessed from engine preparation hook) */
+        pthread_mutex_lock(&sv->vsp_lock);
+        memcpy(sv->imr_cfg, cfg, sizeof(sv->imr_cfg));
+        pthread_mutex_unlock(&sv->vsp_lock);
+
+        /* ...stage visible cameras set */
+        sv->camera_mask_next = mask;
+
+        /* ...masks of previous view are not needed anymore */
+        if (sv->alpha_hit)
+        {
+            alpha_cache_release(sv->alpha_cache, sv->alpha_hit);
+        }
+
+        /* ...use cached alpha-masks or record rendered ones (failure is not fatal) */
+        sv->alpha_hit = hit;
+        sv->alpha_rec = (hit ? NULL : alpha_mask_create(sv->alpha_cache, sv->step));
+
         /* ...clear mesh update command condition */
         sv->flags &= ~APP_FLAG_MAP_UPDATE;
 
-        /* ...start alpha-plane processing */
-        __sv_alpha_update(sv);
+        /* ...planes being compressed must not be overwritten (normally done long ago) */
+        while ((sv->flags & APP_FLAG_ALPHA_COMPRESS) || sv->alpha_busy)
+        {
+            pthread_cond_wait(&sv->alpha_wait, &sv->lock);
+        }
 
-        /* ...re-enable input */
-        if ((sv->input_ready &= ~(1 << CAMERAS_NUMBER)) == 0)
+        /* ...start alpha-plane processing */
+        if (__sv_alpha_update(sv) != 0)
         {
-            /* ...force job submission */
-            if (__sv_job_submit(sv) != 0)
-            {
-                TRACE(ERROR, _b("job submission failed: %m"));
-                goto out;
-            }
+            TRACE(ERROR, _x("alpha-plane update failed: %m"));
+            goto out;
         }
     }
 
@@ -674,8 +1381,6 @@ out:
 /* ...process mesh rotation (called with a lock held) */
 static int __sv_map_update(imr_sview_t *sv)
 {
-    int     i;
-
     /* ...ignore update request if one is started */
     if (sv->flags & APP_FLAG_UPDATE)       return 0;
 
@@ -704,27 +1409,12 @@ static int __sv_map_update(imr_sview_t *sv)
     /* ...initiate point-of-view update sequence */
     sv->flags ^= APP_FLAG_UPDATE | APP_FLAG_MAP_UPDATE | APP_FLAG_CAR_UPDATE;
 
-    /* ...latch sequence number of next job that will have updated configuration */
-    sv->last_update = sv->sequence;
-
-    /* ...force alpha-planes update */
-    for (i = 0; i < CAMERAS_NUMBER; i++)
-    {
-        GstBuffer  *buffer = sv->alpha_active[i];
-        
-        /* ...update alpha-planes on next invocation - tbd */
-        sv->sequence_imr[IMR_ALPHA_0 + i] = sv->last_update;
-
-        /* ...drop active alpha-buffer as needed */
-        (buffer ? gst_buffer_unref(buffer), sv->alpha_active[i] = NULL : 0);
-    }
+    /* ...wait for all alpha-planes and car image of a new view */
+    sv->update_pending = (1 << (CAMERAS_NUMBER + 1)) - 1;
 
-    /* ...disable input path for a duration of update sequence (tbd) */
-    sv->input_ready |= (1 << CAMERAS_NUMBER);
+    /* ...hold input path until very first view is ready */
+    (!sv->car_active ? sv->input_ready |= (1 << CAMERAS_NUMBER) : 0);
 
-    /* ...drop car-model buffers as needed */
-    (sv->car_active ? gst_buffer_unref(sv->car_active), sv->car_active = NULL : 0);
-    
     TRACE(DEBUG, _b("trigger update sequence"));
 
     /* ...kick update threads */
@@ -753,8 +1443,9 @@ static inline int sv_map_init(imr_sview_t *sv, int W, int H)
     pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
     pthread_attr_setstacksize(&attr, 128 << 10);
 
-    /* ...create mesh update thread */
-    r = pthread_create(&sv->mesh_thread, &attr, mesh_update_thread, sv);
+    /* ...create mesh update and masks compression threads */
+    pthread_cond_init(&sv->alpha_wait, NULL);
+    ((r = pthread_create(&sv->mesh_thread, &attr, mesh_update_thread, sv)) == 0 ? r = pthread_create(&sv->alpha_thread, &attr, alpha_compress_thread, sv) : 0);
     pthread_attr_destroy(&attr);
     CHK_API(r);
 
@@ -803,6 +1494,7 @@ static int imr_buffer_allocate(void *cdata, int i, GstBuffer *buffer)
     imr_meta_t     *meta = gst_buffer_get_imr_meta(buffer);
     int             w = meta->width, h = meta->height, format = meta->format;
     int             j = meta->index;
+    vsp_mem_t      *mem;
     int             dmafd[GST_VIDEO_MAX_PLANES];
     u32             offset[GST_VIDEO_MAX_PLANES];
     u32             stride[GST_VIDEO_MAX_PLANES];
@@ -810,7 +1502,7 @@ static int imr_buffer_allocate(void *cdata, int i, GstBuffer *buffer)
     if (i < IMR_ALPHA_0)
     {
         /* ...camera plane */
-        BUG((u32)j >= (u32)VSP_POOL_SIZE, _x("invalid buffer: <%d,%d>"), i, j);
+        BUG((u32)j >= (u32)sv->pool_size[POOL_CAMERA], _x("invalid buffer: <%d,%d>"), i, j);
 
         /* ...save pointer to the memory buffer */
         meta->priv = sv->camera_plane[i >> 1][j];
@@ -818,17 +1510,20 @@ static int imr_buffer_allocate(void *cdata, int i, GstBuffer *buffer)
     else
     {
         /* ...alpha plane */
-        BUG((u32)j >= (u32)VSP_POOL_SIZE, _x("invalid buffer: <%d,%d>"), i, j);
+        BUG((u32)j >= (u32)sv->pool_size[POOL_ALPHA], _x("invalid buffer: <%d,%d>"), i, j);
 
-        /* ...save pointer to the memory buffer */
-        meta->priv = sv->alpha_plane[(i - IMR_ALPHA_0) >> 1][j];
+        /* ...save pointer to the memory buffer (compositor reads full-resolution plane) */
+        meta->priv = sv->alpha_plane[(i - IMR_ALPHA_0) >> 1][sv->alpha_scale > 1 ? 0 : j];
     }
 
+    /* ...engine renders into its own buffer */
+    mem = (i < IMR_ALPHA_0 ? meta->priv : sv->alpha_render[(i - IMR_ALPHA_0) >> 1][j]);
+
     /* ...assign camera buffer pointer */
-    meta->buf->data = vsp_mem_ptr(meta->priv);
+    meta->buf->data = vsp_mem_ptr(mem);
 
     /* ...create DMA buffers for a memory chunk */
-    CHK_API(vsp_buffer_export(meta->priv, w, h, __pixfmt_gst_to_v4l2(format), dmafd, offset, stride));
+    CHK_API(vsp_buffer_export(mem, w, h, __pixfmt_gst_to_v4l2(format), dmafd, offset, stride));
 
     /* ...create external texture (for debugging purposes only? - tbd) */
     CHK_ERR(meta->priv2 = texture_create(w, h, format, dmafd, offset, stride), -errno);
@@ -841,13 +1536,40 @@ static int imr_buffer_allocate(void *cdata, int i, GstBuffer *buffer)
     return 0;
 }
 
+/* ...clear dirty area of alpha-plane */
+static inline void __sv_alpha_clear(vsp_mem_t *mem, int w, int h, int *box)
+{
+    u8     *p = (u8 *)vsp_mem_ptr(mem) + box[1] * w + box[0];
+    int     n = box[2] - box[0];
+    int     k;
+
+    /* ...plane is GREY with no padding; clear rows of the box only */
+    for (k = box[1]; k < box[3]; k++, p += w)
+    {
+        memset(p, 0, n);
+    }
+
+    /* ...mark area is empty */
+    box[0] = w, box[1] = h, box[2] = box[3] = 0;
+}
+
+/* ...extend dirty area of alpha-plane */
+static inline void __sv_alpha_dirty(int *box, const int *b)
+{
+    /* ...ignore empty rectangles */
+    if (b[0] >= b[2] || b[1] >= b[3])   return;
+
+    (b[0] < box[0] ? box[0] = b[0] : 0), (b[1] < box[1] ? box[1] = b[1] : 0);
+    (b[2] > box[2] ? box[2] = b[2] : 0), (b[3] > box[3] ? box[3] = b[3] : 0);
+}
+
 /* ...buffer preparation callback */
 static int imr_buffer_prepare(void *cdata, int i, GstBuffer *buffer)
 {
     imr_sview_t    *sv = cdata;
     imr_meta_t     *meta = gst_buffer_get_imr_meta(buffer);
-    vsp_mem_t      *mem = meta->priv;
     int             j = meta->index;
+    int             bbox[4] = { 0, 0, 0, 0 };
     u32             sequence;
     
     /* ...protect internal data */
@@ -856,14 +1578,17 @@ static int imr_buffer_prepare(void *cdata, int i, GstBuffer *buffer)
     /* ...latch current per-engine sequence number */
     sequence = sv->sequence_imr[i];
 
-    /* ...setup engine if required */
-    if ((sv->flags & APP_FLAG_UPDATE) && (sequence == sv->last_update))
+    /* ...setup engine if required (alpha-planes are rendered ahead of a switch) */
+    if (i < IMR_ALPHA_0 ? (sv->flags & APP_FLAG_VIEW_SWITCH) && (sequence == sv->last_update) : sv->imr_cfg[i] != NULL)
     {
         imr_cfg_t  *cfg = sv->imr_cfg[i];
         
         /* ...configuration must be available */
         BUG(cfg == NULL, _x("imr-%d: no active configuration"), i);
             
+        /* ...save destination area of alpha-plane rendering */
+        (i >= IMR_ALPHA_0 ? memcpy(bbox, imr_cfg_bbox(cfg), sizeof(bbox)) : NULL);
+
         /* ...set new configuration (and release it) */
         imr_cfg_apply(sv->imr, i, cfg);
         imr_cfg_destroy(cfg);
@@ -874,30 +1599,88 @@ static int imr_buffer_prepare(void *cdata, int i, GstBuffer *buffer)
     /* ...update sequence number */
     sv->sequence_imr[i] = sequence + 1;    
 
+    /* ...upscaled copy of re-rendered alpha-plane gets stale */
+    if (i >= IMR_ALPHA_0 && sv->alpha_scaled[(i - IMR_ALPHA_0) >> 1] == sv->alpha_render[(i - IMR_ALPHA_0) >> 1][j])
+    {
+        sv->alpha_scaled[(i - IMR_ALPHA_0) >> 1] = NULL;
+    }
+
+    /* ...first camera engine paces the pipeline; its planes residence time sizes camera pool */
+    if (i == 0)
+    {
+        pool_stat_frame(sv->pool_stat);
+        pool_stat_get(sv->pool_stat, POOL_CAMERA, j);
+    }
+
     /* ...unlock internal data */
     pthread_mutex_unlock(&sv->vsp_lock);
 
     /* ...cleanup alpha-buffer (when it's a first buffer in a set) */
     if (i >= IMR_ALPHA_0)
     {
-        u32     mask = (APP_FLAG_CLEAR_BUFFER << (((i - IMR_ALPHA_0) >> 1) + j * 2 + 2));
+        u32     mask = (1 << (((i - IMR_ALPHA_0) >> 1) + j * 2));
+        u32     set = 3 << ((i - IMR_ALPHA_0) & ~1);
+        int    *box = sv->alpha_dirty[(i - IMR_ALPHA_0) >> 1][j];
+        vsp_mem_t  *mem = sv->alpha_render[(i - IMR_ALPHA_0) >> 1][j];
 
         /* ...camera-buffer preparation; reset memory if we didn't do that already */
-        if (((sv->imr_flags ^= mask) & mask) != 0)
+        if (((sv->imr_flags ^= mask) & mask) == 0)
+        {
+            /* ...second buffer submitted; do not clear anything */
+            TRACE(DEBUG, _b("<%d,%d>: no clear"), i, j);
+        }
+        else if ((sv->camera_mask_next & set) == 0)
         {
-            memset(vsp_mem_ptr(mem), 0, vsp_mem_size(mem));
-            TRACE(DEBUG, _b("<%d,%d>: clear done (size=%u, addr=%p)"), i, j, vsp_mem_size(mem), vsp_mem_ptr(mem));
+            /* ...plane is not used by staged view */
+            TRACE(DEBUG, _b("<%d,%d>: hidden set, no clear"), i, j);
         }
         else
         {
-            /* ...second buffer submitted; do not clear anything */
-            TRACE(DEBUG, _b("<%d,%d>: no clear"), i, j);
+            /* ...clear only the area touched by previous rendering into this buffer */
+            TRACE(DEBUG, _b("<%d,%d>: clear (%d,%d)-(%d,%d) (addr=%p)"), i, j, box[0], box[1], box[2], box[3], vsp_mem_ptr(mem));
+            __sv_alpha_clear(mem, meta->width, meta->height, box);
+
+            /* ...fill plane from the cache (engines are bypassed) */
+            if (sv->alpha_hit && alpha_mask_decode(sv->alpha_hit, (i - IMR_ALPHA_0) >> 1, vsp_mem_ptr(mem), box) != 0)
+            {
+                TRACE(ERROR, _x("<%d,%d>: corrupted alpha-mask"), i, j);
+            }
         }
+
+        /* ...account area to be rendered by this engine */
+        __sv_alpha_dirty(box, bbox);
     }
 
     return 0;
 }
 
+/* ...save rendered alpha-plane of a set for compression (called with a lock held) */
+static inline void __sv_alpha_record(imr_sview_t *sv, int p, imr_meta_t *meta)
+{
+    int     i;
+
+    /* ...plane content is not touched until next update; compression is left to the background thread */
+    sv->alpha_src[p] = sv->alpha_render[p][meta->index];
+
+    /* ...hidden set contributes an empty plane */
+    if (sv->camera_mask_next & (3 << (2 * p)))
+    {
+        memcpy(sv->alpha_box[p], sv->alpha_dirty[p][meta->index], sizeof(sv->alpha_box[p]));
+    }
+    else
+    {
+        memset(sv->alpha_box[p], 0, sizeof(sv->alpha_box[p]));
+    }
+
+    /* ...set is complete once all planes are rendered */
+    for (i = 0; i < CAMERAS_NUMBER; i++)
+    {
+        if (!sv->alpha_next[i])     return;
+    }
+
+    sv->alpha_done = sv->alpha_rec, sv->alpha_rec = NULL;
+}
+
 /* ...output buffer callback */
 static int imr_buffer_process(void *cdata, int i, GstBuffer *buffer)
 {
@@ -908,6 +1691,31 @@ static int imr_buffer_process(void *cdata, int i, GstBuffer *buffer)
     
     TRACE(DEBUG, _b("imr-buffer <%d:%d> ready: %p (refcount=%d)"), i, j, buffer, GST_MINI_OBJECT_REFCOUNT(buffer));
 
+    /* ...alpha-planes are staged until the view switch */
+    if (i >= IMR_ALPHA_0)
+    {
+        pthread_mutex_lock(&sv->lock);
+
+        /* ...there must be single pending alpha-plane per engine */
+        BUG(sv->alpha_next[i - IMR_ALPHA_0], _x("imr-%d: invalid state"), i);
+
+        /* ...save buffer (add reference) */
+        sv->alpha_next[i - IMR_ALPHA_0] = gst_buffer_ref(buffer);
+
+        /* ...record the set once both engines have rendered it */
+        if (sv->alpha_rec && sv->alpha_next[(i - IMR_ALPHA_0) ^ 1])
+        {
+            __sv_alpha_record(sv, (i - IMR_ALPHA_0) >> 1, meta);
+        }
+
+        /* ...mark component is ready (reduced plane is upscaled by the compositor on first use) */
+        r = __sv_update_ready(sv, 1 << (i - IMR_ALPHA_0));
+
+        pthread_mutex_unlock(&sv->lock);
+
+        return CHK_API(r);
+    }
+
     /* ...lock VSP data access */
     pthread_mutex_lock(&sv->vsp_lock);
 
@@ -938,6 +1746,9 @@ static gboolean __vsp_buffer_dispose(GstMiniObject *obj)
     imr_sview_t     *sv = (imr_sview_t *)buffer->pool;
     gboolean        destroy = FALSE;
 
+    /* ...update output buffer residence time */
+    pool_stat_put(sv->pool_stat, POOL_OUTPUT, gst_buffer_get_imr_meta(buffer)->index);
+
     /* ...lock VSP data access */
     pthread_mutex_lock(&sv->vsp_lock);
     
@@ -954,6 +1765,16 @@ static gboolean __vsp_buffer_dispose(GstMiniObject *obj)
  * Runtime initialization
  ******************************************************************************/
 
+/* ...FNV-1a hash of configuration data */
+static inline u32 __fnv_hash(u32 h, const void *data, int size)
+{
+    const u8   *p = data;
+
+    while (size--)  h = (h ^ *p++) * 16777619U;
+
+    return h;
+}
+
 /* ...alpha input buffer disposal hook (called from a context of IMR thread) - function not needed at all? - tbd */
 static gboolean __alpha_buffer_dispose(GstMiniObject *obj)
 {
@@ -976,8 +1797,11 @@ static gboolean __alpha_buffer_dispose(GstMiniObject *obj)
 }
 
 /* ...alpha-plane processing initialization */
-static inline int sv_alpha_setup(imr_sview_t *sv, int W, int H)
+static inline int sv_alpha_setup(imr_sview_t *sv, int W, int H, __vec4 shadow)
 {
+    extern int      __alpha_scale;
+    int             w = W / __alpha_scale, h = H / __alpha_scale;
+    int             n = (__alpha_scale > 1 ? 1 : sv->pool_size[POOL_ALPHA]);
     int             format = GST_VIDEO_FORMAT_GRAY8;
     u8             *alpha;
     GstBuffer      *buffer;
@@ -1010,17 +1834,60 @@ static inline int sv_alpha_setup(imr_sview_t *sv, int W, int H)
     /* ...save buffer custom data */
     (sv->alpha_buffer = buffer)->pool = (void *)sv;
 
-    /* ...allocate two sets of alpha-planes for each bundle */
-    CHK_API(vsp_allocate_buffers(W, H, V4L2_PIX_FMT_GREY, &sv->alpha_plane[0][0], 2 * VSP_POOL_SIZE));
+    /* ...allocate compositor alpha-planes for each bundle (single upscaling target if reduced) */
+    for (i = 0, sv->alpha_scale = __alpha_scale; i < 2; i++)
+    {
+        CHK_API(vsp_allocate_buffers(W, H, V4L2_PIX_FMT_GREY, sv->alpha_plane[i], n));
+    }
+
+    /* ...reduced-resolution planes are rendered separately and upscaled by VSP */
+    if (__alpha_scale > 1)
+    {
+        for (i = 0; i < 2; i++)
+        {
+            CHK_API(vsp_allocate_buffers(w, h, V4L2_PIX_FMT_GREY, sv->alpha_render[i], sv->pool_size[POOL_ALPHA]));
+        }
+
+        CHK_API(vsp_scaler_init(sv->vsp, w, h, W, H, vsp_scale_callback));
+    }
+    else
+    {
+        memcpy(sv->alpha_render, sv->alpha_plane, sizeof(sv->alpha_render));
+    }
+
+    /* ...initial content is undefined; mark entire planes dirty */
+    for (i = 0; i < 2 * VSP_POOL_SIZE; i++)
+    {
+        int    *box = sv->alpha_dirty[0][i];
+
+        box[0] = box[1] = 0, box[2] = w, box[3] = h;
+    }
+
+    /* ...create alpha-masks cache (masks depend on mesh, shadow region, steps and sphere gain only) */
+    if (1)
+    {
+        extern int          __steps[3];
+        extern __scalar     __sphere_gain;
+        extern char        *__alpha_cache_dir;
+        u32                 tag;
+
+        tag = __fnv_hash(2166136261U, __mesh_file_name, strlen(__mesh_file_name));
+        tag = __fnv_hash(tag, shadow, sizeof(__vec4));
+        tag = __fnv_hash(tag, __steps, sizeof(__steps));
+        tag = __fnv_hash(tag, &__sphere_gain, sizeof(__sphere_gain));
+        tag = __fnv_hash(tag, &__alpha_scale, sizeof(__alpha_scale));
+
+        CHK_ERR(sv->alpha_cache = alpha_cache_create(w, h, __alpha_cache_dir, tag), -errno);
+    }
 
     /* ...setup IMR engines */
     for (i = 0; i < CAMERAS_NUMBER; i++)
     {
-        /* ...setup IMR engine (request two buffers) */
-        CHK_API(imr_setup(sv->imr, IMR_ALPHA_0 + i, 256, 1, W, H, format, format, VSP_POOL_SIZE));
+        /* ...setup IMR engine (request a pool of alpha-planes; single-line input is passed by pointer) */
+        CHK_API(imr_setup(sv->imr, IMR_ALPHA_0 + i, 256, 1, w, h, format, format, sv->pool_size[POOL_ALPHA], 0));
     }
 
-    TRACE(INIT, _b("alpha-plane set up"));
+    TRACE(INIT, _b("alpha-plane set up: %d*%d"), w, h);
 
     return 0;
 }
@@ -1051,25 +1918,20 @@ static gboolean __car_buffer_dispose(GstMiniObject *obj)
 }
 
 /* ...load car buffer with image */
-static int sv_car_buffer_load(imr_sview_t *sv, GstBuffer *buffer, const char *path)
+static int sv_car_buffer_load(imr_sview_t *sv, GstBuffer *buffer, const int *step)
 {
     imr_meta_t     *meta = gst_buffer_get_imr_meta(buffer);
-    int             format = meta->format;
-    int             w = meta->width, h = meta->height;
     void           *data = vsp_mem_ptr(meta->priv);
     u32             t0, t1;
 
-    /* ...make sure we have a sane path pointer */
-    CHK_ERR(path, -(errno = EINVAL));
-    
     t0 = __get_time_usec();
     
-    /* ...load PNG image into corresponding car plane */
-    CHK_API(create_png(path, &w, &h, &format, &data));
+    /* ...copy cropped sprite into corresponding car plane (decode on cache miss) */
+    CHK_API(car_cache_load(sv->car_cache, step, data, sv->car_bbox[meta->index]));
 
     t1 = __get_time_usec();
     
-    TRACE(INFO, _b("car-buffer ready: '%s' (time: %u)"), path, (u32)(t1 - t0));
+    TRACE(INFO, _b("car-buffer ready: %d/%d/%d (time: %u)"), step[0], step[1], step[2], (u32)(t1 - t0));
 
     return 0;
 }
@@ -1079,12 +1941,15 @@ static void * car_update_thread(void *arg)
 {
     imr_sview_t     *sv = arg;
 
+    thread_placement(THREAD_CAR);
+
     /* ...protect internal data access */
     pthread_mutex_lock(&sv->lock);
     
     /* ...wait for update event */
     while (1)
     {
+        int     step[3];
         int     m;
         
         /* ...wait for car model update flag */
@@ -1106,11 +1971,14 @@ static void * car_update_thread(void *arg)
         /* ...toggle buffers immediately */
         sv->flags ^= APP_FLAG_SET_INDEX;
 
+        /* ...latch view step (not changed until update sequence completes) */
+        memcpy(step, sv->step, sizeof(step));
+
         /* ...release internal data lock */
         pthread_mutex_unlock(&sv->lock);
 
-        /* ...load car model (name is pretty fake) */
-        if (sv_car_buffer_load(sv, sv->car_buffer[m], sv->car_image) != 0)
+        /* ...load car model */
+        if (sv_car_buffer_load(sv, sv->car_buffer[m], step) != 0)
         {
             TRACE(ERROR, _x("car buffer loading failed: %m"));
         }
@@ -1118,13 +1986,18 @@ static void * car_update_thread(void *arg)
         /* ...reacquire application lock */
         pthread_mutex_lock(&sv->lock);
 
-        /* ...submit buffer to a compositor pending queue */
-        pthread_mutex_lock(&sv->vsp_lock);
-        __vsp_submit_buffer(sv, VSP_CAR, sv->car_buffer[m]);
-        pthread_mutex_unlock(&sv->vsp_lock);
+        /* ...stage buffer for the view switch */
+        sv->car_next = gst_buffer_ref(sv->car_buffer[m]);
 
         /* ...clear car-model update flag */
         sv->flags &= ~APP_FLAG_CAR_UPDATE;
+
+        /* ...mark component is ready */
+        if (__sv_update_ready(sv, 1 << CAMERAS_NUMBER) != 0)
+        {
+            TRACE(ERROR, _x("job submission failed: %m"));
+            goto out;
+        }
     }
 
 out:
@@ -1139,38 +2012,42 @@ out:
 /* ...car model initialization */
 static int sv_car_setup(imr_sview_t *sv, int W, int H)
 {
+    extern char    *__model;
+    extern char    *__car_atlas;
+    extern int      __car_cache_size;
+    extern int      __steps[3];
     pthread_attr_t  attr;
     int             j;
     int             r;
 
-    /* ...car image plane allocation */
-    CHK_API(vsp_allocate_buffers(W, H, V4L2_PIX_FMT_ARGB32, sv->car_plane, 2));
+    /* ...create decoded images cache with background prefetching */
+    CHK_ERR(sv->car_cache = car_cache_create(W, H, __model, (u32)__car_cache_size << 20), -errno);
+
+    /* ...use packed sprites atlas if requested (build it from PNG files once) */
+    if (__car_atlas)
+    {
+        (access(__car_atlas, R_OK) != 0 ? CHK_API(car_atlas_create(__car_atlas, __model, W, H, __steps)) : 0);
+        CHK_API(car_cache_atlas(sv->car_cache, __car_atlas));
+    }
 
     /* ...create buffers for a car image */
     for (j = 0; j < 2; j++)
     {
         GstBuffer      *buffer = gst_buffer_new();
         imr_meta_t     *meta = gst_buffer_add_imr_meta(buffer);
-        vsp_mem_t      *mem = sv->car_plane[j];
-        int             format = GST_VIDEO_FORMAT_ARGB;
-        int             dmafd[GST_VIDEO_MAX_PLANES];
-        u32             offset[GST_VIDEO_MAX_PLANES];
-        u32             stride[GST_VIDEO_MAX_PLANES];
+        vsp_mem_t      *mem;
+
+        /* ...car plane holds packed sprite rows; size it for the largest sprite */
+        CHK_ERR(mem = sv->car_plane[j] = vsp_mem_alloc(car_cache_max_size(sv->car_cache)), -errno);
 
-        /* ...set memory descriptor */
+        /* ...set memory descriptor (no texture - sprite geometry is variable) */
         meta->priv = mem;
         meta->width = W;
         meta->height = H;
-        meta->format = format;
+        meta->format = GST_VIDEO_FORMAT_ARGB;
         meta->index = j;
         GST_META_FLAG_SET(meta, GST_META_FLAG_POOLED);
 
-        /* ...create DMA buffers for a memory chunk */
-        CHK_API(vsp_buffer_export(mem, W, H, __pixfmt_gst_to_v4l2(format), dmafd, offset, stride));
-
-        /* ...create texture (for debugging porposes only?) */
-        CHK_ERR(meta->priv2 = texture_create(W, H, format, dmafd, offset, stride), -errno);
-
         /* ...modify buffer release callback */
         GST_MINI_OBJECT_CAST(buffer)->dispose = __car_buffer_dispose;
 
@@ -1194,11 +2071,28 @@ static int sv_car_setup(imr_sview_t *sv, int W, int H)
 /* ...initialize runtime data */
 static int sv_runtime_init(imr_sview_t *sv, int w, int h, u32 ifmt, int W, int H, int cw, int ch, __vec4 shadow)
 {
-    int     i, j;
-    u32     ofmt = V4L2_PIX_FMT_ARGB32;
+    vsp_mem_t  *camera[2 * VSP_POOL_SIZE], *alpha[2 * VSP_POOL_SIZE];
+    int         i, j, na;
+    u32         ofmt = __vsp_format;
+
+    /* ...set pools depths (automatic sizing uses depths recommended by a previous run) */
+    memcpy(sv->pool_size, __pool_depth, sizeof(sv->pool_size));
+    if (__pool_profile)
+    {
+        CHK_API(pool_profile_load(__pool_profile, sv->pool_size));
+        CHK_ERR(sv->pool_stat = pool_stat_create(__pool_profile, sv->pool_size), -errno);
+    }
+
+    TRACE(INIT, _b("pools depths: camera=%d, alpha=%d, output=%d"), sv->pool_size[POOL_CAMERA], sv->pool_size[POOL_ALPHA], sv->pool_size[POOL_OUTPUT]);
+
+    /* ...carve all planes from a single contiguous block if requested */
+    if (__vsp_arena_size)
+    {
+        CHK_ERR(sv->arena = vsp_arena_create((u32)__vsp_arena_size << 20), -errno);
+    }
 
-    /* ...create VSP compositor */
-    CHK_ERR(sv->vsp = compositor_init(W, H, ifmt, W, H, ofmt, cw, ch, vsp_callback, sv), -errno);
+    /* ...create VSP compositor (blending is done in ARGB; output is converted to display-native format) */
+    CHK_ERR(sv->vsp = compositor_init(W, H, ifmt, W, H, ofmt, cw, ch, VSP_JOBS_NUMBER, vsp_callback, sv), -errno);
 
     TRACE(INIT, _b("open mesh file: '%s'"), __mesh_file_name);
     
@@ -1206,16 +2100,19 @@ static int sv_runtime_init(imr_sview_t *sv, int w, int h, u32 ifmt, int W, int H
     sv->mesh = mesh_create(__mesh_file_name, shadow);
 
     /* ...create VSP memory pools for cameras planes (two sets hosting opposite cameras) */
-    CHK_API(vsp_allocate_buffers(W, H, ifmt, &sv->camera_plane[0][0], 2 * VSP_POOL_SIZE));
+    for (i = 0; i < 2; i++)
+    {
+        CHK_API(vsp_allocate_buffers(W, H, ifmt, sv->camera_plane[i], sv->pool_size[POOL_CAMERA]));
+    }
     
     /* ...car image preparation */
     CHK_API(sv_car_setup(sv, cw, ch));
 
     /* ...create VSP memory pool for resulting image */
-    CHK_API(vsp_allocate_buffers(W, H, ofmt, sv->output, VSP_POOL_SIZE));
+    CHK_API(vsp_allocate_buffers(W, H, ofmt, sv->output, sv->pool_size[POOL_OUTPUT]));
 
     /* ...create output buffers */
-    for (j = 0; j < VSP_POOL_SIZE; j++)
+    for (j = 0; j < sv->pool_size[POOL_OUTPUT]; j++)
     {
         GstBuffer      *buffer = gst_buffer_new();
         imr_meta_t     *meta = gst_buffer_add_imr_meta(buffer);
@@ -1259,12 +2156,27 @@ static int sv_runtime_init(imr_sview_t *sv, int w, int h, u32 ifmt, int W, int H
     {
         int     fmt = __pixfmt_v4l2_to_gst(ifmt);
 
-        /* ...setup camera engine */
-        CHK_API(imr_setup(sv->imr, i, w, h, W, H, fmt, fmt, VSP_POOL_SIZE));
+        /* ...setup camera engine (camera buffers are imported as DMABUFs) */
+        CHK_API(imr_setup(sv->imr, i, w, h, W, H, fmt, fmt, sv->pool_size[POOL_CAMERA], 1));
     }
 
     /* ...alpha-plane processing setup */
-    CHK_API(sv_alpha_setup(sv, W, H));
+    CHK_API(sv_alpha_setup(sv, W, H, shadow));
+
+    /* ...precompile compositor jobs for all combinations of pool buffers (sets are laid out contiguously) */
+    for (i = 0, na = (sv->alpha_scale > 1 ? 1 : sv->pool_size[POOL_ALPHA]); i < 2; i++)
+    {
+        memcpy(&camera[i * sv->pool_size[POOL_CAMERA]], sv->camera_plane[i], sv->pool_size[POOL_CAMERA] * sizeof(vsp_mem_t *));
+        memcpy(&alpha[i * na], sv->alpha_plane[i], na * sizeof(vsp_mem_t *));
+    }
+
+    CHK_API(vsp_job_templates_init(sv->vsp, camera, sv->pool_size[POOL_CAMERA], alpha, na, sv->car_plane, 2, sv->output, sv->pool_size[POOL_OUTPUT]));
+
+    /* ...report arena utilization (helps to trim the arena size) */
+    if (sv->arena)
+    {
+        TRACE(INIT, _b("memory arena: %u KB of %d MB used"), vsp_arena_usage(sv->arena) >> 10, __vsp_arena_size);
+    }
 
     /* ...start engine - tbd - move out of here */
     CHK_API(imr_start(sv->imr));
@@ -1399,31 +2311,38 @@ static inline int sv_spnav_event(imr_sview_t *sv, widget_spnav_event_t *event)
     {
         GstBuffer      *buffer;
         imr_meta_t     *meta;
-        int             m;
+        int             bbox[4];
+        int             r;
         static int      counter = 0;
         char            fname[256];
         u32             t0, t1;
         
-        sprintf(fname, "car-render-%04d.png", counter);
+        sprintf(fname, "car-render-%04d", counter);
         counter = (counter + 1) % 10000;
         
         pthread_mutex_lock(&sv->lock);
 
+        /* ...hold displayed car plane (it is not reloaded while in use by compositor) */
+        if ((buffer = sv->car_active) != NULL)
+        {
+            meta = gst_buffer_get_imr_meta(gst_buffer_ref(buffer));
+            memcpy(bbox, sv->car_bbox[meta->index], sizeof(bbox));
+        }
+
+        pthread_mutex_unlock(&sv->lock);
+
+        if (buffer == NULL)     return 0;
+
         t0 = __get_time_usec();
         
-        /* ...get current car plane index */
-        m = !!(sv->flags & APP_FLAG_SET_INDEX);
-        buffer = sv->car_buffer[m];
-        meta = gst_buffer_get_imr_meta(buffer);
-        
-        /* ...get current car plane buffer */
-        store_png(fname, meta->width, meta->height, meta->format, vsp_mem_ptr(meta->priv));
+        /* ...queue copy of current car plane buffer (cropped sprite); encoding is asynchronous */
+        r = snapshot_store(__snapshot, fname, bbox[2] - bbox[0], bbox[3] - bbox[1], meta->format, vsp_mem_ptr(meta->priv));
 
         t1 = __get_time_usec();
         
-        pthread_mutex_unlock(&sv->lock);
+        gst_buffer_unref(buffer);
 
-        TRACE(INFO, _b("snapshot '%s' stored (%u usec)"), fname, (u32)(t1 - t0));
+        TRACE(INFO, _b("snapshot '%s' queued: %d (%u usec)"), fname, r, (u32)(t1 - t0));
     }
 
     return 0;
@@ -1536,7 +2455,7 @@ GstBuffer * imr_sview_buf_output(GstBuffer **buf)
         
         TRACE(1, _b("pixel-data: %08X:%08X:%08X..."), ((u32 *)data)[0], ((u32 *)data)[1], ((u32 *)data)[2]);
         
-        store_png("snapshot.png", meta->width, meta->height, meta->format, data);
+        snapshot_store(__snapshot, "snapshot", meta->width, meta->height, meta->format, data);
 
         count++;
     }
@@ -1555,11 +2474,23 @@ int imr_sview_submit(imr_sview_t *sv, GstBuffer **buf)
     /* ...push input buffers to the queue */
     for (i = 0; i < CAMERAS_NUMBER; i++)
     {
-        g_queue_push_tail(&sv->input[i], gst_buffer_ref(buf[i]));
+        g_queue_push_tail(&sv->input[i], (buf[i] ? gst_buffer_ref(buf[i]) : NULL));
     }
-    
+
+    /* ...latest-frame-wins mode keeps a bounded number of sets; the oldest one is dropped */
+    if (sv->input_depth && (int)g_queue_get_length(&sv->input[0]) > sv->input_depth)
+    {
+        __sv_input_drop(sv);
+    }
+
     /* ...submit job if possible */
-    if ((sv->input_ready &= ~((1 << CAMERAS_NUMBER) - 1)) == 0)
+    if (sv->input_depth)
+    {
+        /* ...submit all sets engines can take (backlog is re-evaluated) */
+        sv->input_ready &= ~((1 << CAMERAS_NUMBER) - 1);
+        r = __sv_input_resume(sv);
+    }
+    else if ((sv->input_ready &= ~((1 << CAMERAS_NUMBER) - 1)) == 0)
     {
         r = __sv_job_submit(sv);
     }
@@ -1570,6 +2501,50 @@ int imr_sview_submit(imr_sview_t *sv, GstBuffer **buf)
     return CHK_API(r);
 }
 
+/* ...single camera frame submission (per-camera dispatch mode) */
+int imr_sview_submit_camera(imr_sview_t *sv, int i, GstBuffer *buffer)
+{
+    int     r;
+
+    /* ...make sure mode is enabled */
+    CHK_ERR(sv->dispatch, -(errno = EINVAL));
+
+    /* ...protect internal data */
+    pthread_mutex_lock(&sv->lock);
+
+    /* ...start camera engine (frames are joined by compositor) */
+    r = __sv_camera_dispatch(sv, i, buffer);
+
+    /* ...release data access lock */
+    pthread_mutex_unlock(&sv->lock);
+
+    return CHK_API(r);
+}
+
+/* ...camera frame arrival notification (returns stalled cameras mask) */
+u32 imr_sview_watchdog(imr_sview_t *sv, int i)
+{
+    u32     stalled;
+
+    pthread_mutex_lock(&sv->lock);
+    stalled = __sv_watchdog(sv, i);
+    pthread_mutex_unlock(&sv->lock);
+
+    return stalled;
+}
+
+/* ...number of input sets (camera frames in per-camera dispatch mode) dropped */
+u32 imr_sview_dropped(imr_sview_t *sv)
+{
+    u32     n;
+
+    pthread_mutex_lock(&sv->lock);
+    n = sv->input_dropped;
+    pthread_mutex_unlock(&sv->lock);
+
+    return n;
+}
+
 /* ...event-processing function */
 int imr_sview_input_event(imr_sview_t *sv, widget_event_t *event)
 {
@@ -1594,9 +2569,52 @@ int imr_sview_input_event(imr_sview_t *sv, widget_event_t *event)
  * Module initialization function
  ******************************************************************************/
 
+/* ...module closing (processing is stopped; pending snapshots and masks are written) */
+void imr_sview_close(imr_sview_t *sv)
+{
+    /* ...stop update threads; masks of the last view are compressed before termination */
+    pthread_mutex_lock(&sv->lock);
+    (sv->alpha_done ? sv->flags |= APP_FLAG_ALPHA_COMPRESS : 0);
+    sv->flags |= APP_FLAG_EOS;
+    pthread_cond_broadcast(&sv->update);
+    pthread_cond_broadcast(&sv->alpha_wait);
+    pthread_mutex_unlock(&sv->lock);
+
+    pthread_join(sv->mesh_thread, NULL);
+    pthread_join(sv->alpha_thread, NULL);
+
+    /* ...persist new masks and destroy the cache */
+    if (sv->alpha_cache)
+    {
+        (sv->alpha_hit ? alpha_cache_release(sv->alpha_cache, sv->alpha_hit), 0 : 0);
+        alpha_cache_destroy(sv->alpha_cache), sv->alpha_cache = NULL, sv->alpha_hit = NULL;
+    }
+
+    /* ...flush snapshot writer */
+    if (__snapshot)
+    {
+        snapshot_writer_destroy(__snapshot), __snapshot = NULL;
+    }
+
+    /* ...detach memory arena (memory is released along with the last buffer) */
+    if (sv->arena)
+    {
+        vsp_arena_destroy(sv->arena), sv->arena = NULL;
+    }
+
+    /* ...close IMR engine (releases its completion source before reactor is destroyed) */
+    if (sv->imr)
+    {
+        imr_engine_close(sv->imr), sv->imr = NULL;
+    }
+
+    TRACE(INIT, _b("module closed"));
+}
+
 /* ...module initialization function */
 imr_sview_t * imr_sview_init(const imr_sview_cb_t *cb, void *cdata, int w, int h, int ifmt, int W, int H, int cw, int ch, __vec4 shadow)
 {
+    extern int             __snapshot_type;
     imr_sview_t           *sv;
     pthread_mutexattr_t    attr;
 
@@ -1612,6 +2630,15 @@ imr_sview_t * imr_sview_init(const imr_sview_cb_t *cb, void *cdata, int w, int h
     /* ...reset input frames readiness state */
     sv->input_ready = (1 << CAMERAS_NUMBER) - 1;
 
+    /* ...set pending input sets limit */
+    sv->input_depth = __latest_depth;
+
+    /* ...set input dispatch mode */
+    sv->dispatch = __camera_dispatch, sv->window = (u64)__sync_window * 1000000;
+
+    /* ...set cameras watchdog timeout */
+    sv->stall_timeout = (u32)__stall_timeout * 1000;
+
     /* ...reset output frames readiness state */
     sv->vsp_ready = (1 << VSP_NUMBER) - 1;
 
@@ -1635,6 +2662,13 @@ imr_sview_t * imr_sview_init(const imr_sview_cb_t *cb, void *cdata, int w, int h
         goto error;
     }
 
+    /* ...create snapshot writer thread */
+    if (!__snapshot && (__snapshot = snapshot_writer_create(__snapshot_type)) == NULL)
+    {
+        TRACE(ERROR, _x("failed to create snapshot writer: %m"));
+        goto error;
+    }
+
     /* ...create map update thread */
     if (sv_map_init(sv, W, H) != 0)
     {
@@ -1654,7 +2688,14 @@ imr_sview_t * imr_sview_init(const imr_sview_cb_t *cb, void *cdata, int w, int h
     return sv;
 
 error:
+    /* ...detach memory arena (memory is held by buffers allocated thus far) */
+    if (sv->arena)
+    {
+        vsp_arena_destroy(sv->arena);
+    }
+
     /* ...destroy data handle */
+    pool_stat_destroy(sv->pool_stat);
     free(sv);
 
     return NULL;
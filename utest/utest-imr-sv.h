@@ -63,6 +63,15 @@ extern GstBuffer * imr_sview_buf_output(GstBuffer **buf);
 /* ...input job submission */
 extern int imr_sview_submit(imr_sview_t *sv, GstBuffer **buf);
 
+/* ...single camera frame submission (per-camera dispatch mode) */
+extern int imr_sview_submit_camera(imr_sview_t *sv, int i, GstBuffer *buffer);
+
+/* ...camera frame arrival notification (returns stalled cameras mask) */
+extern u32 imr_sview_watchdog(imr_sview_t *sv, int i);
+
+/* ...number of input sets (camera frames in per-camera dispatch mode) dropped */
+extern u32 imr_sview_dropped(imr_sview_t *sv);
+
 /* ...event-processing function */
 extern int imr_sview_input_event(imr_sview_t *sv, widget_event_t *event);
 
@@ -72,4 +81,7 @@ extern int imr_sview_set_view(imr_sview_t *sv, __vec3 rot, __scalar scale, const
 /* ...module initialization function */
 extern imr_sview_t * imr_sview_init(const imr_sview_cb_t *cb, void *cdata, int w, int h, int ifmt, int W, int H, int cw, int ch, __vec4 shadow);
 
+/* ...module closing */
+extern void imr_sview_close(imr_sview_t *sv);
+
 #endif  /* __UTEST_IMR_SV_H */
@@ -32,10 +32,12 @@
 
 #include "utest-imr.h"
 #include "utest-vsink.h"
+#include "utest-reactor.h"
 #include <fcntl.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <linux/version.h>
 #include <linux/videodev2.h>
 #include "imr-v4l2-api.h"
@@ -77,6 +79,9 @@ typedef struct imr_device
     /* ...number of submitted/busy buffer-pairs */
     int                     submitted, busy;
 
+    /* ...number of submitted jobs bypassing the hardware */
+    int                     skipped;
+
     /* ...index of next buffer-pair to submit to device */
     int                     index;
 
@@ -86,9 +91,15 @@ typedef struct imr_device
     /* ...length of input/output buffers */
     u32                     input_length, output_length;
 
+    /* ...input buffers memory type (DMABUF import or user pointer) */
+    u32                     input_memory;
+
     /* ...processing time estimation */
     u32                     ts_acc;
 
+    /* ...reactor event source */
+    reactor_source_t        source;
+
 }   imr_device_t;
 
 /* ...distortion correction engine data */
@@ -103,6 +114,15 @@ typedef struct imr_data
     /* ...epoll file descriptor */
     int                     efd;
 
+    /* ...bypassed jobs signalling descriptor */
+    int                     evfd;
+
+    /* ...shared reactor (devices are serviced by reactor thread; optional) */
+    reactor_t              *reactor;
+
+    /* ...reactor event source of signalling descriptor */
+    reactor_source_t        source;
+
     /* ...engine activity flag */
     int                     active;
 
@@ -363,14 +383,14 @@ static inline int imr_streaming_enable(int vfd, int enable)
 }
 
 /* ...allocate buffer pool */
-static inline int imr_allocate_buffers(int vfd, int num)
+static inline int imr_allocate_buffers(int vfd, int num, u32 memory)
 {
     struct v4l2_requestbuffers  reqbuf;
 
-    /* ...allocate input buffers (user-provided memory) */
+    /* ...allocate input buffers (imported DMABUFs or user-provided memory) */
     memset(&reqbuf, 0, sizeof(reqbuf));
     reqbuf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
-    reqbuf.memory = V4L2_MEMORY_USERPTR;
+    reqbuf.memory = memory;
     reqbuf.count = num;
     CHK_API(ioctl(vfd, VIDIOC_REQBUFS, &reqbuf));
     CHK_ERR(reqbuf.count == (u32)num, -(errno = ENOMEM));
@@ -392,7 +412,7 @@ static inline int imr_allocate_buffers(int vfd, int num)
 }
 
 /* ...destroy output/capture buffer pool */
-static inline int imr_destroy_buffers(int vfd)
+static inline int imr_destroy_buffers(int vfd, u32 memory)
 {
     struct v4l2_requestbuffers  reqbuf;
 
@@ -402,7 +422,7 @@ static inline int imr_destroy_buffers(int vfd)
     /* ...release kernel-allocated input buffers */
     memset(&reqbuf, 0, sizeof(reqbuf));
     reqbuf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
-    reqbuf.memory = V4L2_MEMORY_USERPTR;
+    reqbuf.memory = memory;
     reqbuf.count = 0;
     CHK_API(ioctl(vfd, VIDIOC_REQBUFS, &reqbuf));
 
@@ -419,16 +439,16 @@ static inline int imr_destroy_buffers(int vfd)
 }
 
 /* ...submit intput/output buffer pair */
-static inline int imr_buffers_enqueue(int vfd, int j, void *input, u32 ilen, void *output, u32 olen)
+static inline int imr_buffers_enqueue(int vfd, int j, u32 memory, vsink_meta_t *input, u32 ilen, void *output, u32 olen)
 {
     struct v4l2_buffer  buf;
 
-    /* ...prepare input buffer */
+    /* ...prepare input buffer (DMABUF is imported by descriptor; no user mapping is required) */
     memset(&buf, 0, sizeof(buf));
     buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
-    buf.memory = V4L2_MEMORY_USERPTR;
+    buf.memory = memory;
     buf.index = j;
-    buf.m.userptr = (unsigned long)(uintptr_t)input;
+    (memory == V4L2_MEMORY_DMABUF ? (buf.m.fd = input->dmafd[0]) : (buf.m.userptr = (unsigned long)(uintptr_t)input->plane[0]));
     buf.length = buf.bytesused = ilen;
     CHK_API(ioctl(vfd, VIDIOC_QBUF, &buf));
 
@@ -445,7 +465,7 @@ static inline int imr_buffers_enqueue(int vfd, int j, void *input, u32 ilen, voi
 }
 
 /* ...dequeue buffer pair */
-static inline int imr_buffers_dequeue(int vfd, int *error, u32 *duration)
+static inline int imr_buffers_dequeue(int vfd, u32 memory, int *error, u32 *duration)
 {
     struct v4l2_buffer  buf;
     int                 j, k;
@@ -454,7 +474,7 @@ static inline int imr_buffers_dequeue(int vfd, int *error, u32 *duration)
     /* ...dequeue input buffer */
     memset(&buf, 0, sizeof(buf));
     buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
-    buf.memory = V4L2_MEMORY_USERPTR;
+    buf.memory = memory;
     CHK_API(ioctl(vfd, VIDIOC_DQBUF, &buf));
     j = buf.index;
     t0 = buf.timestamp.tv_sec * 1000000ULL + buf.timestamp.tv_usec;
@@ -495,7 +515,14 @@ static inline int __register_poll(imr_data_t *imr, int i, int active)
     BUG(!dev->active || (active && !dev->submitted), _x("invalid poll op: active=%d, streaming=%d, submitted=%d"), active, dev->active, dev->submitted);
     
     /* ...add/remove source */
-    CHK_API(epoll_ctl(imr->efd, (active ? EPOLL_CTL_ADD : EPOLL_CTL_DEL), dev->vfd, &event));
+    if (imr->reactor)
+    {
+        CHK_API(reactor_poll(imr->reactor, dev->vfd, &dev->source, active));
+    }
+    else
+    {
+        CHK_API(epoll_ctl(imr->efd, (active ? EPOLL_CTL_ADD : EPOLL_CTL_DEL), dev->vfd, &event));
+    }
 
     TRACE(DEBUG, _b("#%d: poll source %s"), i, (active ? "added" : "removed"));
     
@@ -517,27 +544,46 @@ static inline int __submit_buffer(imr_data_t *imr, int i)
     if (g_queue_is_empty(&dev->input))              return 0;
 
     /* ...check if we have free buffer-pair */
-    if (dev->submitted + dev->busy == dev->size)    return 0;
+    if (dev->submitted + dev->skipped + dev->busy == dev->size)    return 0;
 
     /* ...get head of the queue */
     buffer = g_queue_pop_head(&dev->input);
     
-    /* ...take vsink meta-data */
-    vmeta = gst_buffer_get_vsink_meta(buffer);
-
     /* ...get free buffer-pair index */
     buf = &dev->pool[j = dev->index];
 
     /* ...save associated input buffer (takes buffer ownership) */
     buf->input = buffer;
 
-    TRACE(DEBUG, _b("enqueue buffer #<%d,%d>"), i, j);
+    TRACE(DEBUG, _b("enqueue buffer #<%d,%d>%s"), i, j, (buffer ? "" : " (skip)"));
 
     /* ...prepare output buffer if needed */
     (imr->cb->prepare ? imr->cb->prepare(imr->cdata, i, buf->output) : 0);
 
+    /* ...job without input buffer bypasses the hardware */
+    if (buffer == NULL)
+    {
+        /* ...advance writing index and sequence number */
+        dev->index = (++j == dev->size ? 0 : j);
+        dev->sequence++;
+
+        /* ...output is passed to application once all preceding jobs are complete */
+        dev->skipped++;
+        
+        /* ...kick processing thread if there are no jobs in hardware */
+        if (dev->submitted == 0)
+        {
+            CHK_ERR(eventfd_write(imr->evfd, 1) == 0, -errno);
+        }
+
+        return 0;
+    }
+
+    /* ...take vsink meta-data */
+    vmeta = gst_buffer_get_vsink_meta(buffer);
+
     /* ...submit buffer-pair to the V4L2 */
-    CHK_API(imr_buffers_enqueue(dev->vfd, j, vmeta->plane[0], dev->input_length, buf->data, dev->output_length));
+    CHK_API(imr_buffers_enqueue(dev->vfd, j, dev->input_memory, vmeta, dev->input_length, buf->data, dev->output_length));
 
     /* ...advance writing index */
     dev->index = (++j == dev->size ? 0 : j);
@@ -551,6 +597,48 @@ static inline int __submit_buffer(imr_data_t *imr, int i)
     return 0;
 }
 
+/* ...pass bypassed jobs to application in submission order (called with a lock held) */
+static inline int __process_skipped(imr_data_t *imr, int i)
+{
+    imr_device_t   *dev = &imr->dev[i];
+    GstBuffer      *buffer;
+    imr_buffer_t   *buf;
+    int             j;
+
+    while (dev->skipped > 0)
+    {
+        /* ...get index of oldest job in flight */
+        ((j = dev->index - dev->submitted - dev->skipped) < 0 ? j += dev->size : 0);
+
+        /* ...stop if it is processed by hardware */
+        if ((buf = &dev->pool[j])->input != NULL)   break;
+
+        /* ...output buffer is passed to application */
+        dev->skipped--, dev->busy++;
+
+        TRACE(DEBUG, _b("skipped buffer-pair #<%d,%d>, skipped: %d"), i, j, dev->skipped);
+
+        /* ...get output buffer handle */
+        buffer = buf->output;
+
+        /* ...release lock before passing buffer to the application */
+        pthread_mutex_unlock(&imr->lock);
+
+        if (imr->cb->process(imr->cdata, i, buffer) != 0)
+        {
+            TRACE(ERROR, _x("failed to submit buffer to the application: %m"));
+        }
+
+        /* ...drop the reference (buffer is now owned by application) */
+        gst_buffer_unref(buffer);
+
+        /* ...reacquire data access lock */
+        pthread_mutex_lock(&imr->lock);
+    }
+
+    return 0;
+}
+
 /* ...buffer processing function (called with a lock held) */
 static inline int __process_buffer(imr_data_t *imr, int i)
 {
@@ -565,7 +653,7 @@ static inline int __process_buffer(imr_data_t *imr, int i)
     if (!dev->active || !dev->submitted)        return 0;
 
     /* ...get buffer from a device */
-    CHK_API(j = imr_buffers_dequeue(dev->vfd, &error, &duration));
+    CHK_API(j = imr_buffers_dequeue(dev->vfd, dev->input_memory, &error, &duration));
 
     /* ...remove poll-source if last buffer is dequeued */
     (--dev->submitted == 0 ? __register_poll(imr, i, 0) : 0);
@@ -602,14 +690,15 @@ static inline int __process_buffer(imr_data_t *imr, int i)
     /* ...reaqcuire data access lock */
     pthread_mutex_lock(&imr->lock);
 
-    return 0;
+    /* ...pass subsequent bypassed jobs as required */
+    return __process_skipped(imr, i);
 }
 
 /* ...purge buffers */
 static inline int __purge_buffer(imr_data_t *imr, int i)
 {
     imr_device_t   *dev = &imr->dev[i];
-    int             n = dev->submitted;
+    int             n = dev->submitted + dev->skipped;
     int             N = dev->size;
     int             j = dev->index;
     imr_buffer_t   *buf;
@@ -629,23 +718,62 @@ static inline int __purge_buffer(imr_data_t *imr, int i)
         buf = &dev->pool[j];
 
         /* ...release input buffers only (output buffers still belong to the pool) */
-        gst_buffer_unref(buf->input);
+        (buf->input ? gst_buffer_unref(buf->input) : 0);
 
         /* ...advance pool position */
         (++j == N ? j = 0 : 0);
     }
 
     /* ...mark we have no submitted buffers anymore */
-    dev->submitted = 0;
+    dev->submitted = dev->skipped = 0;
 
     return 0;
 }
 
+/* ...reactor event processing hook */
+static int __imr_reactor_hook(void *cdata, int i, u32 events)
+{
+    imr_data_t     *imr = cdata;
+    eventfd_t       v;
+    int             k, r = 0;
+
+    pthread_mutex_lock(&imr->lock);
+
+    /* ...event may have been retrieved before engine was closed */
+    if (!imr->active)
+    {
+        pthread_mutex_unlock(&imr->lock);
+        return 0;
+    }
+
+    if (i == imr->num)
+    {
+        /* ...clear signal and pass all ready buffers */
+        eventfd_read(imr->evfd, &v);
+        for (k = 0; r >= 0 && k < imr->num; k++)
+        {
+            r = __process_skipped(imr, k);
+        }
+    }
+    else
+    {
+        BUG(!(events & EPOLLIN), _x("invalid poll events: i=%d, event=%X"), i, events);
+
+        r = __process_buffer(imr, i);
+    }
+
+    pthread_mutex_unlock(&imr->lock);
+
+    return r;
+}
+
 /* ...V4L2 processing thread */
 static void * imr_thread(void *arg)
 {
     imr_data_t         *imr = arg;
-    struct epoll_event  event[imr->num];
+    struct epoll_event  event[imr->num + 1];
+
+    thread_placement(THREAD_IMR);
 
     /* ...lock internal data access */
     pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
@@ -663,7 +791,7 @@ static void * imr_thread(void *arg)
         TRACE(0, _b("start waiting..."));
 
         /* ...wait for event (infinite timeout) */
-        r = epoll_wait(imr->efd, event, imr->num, -1);
+        r = epoll_wait(imr->efd, event, imr->num + 1, -1);
 
         TRACE(0, _b("waiting complete: %d"), r);
 
@@ -685,8 +813,23 @@ static void * imr_thread(void *arg)
         {
             int     i = (int)event[k].data.u32;
 
-            /* ...process output buffers */
-            if (event[k].events & EPOLLIN)
+            /* ...process bypassed jobs */
+            if (i == imr->num)
+            {
+                eventfd_t   v;
+
+                /* ...clear signal and pass all ready buffers */
+                eventfd_read(imr->evfd, &v);
+                for (i = 0; i < imr->num; i++)
+                {
+                    if (__process_skipped(imr, i) < 0)
+                    {
+                        TRACE(ERROR, _x("processing failed: %m"));
+                        goto out;
+                    }
+                }
+            }
+            else if (event[k].events & EPOLLIN)
             {
                 if (__process_buffer(imr, i) < 0)
                 {
@@ -846,14 +989,18 @@ int imr_start(imr_data_t *imr)
     /* ...set decoder active flag */
     imr->active = 1;
 
-    /* ...initialize thread attributes (joinable, 128KB stack) */
-    pthread_attr_init(&attr);
-    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
-    pthread_attr_setstacksize(&attr, 128 << 10);
-
-    /* ...create V4L2 decoding thread to asynchronously process buffers */
-    CHK_API(pthread_create(&imr->thread, &attr, imr_thread, imr));
-    pthread_attr_destroy(&attr);
+    /* ...devices are serviced by shared reactor */
+    if (!imr->reactor)
+    {
+        /* ...initialize thread attributes (joinable, 128KB stack) */
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+        pthread_attr_setstacksize(&attr, 128 << 10);
+
+        /* ...create V4L2 decoding thread to asynchronously process buffers */
+        CHK_API(pthread_create(&imr->thread, &attr, imr_thread, imr));
+        pthread_attr_destroy(&attr);
+    }
 
     /* ...enable streaming */
     CHK_API(imr_enable(imr, 1));
@@ -875,9 +1022,16 @@ imr_data_t * imr_init(char **devname, int num, camera_callback_t *cb, void *cdat
     /* ...allocate IMR processor data */
     CHK_ERR(imr = calloc(1, sizeof(*imr)), (errno = ENOMEM, NULL));
 
+    /* ...descriptors are not open yet */
+    imr->efd = imr->evfd = -1;
+
     /* ...save application callback data */
     imr->cb = cb, imr->cdata = cdata;    
 
+    /* ...devices may be serviced by shared reactor instead of own thread */
+    imr->reactor = reactor_get();
+    imr->source.hook = __imr_reactor_hook, imr->source.cdata = imr, imr->source.id = num;
+
     /* ...allocate engine-specific data */
     if ((imr->dev = calloc(imr->num = num, sizeof(imr_device_t))) == NULL)
     {
@@ -886,17 +1040,38 @@ imr_data_t * imr_init(char **devname, int num, camera_callback_t *cb, void *cdat
     }
 
     /* ...create epoll descriptor */
-    if ((imr->efd = epoll_create(imr->num)) < 0)
+    if ((imr->efd = epoll_create(imr->num + 1)) < 0)
     {
         TRACE(ERROR, _x("failed to create epoll: %m"));
         goto error;
     }
+
+    /* ...create signalling descriptor for jobs bypassing the hardware */
+    if ((imr->evfd = eventfd(0, EFD_NONBLOCK)) < 0)
+    {
+        TRACE(ERROR, _x("failed to create eventfd: %m"));
+        goto error;
+    }
+    else
+    {
+        struct epoll_event  event = { .events = EPOLLIN, .data.u32 = (u32)num };
+
+        /* ...add permanent poll source */
+        if ((imr->reactor ? reactor_poll(imr->reactor, imr->evfd, &imr->source, 1) : epoll_ctl(imr->efd, EPOLL_CTL_ADD, imr->evfd, &event)) < 0)
+        {
+            TRACE(ERROR, _x("failed to add poll source: %m"));
+            goto error;
+        }
+    }
     
     /* ...open V4L2 image renderer devices */
     for (i = 0; i < num; i++)
     {
         imr_device_t   *dev = &imr->dev[i];        
 
+        /* ...set reactor event source */
+        dev->source.hook = __imr_reactor_hook, dev->source.cdata = imr, dev->source.id = i;
+
         /* ...open separate instance for an input camera */
         if ((dev->vfd = open(devname[i], O_RDWR | O_NONBLOCK)) < 0)
         {
@@ -937,8 +1112,11 @@ error_dev:
     free(imr->dev);
 
 error:
+    /* ...close signalling descriptor */
+    (imr->evfd >= 0 ? close(imr->evfd) : 0);
+
     /* ...close epoll file descriptor */
-    close(imr->efd);
+    (imr->efd >= 0 ? close(imr->efd) : 0);
 
     /* ...release module memory */
     free(imr);
@@ -947,7 +1125,7 @@ error:
 }
 
 /* ...distortion correction engine runtime initialization */
-int imr_setup(imr_data_t *imr, int i, int w, int h, int W, int H, int ifmt, int ofmt, int size)
+int imr_setup(imr_data_t *imr, int i, int w, int h, int W, int H, int ifmt, int ofmt, int size, int dmabuf)
 {
     imr_device_t   *dev = &imr->dev[i];
     int             j;
@@ -959,6 +1137,9 @@ int imr_setup(imr_data_t *imr, int i, int w, int h, int W, int H, int ifmt, int
     /* ...set buffers dimensions */
     dev->w = w, dev->h = h, dev->W = W, dev->H = H;
 
+    /* ...input buffers are either imported DMABUFs or mapped user memory */
+    dev->input_memory = (dmabuf ? V4L2_MEMORY_DMABUF : V4L2_MEMORY_USERPTR);
+
     /* ...set IMR format */
     CHK_API(imr_set_formats(dev->vfd, w, h, W, H, __pixfmt_gst_to_v4l2(ifmt), __pixfmt_gst_to_v4l2(ofmt)));
 
@@ -966,7 +1147,7 @@ int imr_setup(imr_data_t *imr, int i, int w, int h, int W, int H, int ifmt, int
     CHK_ERR(dev->pool = calloc(dev->size = size, sizeof(imr_buffer_t)), -(errno = ENOMEM));
 
     /* ...allocate V4L2 buffers */
-    CHK_API(imr_allocate_buffers(dev->vfd, size));
+    CHK_API(imr_allocate_buffers(dev->vfd, size, dev->input_memory));
 
     /* ...create output buffers */
     for (j = 0; j < size; j++)
@@ -998,7 +1179,7 @@ int imr_setup(imr_data_t *imr, int i, int w, int h, int W, int H, int ifmt, int
         CHK_API(imr->cb->allocate(imr->cdata, i, buffer));
     }
 
-    TRACE(INIT, _b("IMR-#%d: buffer pool initialized"), i);
+    TRACE(INIT, _b("IMR-#%d: buffer pool initialized (%s input)"), i, (dmabuf ? "dmabuf" : "userptr"));
 
     return 0;
 }
@@ -1164,9 +1345,31 @@ struct imr_cfg
     /* ...mesh descriptor */
     struct imr_map_desc     desc;
 
-    /* ...any extra data? - tbd */
+    /* ...number of primitives in a mesh */
+    int                     num;
+
+    /* ...bounding box of destination area (pixels, exclusive right/bottom edges) */
+    int                     bbox[4];
 };
 
+/* ...calculate destination bounding box of a triangles list */
+static inline void __cfg_bbox(imr_cfg_t *cfg, struct imr_abs_coord *coord, struct imr_abs_coord *end, int W, int H)
+{
+    int     x0 = W, y0 = H, x1 = 0, y1 = 0;
+
+    for (; coord < end; coord++)
+    {
+        int     x = coord->X >> IMR_DST_SUBSAMPLE, y = coord->Y >> IMR_DST_SUBSAMPLE;
+
+        (x < x0 ? x0 = x : 0), (x + 1 > x1 ? x1 = x + 1 : 0);
+        (y < y0 ? y0 = y : 0), (y + 1 > y1 ? y1 = y + 1 : 0);
+    }
+
+    /* ...clip box to the destination (vertices may lie outside) */
+    cfg->bbox[0] = (x0 < 0 ? 0 : x0), cfg->bbox[2] = (x1 > W ? W : x1);
+    cfg->bbox[1] = (y0 < 0 ? 0 : y0), cfg->bbox[3] = (y1 > H ? H : y1);
+}
+
 /* ...create mesh configuration */
 imr_cfg_t * imr_cfg_create(imr_data_t *imr, int i, float *uv, float *xy, int n)
 {
@@ -1228,7 +1431,10 @@ imr_cfg_t * imr_cfg_create(imr_data_t *imr, int i, float *uv, float *xy, int n)
     }
 
     /* ...put number of triangles in VBO */
-    vbo->num = m;
+    vbo->num = cfg->num = m;
+
+    /* ...calculate bounding box of rendered area (empty if no triangles) */
+    __cfg_bbox(cfg, (void *)(vbo + 1), coord, dev->W, dev->H);
 
     /* ...fill-in descriptor */
     desc->type = IMR_MAP_UVDPOR(IMR_SRC_SUBSAMPLE) | (IMR_DST_SUBSAMPLE ? IMR_MAP_DDP : 0) | 0 * IMR_MAP_TCM;
@@ -1265,6 +1471,10 @@ imr_cfg_t * imr_cfg_mesh_src(imr_data_t *imr, int i, float *uv, int rows, int co
 
     /* ...set mesh parameters */
     mesh->rows = rows, mesh->columns = columns;
+    cfg->num = rows * columns;
+
+    /* ...rectangular mesh may cover entire destination */
+    cfg->bbox[0] = cfg->bbox[1] = 0, cfg->bbox[2] = dev->W, cfg->bbox[3] = dev->H;
     mesh->x0 = (u16)round(x0 * W);
     mesh->y0 = (u16)round(y0 * H);
     mesh->dx = (u16)round(dx * W);
@@ -1294,6 +1504,18 @@ imr_cfg_t * imr_cfg_mesh_src(imr_data_t *imr, int i, float *uv, int rows, int co
     return cfg;
 }
 
+/* ...number of primitives in mesh configuration */
+int imr_cfg_num(imr_cfg_t *cfg)
+{
+    return cfg->num;
+}
+
+/* ...destination area bounding box of mesh configuration */
+const int * imr_cfg_bbox(imr_cfg_t *cfg)
+{
+    return cfg->bbox;
+}
+
 /* ...destroy mesh configuration structure */
 void imr_cfg_destroy(imr_cfg_t *cfg)
 {
@@ -1409,12 +1631,14 @@ int imr_engine_setup(imr_data_t *imr, int i, float *uv, float *xy, int n)
 int imr_engine_push_buffer(imr_data_t *imr, int i, GstBuffer *buffer)
 {
     imr_device_t   *dev = &imr->dev[i];
+    vsink_meta_t   *vmeta;
     int             r;
 
     BUG((u32)i >= (u32)imr->num, _x("invalid transaction: %d"), i);
     
-    /* ...make sure buffer has vsink metadata */
-    CHK_ERR(gst_buffer_get_vsink_meta(buffer), -(errno = EINVAL));
+    /* ...make sure buffer has vsink metadata (and a descriptor if memory is imported) */
+    CHK_ERR(vmeta = gst_buffer_get_vsink_meta(buffer), -(errno = EINVAL));
+    CHK_ERR(dev->input_memory != V4L2_MEMORY_DMABUF || vmeta->dmafd[0] >= 0, -(errno = EINVAL));
 
     /* ...lock internal data access */
     pthread_mutex_lock(&imr->lock);
@@ -1434,19 +1658,65 @@ int imr_engine_push_buffer(imr_data_t *imr, int i, GstBuffer *buffer)
     return CHK_API(r);
 }
 
+/* ...submit a job bypassing the hardware (output buffer is passed as-is) */
+int imr_engine_skip(imr_data_t *imr, int i)
+{
+    imr_device_t   *dev = &imr->dev[i];
+    int             r;
+
+    BUG((u32)i >= (u32)imr->num, _x("invalid transaction: %d"), i);
+
+    /* ...lock internal data access */
+    pthread_mutex_lock(&imr->lock);
+
+    /* ...place empty job into pending input queue */
+    g_queue_push_tail(&dev->input, NULL);
+
+    /* ...try to submit buffers if possible */
+    r = __submit_buffer(imr, i);
+
+    /* ...release internal access lock */
+    pthread_mutex_unlock(&imr->lock);
+
+    return CHK_API(r);
+}
+
 /* ...module closing */
 void imr_engine_close(imr_data_t *imr)
 {
     int     i, j;
 
-    /* ...force thread termination */
-    TRACE(DEBUG, _b("signal thread termination"));
-    pthread_cancel(imr->thread);
-    pthread_join(imr->thread, NULL);
-    TRACE(DEBUG, _b("thread joined"));
+    if (imr->reactor)
+    {
+        pthread_mutex_lock(&imr->lock);
+
+        /* ...stop servicing signalling and devices descriptors */
+        reactor_poll(imr->reactor, imr->evfd, &imr->source, 0);
+
+        for (i = 0; i < imr->num; i++)
+        {
+            (imr->dev[i].active && imr->dev[i].submitted ? __register_poll(imr, i, 0) : 0);
+        }
+
+        imr->active = 0;
+
+        pthread_mutex_unlock(&imr->lock);
+
+        /* ...wait until hooks retrieved meanwhile are completed */
+        reactor_sync(imr->reactor);
+    }
+    else
+    {
+        /* ...force thread termination */
+        TRACE(DEBUG, _b("signal thread termination"));
+        pthread_cancel(imr->thread);
+        pthread_join(imr->thread, NULL);
+        TRACE(DEBUG, _b("thread joined"));
+    }
     
-    /* ...close epoll descriptor */
+    /* ...close epoll and signalling descriptors */
     close(imr->efd);
+    close(imr->evfd);
 
     /* ...mark engine is disabled */
     imr->active = 0;
@@ -1459,11 +1729,13 @@ void imr_engine_close(imr_data_t *imr)
         /* ...drop all pending input buffers */
         while (!g_queue_is_empty(&dev->input))
         {
-            gst_buffer_unref(g_queue_pop_head(&dev->input));
+            GstBuffer  *buffer = g_queue_pop_head(&dev->input);
+
+            (buffer ? gst_buffer_unref(buffer) : 0);
         }
 
         /* ...deallocate V4L2 buffers */
-        imr_destroy_buffers(dev->vfd);
+        imr_destroy_buffers(dev->vfd, dev->input_memory);
 
         /* ...clean-up all buffers that haven't been freed */
         for (j = 0; j < dev->size; j++)
@@ -1491,3 +1763,17 @@ u32 imr_engine_avg_time(imr_data_t *imr, int i)
 {
     return imr_avg_time(&imr->dev[i]);
 }
+
+/* ...return number of pending jobs */
+int imr_engine_pending(imr_data_t *imr, int i)
+{
+    int     n;
+
+    BUG((u32)i >= (u32)imr->num, _x("invalid engine: %d"), i);
+
+    pthread_mutex_lock(&imr->lock);
+    n = g_queue_get_length(&imr->dev[i].input);
+    pthread_mutex_unlock(&imr->lock);
+
+    return n;
+}
@@ -113,8 +113,8 @@ extern const GstMetaInfo *imr_meta_get_info(void);
 /* ...IMR engine initialization */
 extern imr_data_t * imr_init(char **devname, int num, camera_callback_t *cb, void *cdata);
 
-/* ...IMR device configuration */
-extern int imr_setup(imr_data_t *imr, int i, int w, int h, int W, int H, int ifmt, int ofmt, int size);
+/* ...IMR device configuration (input buffers are imported as DMABUFs if requested) */
+extern int imr_setup(imr_data_t *imr, int i, int w, int h, int W, int H, int ifmt, int ofmt, int size, int dmabuf);
 
 /* ...start IMR operation */
 extern int imr_start(imr_data_t *imr);
@@ -128,18 +128,30 @@ extern int imr_engine_setup(imr_data_t *imr, int i, float *uv, float *xy, int n)
 /* ...buffer submission */
 extern int imr_engine_push_buffer(imr_data_t *imr, int i, GstBuffer *buffer);
 
+/* ...submit a job bypassing the hardware (output buffer is passed as-is) */
+extern int imr_engine_skip(imr_data_t *imr, int i);
+
 /* ...module termination */
 extern void imr_engine_close(imr_data_t *imr);
 
 /* ...average buffer-processing time */
 extern u32 imr_engine_avg_time(imr_data_t *imr, int i);
 
+/* ...number of jobs waiting for a free buffer-pair */
+extern int imr_engine_pending(imr_data_t *imr, int i);
+
 /* ...create mesh configuration */
 extern imr_cfg_t * imr_cfg_create(imr_data_t *imr, int i, float *uv, float *xy, int n);
 
 /* ...create rectangular mesh with automatically generated destination coordinates */
 extern imr_cfg_t * imr_cfg_mesh_src(imr_data_t *imr, int i, float *uv, int rows, int columns, float x0, float y0, float dx, float dy);
 
+/* ...number of primitives in mesh configuration */
+extern int imr_cfg_num(imr_cfg_t *cfg);
+
+/* ...destination area bounding box of mesh configuration (x0, y0, x1, y1) */
+extern const int * imr_cfg_bbox(imr_cfg_t *cfg);
+
 /* ...destroy mesh configuration structure */
 extern void imr_cfg_destroy(imr_cfg_t *cfg);
 
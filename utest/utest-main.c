@@ -32,6 +32,9 @@
 
 #include "utest-common.h"
 #include "utest-app.h"
+#include "utest-snapshot.h"
+#include "utest-pool.h"
+#include "utest-reactor.h"
 #include <getopt.h>
 #include <linux/videodev2.h>
 
@@ -76,8 +79,24 @@ u32     __vin_format = V4L2_PIX_FMT_UYVY;
 int     __vin_width = 1280, __vin_height = 800;
 int     __vin_buffers_num = 6;
 
-/* ...VSP dimensions */
+/* ...VIN buffers user-space mapping (buffers are passed to consumers as DMABUFs) */
+int     __vin_mmap = 0;
+
+/* ...cameras frames synchronization window (ms; 0 - match frames by arrival order) */
+int     __sync_window = 0;
+
+/* ...pending frames limit per stage in latest-frame-wins mode (disabled by default) */
+int     __latest_depth = 0;
+
+/* ...per-camera dispatch mode (disabled by default - cameras frames are submitted in sets) */
+int     __camera_dispatch = 0;
+
+/* ...camera stall timeout in ms (watchdog is disabled by default) */
+int     __stall_timeout = 0;
+
+/* ...VSP dimensions and output format */
 int     __vsp_width = 1280, __vsp_height = 720;
+u32     __vsp_format = V4L2_PIX_FMT_ARGB32;
 
 /* ...car buffer dimensions */
 int     __car_width = 1280, __car_height = 720;
@@ -100,6 +119,30 @@ int     __steps[3] = { 8, 32, 8 };
 /* ...model file prefix */
 char   *__model = "./data/model";
 
+/* ...alpha-masks persistent cache directory (disabled by default) */
+char   *__alpha_cache_dir = NULL;
+
+/* ...alpha-planes rendering downscale factor (1 - full resolution) */
+int     __alpha_scale = 1;
+
+/* ...decoded car images cache size (MB) */
+int     __car_cache_size = 64;
+
+/* ...car sprites atlas file (PNG files are used if not set) */
+char   *__car_atlas = NULL;
+
+/* ...snapshot file format */
+int     __snapshot_type = SNAPSHOT_PNG;
+
+/* ...buffer pools depths (camera planes, alpha planes, compositor output) */
+int     __pool_depth[POOL_STAGES] = { 2, 2, 2 };
+
+/* ...pools profile file (automatic sizing; disabled by default) */
+char   *__pool_profile = NULL;
+
+/* ...contiguous memory arena size in MB (disabled by default) */
+int     __vsp_arena_size = 0;
+
 /*******************************************************************************
  * Live capturing from VIN cameras
  ******************************************************************************/
@@ -112,6 +155,25 @@ char * vin_dev_name[4] = {
     "/dev/video3",
 };
 
+/*******************************************************************************
+ * Replay of recorded cameras
+ ******************************************************************************/
+
+/* ...recording file names (single interleaved file or one file per camera) */
+char * replay_file_name[4];
+
+/* ...number of recording files (0 - live capturing from VIN) */
+int     __replay_files = 0;
+
+/* ...replay rate (-1 - recorded timestamps, 0 - as fast as possible, fps otherwise) */
+int     __replay_rate = -1;
+
+/* ...capture recording files prefix (disabled by default) */
+char   *__record_prefix = NULL;
+
+/* ...single-reactor mode: VIN, IMR and compositor completions serviced by one thread (disabled by default) */
+int     __reactor_mode = 0;
+
 /*******************************************************************************
  * Parameters parsing
  ******************************************************************************/
@@ -133,6 +195,66 @@ static inline int parse_vin_devices(char *str, char **name, int n)
     return 0;
 }
 
+/* ...parse recording file names */
+static inline int parse_replay_files(char *str, char **name, int n)
+{
+    char   *s;
+    int     k;
+
+    for (k = 0, s = strtok(str, ","); k < n && s; k++, s = strtok(NULL, ","))
+    {
+        /* ...just copy a pointer (string is persistent) */
+        name[k] = s;
+    }
+
+    /* ...either a single interleaved recording or a file per camera */
+    CHK_ERR(!s && (k == 1 || k == n), -EINVAL);
+
+    return k;
+}
+
+/* ...parse replay rate */
+static inline int parse_replay_rate(char *str)
+{
+    if (strcasecmp(str, "pts") == 0)
+    {
+        return -1;
+    }
+    else if (strcasecmp(str, "max") == 0)
+    {
+        return 0;
+    }
+    else
+    {
+        return atoi(str);
+    }
+}
+
+/* ...parse threads placement ("role:prio[:mask]" entries) */
+static inline int parse_threads(char *str)
+{
+    char   *s, *t;
+    int     prio;
+    u32     cpus;
+
+    for (s = strtok(str, ","); s; s = strtok(NULL, ","))
+    {
+        /* ...role name is terminated by colon */
+        CHK_ERR(t = strchr(s, ':'), -(errno = EINVAL));
+        *t++ = '\0';
+
+        /* ...priority is optionally followed by CPU mask */
+        prio = strtol(t, &t, 0);
+        cpus = (*t == ':' ? strtoul(t + 1, NULL, 0) : 0);
+
+        CHK_API(thread_placement_set(s, prio, cpus));
+
+        TRACE(INIT, _b("thread '%s': priority %d, cpus %X"), s, prio, cpus);
+    }
+
+    return 0;
+}
+
 /* ...parse camera format */
 static inline u32 parse_format(char *str)
 {
@@ -158,6 +280,31 @@ static inline u32 parse_format(char *str)
     }
 }
 
+/* ...parse compositor output format */
+static inline u32 parse_output_format(char *str)
+{
+    if (strcasecmp(str, "argb") == 0)
+    {
+        return V4L2_PIX_FMT_ARGB32;
+    }
+    else if (strcasecmp(str, "rgb565") == 0)
+    {
+        return V4L2_PIX_FMT_RGB565;
+    }
+    else if (strcasecmp(str, "uyvy") == 0)
+    {
+        return V4L2_PIX_FMT_UYVY;
+    }
+    else if (strcasecmp(str, "nv12") == 0)
+    {
+        return V4L2_PIX_FMT_NV12;
+    }
+    else
+    {
+        return 0;
+    }
+}
+
 /* ...parse steps number */
 static inline int parse_steps(char *str)
 {
@@ -219,6 +366,25 @@ static const struct option    options[] = {
     {   "gain",     required_argument,  NULL,   'g' },
     {   "bgcolor",  required_argument,  NULL,   'b' },
     {   "view",     required_argument,  NULL,   'V' },
+    {   "alpha",    required_argument,  NULL,   'A' },
+    {   "ascale",   required_argument,  NULL,   'F' },
+    {   "carcache", required_argument,  NULL,   'C' },
+    {   "atlas",    required_argument,  NULL,   'T' },
+    {   "snapshot", required_argument,  NULL,   'P' },
+    {   "oformat",  required_argument,  NULL,   'O' },
+    {   "pools",    required_argument,  NULL,   'B' },
+    {   "arena",    required_argument,  NULL,   'R' },
+    {   "sync",     required_argument,  NULL,   'Q' },
+    {   "latest",   required_argument,  NULL,   'L' },
+    {   "dispatch", required_argument,  NULL,   'D' },
+    {   "watchdog", required_argument,  NULL,   'G' },
+    {   "vinmap",   required_argument,  NULL,   'U' },
+    {   "replay",   required_argument,  NULL,   'I' },
+    {   "rate",     required_argument,  NULL,   'E' },
+    {   "record",   required_argument,  NULL,   'K' },
+    {   "threads",  required_argument,  NULL,   'Z' },
+    {   "isolate",  required_argument,  NULL,   'J' },
+    {   "reactor",  required_argument,  NULL,   'N' },
     {   NULL,       0,                  NULL,   0   },
 };
 
@@ -227,9 +393,10 @@ static int parse_cmdline(int argc, char **argv)
 {
     int     index = 0;
     int     opt;
+    int     vin_mmap = -1;
 
     /* ...process command-line parameters */
-    while ((opt = getopt_long(argc, argv, "d:v:o:j:r:f:w:h:W:H:X:Y:n:s:m:M:S:g:b:V:", options, &index)) >= 0)
+    while ((opt = getopt_long(argc, argv, "d:v:o:j:r:f:w:h:W:H:X:Y:n:s:m:M:S:g:b:V:A:F:C:T:P:O:B:R:Q:L:D:G:U:I:E:K:Z:J:N:", options, &index)) >= 0)
     {
         switch (opt)
         {
@@ -353,11 +520,136 @@ static int parse_cmdline(int argc, char **argv)
             CHK_API(parse_vec(optarg, __default_view, 3));
             break;
 
+        case 'A':
+            /* ...alpha-masks cache directory */
+            __alpha_cache_dir = optarg;
+            TRACE(INIT, _b("alpha-masks cache: '%s'"), __alpha_cache_dir);
+            break;
+
+        case 'F':
+            /* ...alpha-planes downscale factor */
+            CHK_ERR((__alpha_scale = atoi(optarg)) == 1 || __alpha_scale == 2 || __alpha_scale == 4, -(errno = EINVAL));
+            TRACE(INIT, _b("alpha-planes scale: 1/%d"), __alpha_scale);
+            break;
+
+        case 'C':
+            /* ...car images cache size */
+            CHK_ERR((u32)(__car_cache_size = atoi(optarg)) < 4096, -(errno = EINVAL));
+            TRACE(INIT, _b("car images cache: %d MB"), __car_cache_size);
+            break;
+
+        case 'T':
+            /* ...car sprites atlas */
+            __car_atlas = optarg;
+            TRACE(INIT, _b("car sprites atlas: '%s'"), __car_atlas);
+            break;
+
+        case 'P':
+            /* ...snapshot file format */
+            CHK_API(__snapshot_type = snapshot_format(optarg));
+            TRACE(INIT, _b("snapshot format: '%s'"), optarg);
+            break;
+
+        case 'O':
+            /* ...compositor output format */
+            TRACE(INIT, _b("Output format: '%s'"), optarg);
+            CHK_ERR(__vsp_format = parse_output_format(optarg), -(errno = EINVAL));
+            break;
+
+        case 'B':
+            /* ...buffer pools depths */
+            TRACE(INIT, _b("Pools: '%s'"), optarg);
+            CHK_API(pool_parse(optarg, __pool_depth, &__pool_profile));
+            break;
+
+        case 'R':
+            /* ...contiguous memory arena size */
+            CHK_ERR((u32)(__vsp_arena_size = atoi(optarg)) < 4096, -(errno = EINVAL));
+            TRACE(INIT, _b("memory arena: %d MB"), __vsp_arena_size);
+            break;
+
+        case 'Q':
+            /* ...cameras frames synchronization window */
+            CHK_ERR((u32)(__sync_window = atoi(optarg)) < 1000, -(errno = EINVAL));
+            TRACE(INIT, _b("synchronization window: %d ms"), __sync_window);
+            break;
+
+        case 'L':
+            /* ...latest-frame-wins mode */
+            CHK_ERR((u32)(__latest_depth = atoi(optarg)) <= 8, -(errno = EINVAL));
+            TRACE(INIT, _b("latest-frame-wins mode: %d pending frames"), __latest_depth);
+            break;
+
+        case 'D':
+            /* ...per-camera dispatch mode */
+            CHK_ERR((u32)(__camera_dispatch = atoi(optarg)) <= 1, -(errno = EINVAL));
+            TRACE(INIT, _b("per-camera dispatch: %s"), (__camera_dispatch ? "enabled" : "disabled"));
+            break;
+
+        case 'G':
+            /* ...camera stall watchdog */
+            CHK_ERR((u32)(__stall_timeout = atoi(optarg)) < 60000, -(errno = EINVAL));
+            TRACE(INIT, _b("camera stall timeout: %d ms"), __stall_timeout);
+            break;
+
+        case 'U':
+            /* ...VIN buffers user-space mapping */
+            CHK_ERR((u32)(__vin_mmap = vin_mmap = atoi(optarg)) <= 1, -(errno = EINVAL));
+            TRACE(INIT, _b("VIN buffers mapping: %s"), (__vin_mmap ? "enabled" : "disabled"));
+            break;
+
+        case 'I':
+            /* ...replay of recorded cameras */
+            TRACE(INIT, _b("replay recording: '%s'"), optarg);
+            CHK_API(__replay_files = parse_replay_files(optarg, replay_file_name, 4));
+            break;
+
+        case 'E':
+            /* ...replay rate */
+            CHK_ERR((__replay_rate = parse_replay_rate(optarg)) >= -1 && __replay_rate <= 1000, -(errno = EINVAL));
+            TRACE(INIT, _b("replay rate: %d"), __replay_rate);
+            break;
+
+        case 'K':
+            /* ...capture recording (frames are written from user-space mapping of VIN buffers) */
+            TRACE(INIT, _b("recording prefix: '%s'"), optarg);
+            __record_prefix = optarg;
+            break;
+
+        case 'Z':
+            /* ...threads scheduling priorities and affinities */
+            CHK_API(parse_threads(optarg));
+            break;
+
+        case 'J':
+            /* ...cores dedicated to completion threads */
+            thread_placement_isolate(strtoul(optarg, NULL, 0));
+            TRACE(INIT, _b("isolated cores: %s"), optarg);
+            break;
+
+        case 'N':
+            /* ...single event loop for completions processing */
+            CHK_ERR((u32)(__reactor_mode = atoi(optarg)) <= 1, -(errno = EINVAL));
+            TRACE(INIT, _b("single-reactor mode: %s"), (__reactor_mode ? "enabled" : "disabled"));
+            break;
+
         default:
             return -EINVAL;
         }
     }
 
+    /* ...recording reads frames through user-space mapping of VIN buffers */
+    if (__record_prefix)
+    {
+        if (vin_mmap == 0)
+        {
+            TRACE(ERROR, _x("recording requires VIN buffers mapping (-U 1)"));
+            return -(errno = EINVAL);
+        }
+
+        __vin_mmap = 1;
+    }
+
     return 0;
 }
 
@@ -379,6 +671,12 @@ int main(int argc, char **argv)
     /* ...parse application specific parameters */
     CHK_API(parse_cmdline(argc, argv));
 
+    /* ...create completions reactor before any of the engines is opened */
+    if (__reactor_mode)
+    {
+        CHK_ERR(reactor_create(), -errno);
+    }
+
     /* ...initialize display subsystem */
     CHK_ERR(display = display_create(), -errno);
 
@@ -388,6 +686,15 @@ int main(int argc, char **argv)
     /* ...execute mainloop thread */
     app_thread(app);
 
+    /* ...close processing engines */
+    app_exit(app);
+
+    /* ...destroy completions reactor once all engines are closed */
+    if (__reactor_mode)
+    {
+        reactor_destroy(reactor_get());
+    }
+
     TRACE(INIT, _b("application terminated"));
     
     return 0;
@@ -305,8 +305,8 @@ static __attribute__((noreturn))  void __write_error(png_structp png_ptr, png_co
     longjmp(*jbp, EBADF);
 }
 
-/* ...write PNG file */
-int store_png(const char *path, int width, int height, int format, void *data)
+/* ...write PNG file with given zlib compression level (negative - library default) */
+int store_png_level(const char *path, int width, int height, int format, void *data, int level)
 {
 	FILE                   *fp;
 	int                     y, stride = 0;
@@ -353,7 +353,7 @@ int store_png(const char *path, int width, int height, int format, void *data)
     png_init_io(png_ptr, fp);
 
     /* ...set compression level (zlib 0 to 9) */
-    //png_set_compression_level(png_ptr, 9);
+    if (level >= 0)     png_set_compression_level(png_ptr, level);
 
     /* ...set color format */
     switch (format)
@@ -411,3 +411,9 @@ error:
     fclose(fp);
     return -1;
 }
+
+/* ...write PNG file */
+int store_png(const char *path, int width, int height, int format, void *data)
+{
+    return store_png_level(path, width, height, format, data, -1);
+}
@@ -37,4 +37,7 @@ extern int create_png(const char *path, int *width, int *height, int *format, vo
 /* ...write PNG file */
 extern int store_png(const char *path, int width, int height, int format, void *data);
 
+/* ...write PNG file with given zlib compression level (negative - library default) */
+extern int store_png_level(const char *path, int width, int height, int format, void *data, int level);
+
 #endif  /* __UTEST_PNG_H */
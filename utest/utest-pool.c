@@ -0,0 +1,279 @@
+/*******************************************************************************
+ * utest-pool.c
+ *
+ * IMR unit test application - buffer pools sizing
+ *
+ * Copyright (c) 2016 Cogent Embedded Inc. ALL RIGHTS RESERVED.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#define MODULE_TAG                      POOL
+
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+
+#include "utest-common.h"
+#include "utest-pool.h"
+
+/*******************************************************************************
+ * Tracing configuration
+ ******************************************************************************/
+
+TRACE_TAG(INIT, 1);
+TRACE_TAG(INFO, 1);
+TRACE_TAG(DEBUG, 0);
+
+/*******************************************************************************
+ * Local types definitions
+ ******************************************************************************/
+
+/* ...number of frames between depth re-evaluations */
+#define POOL_STAT_PERIOD                256
+
+/* ...stages latency statistics */
+struct pool_stat
+{
+    /* ...profile file path */
+    char                   *path;
+
+    /* ...depths stored in a profile */
+    int                     depth[POOL_STAGES];
+
+    /* ...timestamps of buffers taken from the pools (zero if buffer is in a pool) */
+    u32                     ts[POOL_STAGES][POOL_DEPTH_MAX];
+
+    /* ...buffers residence time (decaying peak, usec) */
+    u32                     latency[POOL_STAGES];
+
+    /* ...smoothed input frame period (usec, 1/16 fixed-point) */
+    u32                     period;
+
+    /* ...last input frame timestamp */
+    u32                     frame_ts;
+
+    /* ...number of frames since last re-evaluation */
+    u32                     frames;
+
+    /* ...statistics access lock */
+    pthread_mutex_t         lock;
+};
+
+/*******************************************************************************
+ * Pools depths parsing
+ ******************************************************************************/
+
+/* ...parse pools depths ("camera:alpha:output" or "auto[:profile]") */
+int pool_parse(char *str, int *depth, char **profile)
+{
+    int     d[POOL_STAGES], i;
+
+    if (strncmp(str, "auto", 4) == 0)
+    {
+        /* ...depths are taken from a profile updated at run-time */
+        CHK_ERR(str[4] == '\0' || str[4] == ':', -(errno = EINVAL));
+        *profile = (str[4] ? str + 5 : "pools.cfg");
+        return 0;
+    }
+
+    CHK_ERR(sscanf(str, "%d:%d:%d", &d[0], &d[1], &d[2]) == 3, -(errno = EINVAL));
+
+    for (i = 0; i < POOL_STAGES; i++)
+    {
+        CHK_ERR(d[i] >= POOL_DEPTH_MIN && d[i] <= POOL_DEPTH_MAX, -(errno = EINVAL));
+        depth[i] = d[i];
+    }
+
+    *profile = NULL;
+
+    return 0;
+}
+
+/* ...load pools depths from a profile (keeps defaults if profile is missing) */
+int pool_profile_load(const char *path, int *depth)
+{
+    FILE   *f;
+    int     d[POOL_STAGES], i, r;
+
+    if ((f = fopen(path, "r")) == NULL)
+    {
+        TRACE(INIT, _b("no pools profile '%s'; use defaults"), path);
+        return 0;
+    }
+
+    r = fscanf(f, "%d %d %d", &d[0], &d[1], &d[2]);
+    fclose(f);
+
+    CHK_ERR(r == 3, -(errno = EINVAL));
+
+    for (i = 0; i < POOL_STAGES; i++)
+    {
+        depth[i] = (d[i] < POOL_DEPTH_MIN ? POOL_DEPTH_MIN : (d[i] > POOL_DEPTH_MAX ? POOL_DEPTH_MAX : d[i]));
+    }
+
+    TRACE(INIT, _b("pools profile '%s': %d:%d:%d"), path, depth[0], depth[1], depth[2]);
+
+    return 0;
+}
+
+/* ...write profile atomically */
+static int __pool_profile_store(const char *path, const int *depth)
+{
+    char    tmp[256];
+    FILE   *f;
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    CHK_ERR(f = fopen(tmp, "w"), -errno);
+    fprintf(f, "%d %d %d\n", depth[0], depth[1], depth[2]);
+    CHK_ERR(fclose(f) == 0, -errno);
+    CHK_ERR(rename(tmp, path) == 0, -errno);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * Latency statistics
+ ******************************************************************************/
+
+/* ...depth covering buffer residence time at given frame period (one frame of headroom) */
+static inline int __pool_depth(u32 latency, u32 period)
+{
+    int     d = (period ? (int)((latency + period - 1) / period) + 1 : POOL_DEPTH_MIN);
+
+    return (d < POOL_DEPTH_MIN ? POOL_DEPTH_MIN : (d > POOL_DEPTH_MAX ? POOL_DEPTH_MAX : d));
+}
+
+/* ...re-evaluate recommended depths (called with a lock held) */
+static void __pool_stat_update(pool_stat_t *stat)
+{
+    u32     period = stat->period >> 4;
+    int     depth[POOL_STAGES];
+    int     i;
+
+    /* ...alpha-planes are held for a view lifetime rather than a frame; keep configured depth */
+    for (i = 0; i < POOL_STAGES; i++)
+    {
+        depth[i] = (i == POOL_ALPHA ? stat->depth[i] : __pool_depth(stat->latency[i], period));
+    }
+
+    TRACE(INFO, _b("period: %u usec, latency: %u/%u usec, depth: %d:%d:%d"), period, stat->latency[POOL_CAMERA], stat->latency[POOL_OUTPUT], depth[0], depth[1], depth[2]);
+
+    /* ...update profile if recommendation has changed (takes effect on next start) */
+    if (memcmp(depth, stat->depth, sizeof(depth)))
+    {
+        if (__pool_profile_store(stat->path, depth) == 0)
+        {
+            TRACE(INIT, _b("pools profile '%s' updated: %d:%d:%d"), stat->path, depth[0], depth[1], depth[2]);
+            memcpy(stat->depth, depth, sizeof(depth));
+        }
+        else
+        {
+            TRACE(ERROR, _x("failed to update pools profile '%s': %m"), stat->path);
+        }
+    }
+}
+
+/* ...create stages latency statistics */
+pool_stat_t * pool_stat_create(const char *path, const int *depth)
+{
+    pool_stat_t    *stat;
+
+    CHK_ERR(stat = calloc(1, sizeof(*stat)), (errno = ENOMEM, NULL));
+    CHK_ERR(stat->path = strdup(path), (free(stat), errno = ENOMEM, NULL));
+    memcpy(stat->depth, depth, sizeof(stat->depth));
+    pthread_mutex_init(&stat->lock, NULL);
+
+    return stat;
+}
+
+/* ...mark arrival of input frame */
+void pool_stat_frame(pool_stat_t *stat)
+{
+    u32     ts = __get_time_usec();
+
+    if (!stat)  return;
+
+    pthread_mutex_lock(&stat->lock);
+
+    /* ...update smoothed frame period */
+    if (stat->frame_ts)
+    {
+        u32     delta = ts - stat->frame_ts;
+
+        stat->period = (stat->period ? stat->period - (stat->period >> 4) + delta : delta << 4);
+    }
+
+    stat->frame_ts = ts;
+
+    /* ...periodically re-evaluate depths */
+    if (++stat->frames == POOL_STAT_PERIOD)
+    {
+        __pool_stat_update(stat);
+        stat->frames = 0;
+    }
+
+    pthread_mutex_unlock(&stat->lock);
+}
+
+/* ...buffer leaves the pool */
+void pool_stat_get(pool_stat_t *stat, int stage, int j)
+{
+    if (!stat || (u32)j >= POOL_DEPTH_MAX)  return;
+
+    /* ...zero timestamp marks a buffer in the pool */
+    pthread_mutex_lock(&stat->lock);
+    stat->ts[stage][j] = __get_time_usec() | 1;
+    pthread_mutex_unlock(&stat->lock);
+}
+
+/* ...buffer returns to the pool */
+void pool_stat_put(pool_stat_t *stat, int stage, int j)
+{
+    u32     delta;
+
+    if (!stat || (u32)j >= POOL_DEPTH_MAX)  return;
+
+    pthread_mutex_lock(&stat->lock);
+
+    /* ...buffer was not accounted on retrieval */
+    if (!stat->ts[stage][j])
+    {
+        pthread_mutex_unlock(&stat->lock);
+        return;
+    }
+
+    delta = __get_time_usec() - stat->ts[stage][j];
+    stat->ts[stage][j] = 0;
+
+    /* ...decaying peak keeps track of hiccups */
+    stat->latency[stage] = (delta > stat->latency[stage] ? delta : stat->latency[stage] - (stat->latency[stage] >> 6));
+
+    pthread_mutex_unlock(&stat->lock);
+}
+
+/* ...destroy statistics */
+void pool_stat_destroy(pool_stat_t *stat)
+{
+    if (!stat)  return;
+
+    pthread_mutex_destroy(&stat->lock);
+    free(stat->path);
+    free(stat);
+}
@@ -0,0 +1,72 @@
+/*******************************************************************************
+ * utest-pool.h
+ *
+ * IMR unit test application - buffer pools sizing
+ *
+ * Copyright (c) 2016 Cogent Embedded Inc. ALL RIGHTS RESERVED.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#ifndef __UTEST_POOL_H
+#define __UTEST_POOL_H
+
+/*******************************************************************************
+ * Types definitions
+ ******************************************************************************/
+
+/* ...pipeline stages with configurable buffer pools */
+#define POOL_CAMERA                     0
+#define POOL_ALPHA                      1
+#define POOL_OUTPUT                     2
+#define POOL_STAGES                     3
+
+/* ...pool depth limits */
+#define POOL_DEPTH_MIN                  2
+#define POOL_DEPTH_MAX                  8
+
+/* ...opaque type */
+typedef struct pool_stat    pool_stat_t;
+
+/*******************************************************************************
+ * External API
+ ******************************************************************************/
+
+/* ...parse pools depths ("camera:alpha:output" or "auto[:profile]") */
+extern int pool_parse(char *str, int *depth, char **profile);
+
+/* ...load pools depths from a profile (keeps defaults if profile is missing) */
+extern int pool_profile_load(const char *path, int *depth);
+
+/* ...create stages latency statistics (profile is updated with recommended depths) */
+extern pool_stat_t * pool_stat_create(const char *path, const int *depth);
+
+/* ...mark arrival of input frame (frame period measurement) */
+extern void pool_stat_frame(pool_stat_t *stat);
+
+/* ...buffer leaves the pool */
+extern void pool_stat_get(pool_stat_t *stat, int stage, int j);
+
+/* ...buffer returns to the pool */
+extern void pool_stat_put(pool_stat_t *stat, int stage, int j);
+
+/* ...destroy statistics */
+extern void pool_stat_destroy(pool_stat_t *stat);
+
+#endif  /* __UTEST_POOL_H */
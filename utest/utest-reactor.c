@@ -0,0 +1,275 @@
+/*******************************************************************************
+ * utest-reactor.c
+ *
+ * IMR unit test application - single-reactor event loop
+ *
+ * Copyright (c) 2016 Cogent Embedded Inc. ALL RIGHTS RESERVED.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#define MODULE_TAG                      REACTOR
+
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+
+#include "utest-common.h"
+#include "utest-reactor.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+/*******************************************************************************
+ * Tracing configuration
+ ******************************************************************************/
+
+TRACE_TAG(INIT, 1);
+TRACE_TAG(INFO, 1);
+TRACE_TAG(DEBUG, 0);
+
+/*******************************************************************************
+ * Local types definitions
+ ******************************************************************************/
+
+/* ...maximal number of events retrieved at once */
+#define REACTOR_EVENTS_NUM              16
+
+/* ...reactor data */
+struct reactor
+{
+    /* ...epoll file descriptor */
+    int                     efd;
+
+    /* ...wake-up descriptor (forces another events batch) */
+    int                     evfd;
+
+    /* ...processing thread */
+    pthread_t               thread;
+
+    /* ...number of events batches retrieved and completed */
+    u32                     started, done;
+
+    /* ...thread is terminated */
+    int                     exited;
+
+    /* ...batch completion synchronization */
+    pthread_mutex_t         lock;
+    pthread_cond_t          wait;
+};
+
+/* ...process-wide reactor */
+static reactor_t       *__reactor;
+
+/*******************************************************************************
+ * Reactor thread
+ ******************************************************************************/
+
+/* ...event loop (every source is serviced to completion in turn) */
+static void * reactor_thread(void *arg)
+{
+    reactor_t          *reactor = arg;
+    struct epoll_event  event[REACTOR_EVENTS_NUM];
+    reactor_source_t   *source;
+    int                 r, k;
+
+    thread_placement(THREAD_REACTOR);
+
+    while (1)
+    {
+        /* ...wait for event (infinite timeout) */
+        r = epoll_wait(reactor->efd, event, REACTOR_EVENTS_NUM, -1);
+
+        /* ...check operation result */
+        if (r < 0)
+        {
+            /* ...ignore soft interruptions (e.g. from debugger) */
+            if (errno == EINTR)     continue;
+            TRACE(ERROR, _x("poll failed: %m"));
+            break;
+        }
+
+        /* ...disable cancellation while sources are being processed */
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+        pthread_mutex_lock(&reactor->lock);
+        reactor->started++;
+        pthread_mutex_unlock(&reactor->lock);
+
+        for (k = 0; k < r; k++)
+        {
+            /* ...wake-up event carries no source */
+            if ((source = event[k].data.ptr) == NULL)
+            {
+                u64     v;
+
+                (read(reactor->evfd, &v, sizeof(v)) < 0 ? TRACE(ERROR, _x("wake-up read failed: %m")), 0 : 0);
+                continue;
+            }
+
+            /* ...failed source is removed; other sources keep being serviced */
+            if (source->hook(source->cdata, source->id, event[k].events) < 0)
+            {
+                TRACE(ERROR, _x("source #%d processing failed: %m"), source->id);
+                epoll_ctl(reactor->efd, EPOLL_CTL_DEL, source->fd, NULL);
+            }
+        }
+
+        /* ...notify waiters that the batch is completed */
+        pthread_mutex_lock(&reactor->lock);
+        reactor->done = reactor->started;
+        pthread_cond_broadcast(&reactor->wait);
+        pthread_mutex_unlock(&reactor->lock);
+
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+    }
+
+    /* ...no more hooks are executed */
+    pthread_mutex_lock(&reactor->lock);
+    reactor->exited = 1;
+    pthread_cond_broadcast(&reactor->wait);
+    pthread_mutex_unlock(&reactor->lock);
+
+    TRACE(INIT, _b("thread exits: %m"));
+
+    return (void *)(intptr_t)-errno;
+}
+
+/*******************************************************************************
+ * External API
+ ******************************************************************************/
+
+/* ...add/remove descriptor to/from reactor poll set */
+int reactor_poll(reactor_t *reactor, int fd, reactor_source_t *source, int add)
+{
+    struct epoll_event  event;
+
+    /* ...specify waiting flags */
+    event.events = EPOLLIN, event.data.ptr = source, source->fd = fd;
+
+    /* ...add/remove source */
+    CHK_API(epoll_ctl(reactor->efd, (add ? EPOLL_CTL_ADD : EPOLL_CTL_DEL), fd, &event));
+
+    TRACE(DEBUG, _b("fd=%d: poll source %s"), fd, (add ? "added" : "removed"));
+
+    return 0;
+}
+
+/* ...wait until events retrieved before the call are processed (removed sources can be freed) */
+void reactor_sync(reactor_t *reactor)
+{
+    u64     v = 1;
+    u32     n;
+
+    /* ...hooks are never running when called from reactor thread itself */
+    if (pthread_equal(pthread_self(), reactor->thread))     return;
+
+    pthread_mutex_lock(&reactor->lock);
+
+    /* ...force another batch in case thread is waiting for events */
+    n = reactor->started;
+    (write(reactor->evfd, &v, sizeof(v)) < 0 ? TRACE(ERROR, _x("wake-up write failed: %m")), 0 : 0);
+
+    /* ...batch following the current one cannot contain removed sources */
+    while (!reactor->exited && (s32)(reactor->done - n) <= 0)
+    {
+        pthread_cond_wait(&reactor->wait, &reactor->lock);
+    }
+
+    pthread_mutex_unlock(&reactor->lock);
+}
+
+/* ...get process-wide reactor */
+reactor_t * reactor_get(void)
+{
+    return __reactor;
+}
+
+/* ...create process-wide reactor thread */
+reactor_t * reactor_create(void)
+{
+    reactor_t          *reactor;
+    pthread_attr_t      attr;
+    struct epoll_event  event;
+    int                 r;
+
+    CHK_ERR(reactor = calloc(1, sizeof(*reactor)), (errno = ENOMEM, NULL));
+
+    /* ...create epoll descriptor */
+    if ((reactor->efd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+    {
+        TRACE(ERROR, _x("failed to create epoll: %m"));
+        free(reactor);
+        return NULL;
+    }
+
+    /* ...create wake-up descriptor */
+    event.events = EPOLLIN, event.data.ptr = NULL;
+
+    if ((reactor->evfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0 || epoll_ctl(reactor->efd, EPOLL_CTL_ADD, reactor->evfd, &event) < 0)
+    {
+        TRACE(ERROR, _x("failed to create wake-up descriptor: %m"));
+        (reactor->evfd >= 0 ? close(reactor->evfd) : 0);
+        close(reactor->efd);
+        free(reactor);
+        return NULL;
+    }
+
+    pthread_mutex_init(&reactor->lock, NULL);
+    pthread_cond_init(&reactor->wait, NULL);
+
+    /* ...initialize thread attributes (joinable, 128KB stack) */
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    pthread_attr_setstacksize(&attr, 128 << 10);
+    r = pthread_create(&reactor->thread, &attr, reactor_thread, reactor);
+    pthread_attr_destroy(&attr);
+
+    if (r != 0)
+    {
+        TRACE(ERROR, _x("failed to create reactor thread: %d"), r);
+        pthread_cond_destroy(&reactor->wait);
+        pthread_mutex_destroy(&reactor->lock);
+        close(reactor->evfd);
+        close(reactor->efd);
+        free(reactor);
+        errno = r;
+        return NULL;
+    }
+
+    TRACE(INIT, _b("reactor created"));
+
+    return (__reactor = reactor);
+}
+
+/* ...stop reactor thread and destroy it */
+void reactor_destroy(reactor_t *reactor)
+{
+    (__reactor == reactor ? __reactor = NULL : 0);
+
+    pthread_cancel(reactor->thread);
+    pthread_join(reactor->thread, NULL);
+
+    pthread_cond_destroy(&reactor->wait);
+    pthread_mutex_destroy(&reactor->lock);
+    close(reactor->evfd);
+    close(reactor->efd);
+    free(reactor);
+
+    TRACE(INIT, _b("reactor destroyed"));
+}
@@ -0,0 +1,73 @@
+/*******************************************************************************
+ * utest-reactor.h
+ *
+ * IMR unit test application - single-reactor event loop
+ *
+ * Copyright (c) 2016 Cogent Embedded Inc. ALL RIGHTS RESERVED.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#ifndef __UTEST_REACTOR_H
+#define __UTEST_REACTOR_H
+
+/*******************************************************************************
+ * Types definitions
+ ******************************************************************************/
+
+/* ...opaque type */
+typedef struct reactor      reactor_t;
+
+/* ...event source (descriptor handler runs to completion in reactor thread) */
+typedef struct reactor_source
+{
+    /* ...event processing hook */
+    int               (*hook)(void *cdata, int id, u32 events);
+
+    /* ...hook client data */
+    void               *cdata;
+
+    /* ...source identifier within a client */
+    int                 id;
+
+    /* ...polled descriptor (set by reactor) */
+    int                 fd;
+
+}   reactor_source_t;
+
+/*******************************************************************************
+ * External API
+ ******************************************************************************/
+
+/* ...create process-wide reactor thread */
+extern reactor_t * reactor_create(void);
+
+/* ...get process-wide reactor (NULL - modules run their own threads) */
+extern reactor_t * reactor_get(void);
+
+/* ...add/remove descriptor to/from reactor poll set */
+extern int reactor_poll(reactor_t *reactor, int fd, reactor_source_t *source, int add);
+
+/* ...wait until hooks of removed sources cannot run anymore (call without client locks held) */
+extern void reactor_sync(reactor_t *reactor);
+
+/* ...stop reactor thread and destroy it */
+extern void reactor_destroy(reactor_t *reactor);
+
+#endif  /* __UTEST_REACTOR_H */
@@ -0,0 +1,406 @@
+/*******************************************************************************
+ * utest-record.c
+ *
+ * IMR unit test application - cameras capture recorder
+ *
+ * Copyright (c) 2016 Cogent Embedded Inc. ALL RIGHTS RESERVED.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#define MODULE_TAG                      RECORD
+
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+
+#include "utest-common.h"
+#include "utest-vsink.h"
+#include "utest-record.h"
+#include <fcntl.h>
+#include <limits.h>
+
+/*******************************************************************************
+ * Tracing configuration
+ ******************************************************************************/
+
+TRACE_TAG(INIT, 1);
+TRACE_TAG(INFO, 1);
+TRACE_TAG(DEBUG, 0);
+
+/*******************************************************************************
+ * Local types definitions
+ ******************************************************************************/
+
+/* ...alignment of direct I/O transfers */
+#define RECORD_ALIGN                    4096
+
+/* ...camera stream */
+typedef struct record_stream
+{
+    /* ...raw frames file descriptor */
+    int                     fd;
+
+    /* ...direct I/O is in use (page cache is bypassed) */
+    int                     direct;
+
+    /* ...timestamps/sequence numbers file */
+    FILE                   *pts;
+
+    /* ...frame size (evaluated on first frame) */
+    size_t                  size;
+
+    /* ...number of frames held by recorder */
+    u32                     pending;
+
+    /* ...statistics */
+    u32                     written, dropped;
+
+    /* ...writing has failed (stream is not recorded any more) */
+    int                     failed;
+
+}   record_stream_t;
+
+/* ...pending frame */
+typedef struct record_frame
+{
+    /* ...camera index */
+    int                     i;
+
+    /* ...capture buffer (reference held) */
+    GstBuffer              *buffer;
+
+}   record_frame_t;
+
+/* ...recorder */
+struct recorder
+{
+    /* ...number of cameras */
+    int                     num;
+
+    /* ...cameras streams */
+    record_stream_t        *stream;
+
+    /* ...pending frames ring (never overflows as each camera is limited) */
+    record_frame_t         *ring;
+
+    /* ...ring head and fill level */
+    u32                     head, count;
+
+    /* ...writer thread termination flag */
+    int                     exit;
+
+    /* ...internal data access lock */
+    pthread_mutex_t         lock;
+
+    /* ...writer thread wake-up condition */
+    pthread_cond_t          wait;
+
+    /* ...writer thread handle */
+    pthread_t               thread;
+};
+
+/*******************************************************************************
+ * Frames writing
+ ******************************************************************************/
+
+/* ...switch stream to buffered I/O */
+static void __record_direct_off(record_stream_t *s, int i)
+{
+    fcntl(s->fd, F_SETFL, fcntl(s->fd, F_GETFL) & ~O_DIRECT);
+    s->direct = 0;
+
+    TRACE(INFO, _b("camera-%d: direct I/O disabled"), i);
+}
+
+/* ...write raw frame data */
+static int __record_write(record_stream_t *s, int i, const u8 *data, size_t size)
+{
+    ssize_t     n;
+
+    /* ...direct I/O requires aligned memory and length */
+    if (s->direct && (((uintptr_t)data | size) & (RECORD_ALIGN - 1)))
+    {
+        __record_direct_off(s, i);
+    }
+
+    while (size > 0)
+    {
+        if ((n = write(s->fd, data, size)) < 0)
+        {
+            if (errno == EINTR)     continue;
+
+            /* ...filesystem may reject direct I/O on write only; device mappings (vb2 dma-contig) yield EFAULT */
+            if ((errno == EINVAL || errno == EFAULT) && s->direct)
+            {
+                __record_direct_off(s, i);
+                continue;
+            }
+
+            return -errno;
+        }
+
+        data += n, size -= n;
+    }
+
+    return 0;
+}
+
+/* ...write frame and its timestamp record */
+static int __record_frame(recorder_t *rec, int i, GstBuffer *buffer)
+{
+    record_stream_t    *s = &rec->stream[i];
+    vsink_meta_t       *vmeta = gst_buffer_get_vsink_meta(buffer);
+    GstVideoInfo        info;
+    u32                 t0, t1;
+    int                 r;
+
+    /* ...evaluate frame size once */
+    if (s->size == 0)
+    {
+        gst_video_info_set_format(&info, vmeta->format, vmeta->width, vmeta->height);
+        CHK_ERR((s->size = GST_VIDEO_INFO_SIZE(&info)) > 0, -(errno = EINVAL));
+    }
+
+    t0 = __get_time_usec();
+
+    /* ...write frame straight from capture buffer */
+    if ((r = __record_write(s, i, vmeta->plane[0], s->size)) < 0)
+    {
+        TRACE(ERROR, _x("camera-%d: write failed: %s"), i, strerror(-r));
+        return r;
+    }
+
+    t1 = __get_time_usec();
+
+    /* ...record capture timestamp (ns) and sequence number */
+    fprintf(s->pts, "%llu %lld\n", (unsigned long long)GST_BUFFER_PTS(buffer), (long long)(gint64)GST_BUFFER_OFFSET(buffer));
+
+    TRACE(DEBUG, _b("camera-%d: frame written in %u usec"), i, (u32)(t1 - t0));
+
+    return 0;
+}
+
+/*******************************************************************************
+ * Writer thread
+ ******************************************************************************/
+
+/* ...background writing thread (pending frames are written before exit) */
+static void * recorder_thread(void *arg)
+{
+    recorder_t         *rec = arg;
+    record_frame_t      f;
+    int                 r;
+
+    thread_placement(THREAD_WORKER);
+
+    pthread_mutex_lock(&rec->lock);
+
+    while (1)
+    {
+        if (rec->count == 0)
+        {
+            if (rec->exit)  break;
+
+            pthread_cond_wait(&rec->wait, &rec->lock);
+            continue;
+        }
+
+        /* ...take oldest frame */
+        f = rec->ring[rec->head];
+        rec->head = (rec->head + 1) % (rec->num * RECORD_QUEUE_MAX), rec->count--;
+
+        pthread_mutex_unlock(&rec->lock);
+
+        r = __record_frame(rec, f.i, f.buffer);
+
+        /* ...return buffer to capturing pool */
+        gst_buffer_unref(f.buffer);
+
+        pthread_mutex_lock(&rec->lock);
+
+        /* ...failed stream is not recorded any more */
+        rec->stream[f.i].pending--;
+        (r < 0 ? rec->stream[f.i].failed = 1 : rec->stream[f.i].written++);
+    }
+
+    pthread_mutex_unlock(&rec->lock);
+
+    return NULL;
+}
+
+/*******************************************************************************
+ * External API
+ ******************************************************************************/
+
+/* ...close streams files */
+static void __recorder_close(recorder_t *rec)
+{
+    record_stream_t    *s;
+    int                 i;
+
+    for (i = 0; rec->stream && i < rec->num; i++)
+    {
+        s = &rec->stream[i];
+        (s->fd >= 0 ? close(s->fd) : 0);
+        (s->pts ? fclose(s->pts) : 0);
+    }
+
+    free(rec->ring);
+    free(rec->stream);
+    free(rec);
+}
+
+/* ...create recorder thread */
+recorder_t * recorder_create(const char *prefix, int num)
+{
+    recorder_t         *rec;
+    record_stream_t    *s;
+    pthread_attr_t      attr;
+    char                path[PATH_MAX];
+    int                 i, r;
+
+    CHK_ERR(rec = calloc(1, sizeof(*rec)), (errno = ENOMEM, NULL));
+
+    if ((rec->stream = calloc(rec->num = num, sizeof(*rec->stream))) == NULL ||
+        (rec->ring = calloc(num * RECORD_QUEUE_MAX, sizeof(*rec->ring))) == NULL)
+    {
+        errno = ENOMEM;
+        goto error;
+    }
+
+    for (i = 0; i < num; i++)
+    {
+        rec->stream[i].fd = -1;
+    }
+
+    for (i = 0; i < num; i++)
+    {
+        s = &rec->stream[i];
+
+        /* ...raw frames bypass page cache if filesystem allows */
+        snprintf(path, sizeof(path), "%s-%d.raw", prefix, i);
+        if ((s->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644)) >= 0)
+        {
+            s->direct = 1;
+        }
+        else if ((s->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+        {
+            TRACE(ERROR, _x("failed to create file '%s': %m"), path);
+            goto error;
+        }
+
+        snprintf(path, sizeof(path), "%s-%d.raw.pts", prefix, i);
+        if ((s->pts = fopen(path, "w")) == NULL)
+        {
+            TRACE(ERROR, _x("failed to create file '%s': %m"), path);
+            goto error;
+        }
+
+        TRACE(INIT, _b("camera-%d: recording to '%s-%d.raw' (direct I/O: %d)"), i, prefix, i, s->direct);
+    }
+
+    pthread_mutex_init(&rec->lock, NULL);
+    pthread_cond_init(&rec->wait, NULL);
+
+    /* ...initialize thread attributes (joinable, 128KB stack) */
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    pthread_attr_setstacksize(&attr, 128 << 10);
+    r = pthread_create(&rec->thread, &attr, recorder_thread, rec);
+    pthread_attr_destroy(&attr);
+
+    if (r != 0)
+    {
+        TRACE(ERROR, _x("failed to create recorder thread: %d"), r);
+        pthread_cond_destroy(&rec->wait);
+        pthread_mutex_destroy(&rec->lock);
+        errno = r;
+        goto error;
+    }
+
+    TRACE(INIT, _b("recorder created (%d cameras)"), num);
+
+    return rec;
+
+error:
+    __recorder_close(rec);
+    return NULL;
+}
+
+/* ...queue camera buffer for writing */
+int recorder_store(recorder_t *rec, int i, GstBuffer *buffer)
+{
+    vsink_meta_t       *vmeta = gst_buffer_get_vsink_meta(buffer);
+    record_stream_t    *s;
+    u32                 k;
+    int                 busy;
+
+    /* ...frame is written from user-space mapping of capture buffer */
+    CHK_ERR((u32)i < (u32)rec->num && vmeta && vmeta->plane[0], -(errno = EINVAL));
+
+    pthread_mutex_lock(&rec->lock);
+
+    s = &rec->stream[i];
+
+    /* ...refuse frame if disk is not keeping up (capturing pool is never starved) */
+    if ((busy = (s->failed || s->pending >= RECORD_QUEUE_MAX)) != 0)
+    {
+        s->dropped++;
+    }
+    else
+    {
+        k = (rec->head + rec->count++) % (rec->num * RECORD_QUEUE_MAX);
+        rec->ring[k].i = i, rec->ring[k].buffer = gst_buffer_ref(buffer);
+        s->pending++;
+        pthread_cond_signal(&rec->wait);
+    }
+
+    pthread_mutex_unlock(&rec->lock);
+
+    if (busy)
+    {
+        TRACE(DEBUG, _b("camera-%d: frame not recorded (dropped: %u)"), i, s->dropped);
+        return -(errno = EBUSY);
+    }
+
+    return 0;
+}
+
+/* ...write pending frames and destroy recorder */
+void recorder_destroy(recorder_t *rec)
+{
+    int     i;
+
+    pthread_mutex_lock(&rec->lock);
+    rec->exit = 1;
+    pthread_cond_signal(&rec->wait);
+    pthread_mutex_unlock(&rec->lock);
+
+    pthread_join(rec->thread, NULL);
+
+    for (i = 0; i < rec->num; i++)
+    {
+        TRACE(INIT, _b("camera-%d: %u frames recorded, %u dropped"), i, rec->stream[i].written, rec->stream[i].dropped);
+    }
+
+    pthread_cond_destroy(&rec->wait);
+    pthread_mutex_destroy(&rec->lock);
+    __recorder_close(rec);
+}
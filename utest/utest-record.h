@@ -0,0 +1,53 @@
+/*******************************************************************************
+ * utest-record.h
+ *
+ * IMR unit test application - cameras capture recorder
+ *
+ * Copyright (c) 2016 Cogent Embedded Inc. ALL RIGHTS RESERVED.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#ifndef __UTEST_RECORD_H
+#define __UTEST_RECORD_H
+
+/*******************************************************************************
+ * Types definitions
+ ******************************************************************************/
+
+/* ...maximal number of frames of a camera held by recorder (capture pool is not starved) */
+#define RECORD_QUEUE_MAX                2
+
+/* ...opaque type */
+typedef struct recorder     recorder_t;
+
+/*******************************************************************************
+ * External API
+ ******************************************************************************/
+
+/* ...create recorder thread (files "<prefix>-<i>.raw" and "<prefix>-<i>.raw.pts") */
+extern recorder_t * recorder_create(const char *prefix, int num);
+
+/* ...queue camera buffer for writing (reference is held until frame is written) */
+extern int recorder_store(recorder_t *rec, int i, GstBuffer *buffer);
+
+/* ...write pending frames and destroy recorder */
+extern void recorder_destroy(recorder_t *rec);
+
+#endif  /* __UTEST_RECORD_H */
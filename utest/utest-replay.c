@@ -0,0 +1,749 @@
+/*******************************************************************************
+ * utest-replay.c
+ *
+ * IMR unit test application - recorded cameras replay
+ *
+ * Copyright (c) 2016 Cogent Embedded Inc. ALL RIGHTS RESERVED.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#define MODULE_TAG                      REPLAY
+
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+
+#include "utest-common.h"
+#include "utest-camera.h"
+#include "utest-vsink.h"
+#include "utest-compositor.h"
+#include "utest-replay.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <linux/videodev2.h>
+
+/*******************************************************************************
+ * Tracing configuration
+ ******************************************************************************/
+
+TRACE_TAG(INIT, 1);
+TRACE_TAG(INFO, 1);
+TRACE_TAG(DEBUG, 0);
+
+/*******************************************************************************
+ * Local constants definitions
+ ******************************************************************************/
+
+/* ...maximal size of camera buffer pool */
+#define REPLAY_POOL_SIZE                32
+
+/* ...frame period of a recording without timestamps (30 fps) */
+#define REPLAY_DEFAULT_PERIOD           33333333ULL
+
+/*******************************************************************************
+ * Local types definitions
+ ******************************************************************************/
+
+/* ...mapped recording file */
+typedef struct replay_file
+{
+    /* ...file data */
+    u8                     *data;
+
+    /* ...file length */
+    size_t                  length;
+
+    /* ...recorded frames timestamps (nanoseconds; NULL if not available) */
+    u64                    *pts;
+
+    /* ...number of timestamps */
+    u32                     pts_num;
+
+}   replay_file_t;
+
+/* ...buffer description */
+typedef struct replay_buffer
+{
+    /* ...contiguous memory block */
+    vsp_mem_t              *mem;
+
+    /* ...exported frame memory */
+    vsp_dmabuf_t           *dmabuf;
+
+    /* ...associated GStreamer buffer */
+    GstBuffer              *buffer;
+
+    /* ...buffer is owned by application */
+    int                     busy;
+
+}   replay_buffer_t;
+
+/* ...camera stream */
+typedef struct replay_device
+{
+    /* ...first frame of a camera */
+    u8                     *data;
+
+    /* ...distance between subsequent frames of a camera */
+    size_t                  step;
+
+    /* ...frame size */
+    u32                     size;
+
+    /* ...number of recorded frames */
+    u32                     frames;
+
+    /* ...timestamp of the first frame and distance between camera timestamps */
+    u64                    *pts;
+    int                     pts_step;
+
+    /* ...buffers pool */
+    replay_buffer_t         pool[REPLAY_POOL_SIZE];
+
+    /* ...buffers pool length */
+    int                     num;
+
+    /* ...index of next buffer to deliver */
+    int                     index;
+
+    /* ...number of busy buffers (owned by application) */
+    int                     busy;
+
+}   replay_device_t;
+
+/* ...replay source data */
+struct replay_data
+{
+    /* ...number of cameras */
+    int                         num;
+
+    /* ...camera-specific data */
+    replay_device_t            *dev;
+
+    /* ...number of recording files (single file keeps interleaved cameras) */
+    int                         files;
+
+    /* ...mapped recording files */
+    replay_file_t              *file;
+
+    /* ...delivery rate (frames per second; REPLAY_RATE_PTS, REPLAY_RATE_MAX) */
+    int                         rate;
+
+    /* ...number of frames delivered per camera before the recording is looped */
+    u32                         frames;
+
+    /* ...recording timeline origin and duration (nanoseconds) */
+    u64                         pts0, duration;
+
+    /* ...source activity state */
+    int                         active;
+
+    /* ...data access lock */
+    pthread_mutex_t             lock;
+
+    /* ...buffer returning conditional */
+    pthread_cond_t              wait;
+
+    /* ...delivery thread */
+    pthread_t                   thread;
+
+    /* ...application-provided callback */
+    const camera_callback_t    *cb;
+
+    /* ...application callback data */
+    void                       *cdata;
+};
+
+/*******************************************************************************
+ * Internal helpers
+ ******************************************************************************/
+
+/* ...monotonic time in nanoseconds (same clock as VIN timestamps) */
+static inline u64 __replay_time(void)
+{
+    struct timespec     ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (u64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* ...sleep until absolute monotonic time */
+static inline void __replay_sleep(u64 t)
+{
+    struct timespec     ts;
+
+    ts.tv_sec = t / 1000000000ULL, ts.tv_nsec = t % 1000000000ULL;
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+}
+
+/* ...frame planes layout */
+static inline int __replay_frame_planes(int w, int h, u32 fmt, u32 *size, u32 *stride)
+{
+    int     N = w * h;
+
+    switch(fmt)
+    {
+    case V4L2_PIX_FMT_GREY:
+        return size[0] = N, stride[0] = w, 1;
+    case V4L2_PIX_FMT_UYVY:
+    case V4L2_PIX_FMT_YUYV:
+        return size[0] = N * 2, stride[0] = w * 2, 1;
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_NV21:
+        return size[0] = N, size[1] = N >> 1, stride[0] = stride[1] = w, 2;
+    case V4L2_PIX_FMT_NV16:
+        return size[0] = size[1] = N, stride[0] = stride[1] = w, 2;
+    default:
+        return TRACE(ERROR, _b("unrecognized format: %X: %c%c%c%c"), fmt, __v4l2_fmt(fmt)), 0;
+    }
+}
+
+/* ...load frames timestamps ("<file>.pts", decimal nanoseconds per line) */
+static int __replay_pts_load(replay_file_t *file, const char *name)
+{
+    char                path[PATH_MAX];
+    FILE               *f;
+    unsigned long long  t;
+    u32                 n = 0;
+
+    snprintf(path, sizeof(path), "%s.pts", name);
+
+    /* ...timestamps are optional */
+    if ((f = fopen(path, "r")) == NULL)
+    {
+        TRACE(INFO, _b("no timestamps for '%s'"), name);
+        return 0;
+    }
+
+    /* ...count records first (rest of a line, e.g. sequence number, is ignored) */
+    while (fscanf(f, "%llu%*[^\n]", &t) == 1)  n++;
+
+    if (n && (file->pts = malloc(n * sizeof(u64))) != NULL)
+    {
+        for (rewind(f); file->pts_num < n && fscanf(f, "%llu%*[^\n]", &t) == 1; )
+        {
+            file->pts[file->pts_num++] = t;
+        }
+    }
+
+    fclose(f);
+
+    TRACE(INIT, _b("'%s': %u timestamps loaded"), path, file->pts_num);
+
+    return (n && !file->pts ? -(errno = ENOMEM) : 0);
+}
+
+/* ...position of camera frame on the recording timeline */
+static inline u64 __replay_pts(replay_data_t *replay, replay_device_t *dev, u32 n)
+{
+    u32     k = n % replay->frames;
+
+    /* ...fixed rate ignores recorded timestamps */
+    if (replay->rate > 0)
+    {
+        return (u64)n * 1000000000ULL / replay->rate;
+    }
+
+    /* ...recording without timestamps is paced with a default rate */
+    if (!dev->pts)
+    {
+        return (u64)n * REPLAY_DEFAULT_PERIOD;
+    }
+
+    return dev->pts[k * dev->pts_step] - replay->pts0 + (u64)(n / replay->frames) * replay->duration;
+}
+
+/* ...set recording timeline (called before delivery starts) */
+static void __replay_timeline(replay_data_t *replay)
+{
+    u64     t0 = ~0ULL, t1 = 0, period = REPLAY_DEFAULT_PERIOD;
+    int     i;
+
+    /* ...all cameras are looped at the same frame */
+    for (i = 0, replay->frames = ~0U; i < replay->num; i++)
+    {
+        (replay->dev[i].frames < replay->frames ? replay->frames = replay->dev[i].frames : 0);
+    }
+
+    for (i = 0; i < replay->num; i++)
+    {
+        replay_device_t    *dev = &replay->dev[i];
+        u64                 t;
+
+        if (!dev->pts)  continue;
+
+        (dev->pts[0] < t0 ? t0 = dev->pts[0] : 0);
+        ((t = dev->pts[(replay->frames - 1) * dev->pts_step]) > t1 ? t1 = t : 0);
+        (replay->frames > 1 ? period = dev->pts[dev->pts_step] - dev->pts[0] : 0);
+    }
+
+    /* ...loop continues with the interval of the first frames */
+    replay->pts0 = (t0 <= t1 ? t0 : 0);
+    replay->duration = (t0 <= t1 ? t1 - t0 : 0) + period;
+
+    TRACE(INIT, _b("recording timeline: %u frames, %u ms"), replay->frames, (u32)(replay->duration / 1000000));
+}
+
+/*******************************************************************************
+ * Buffer pool handling
+ ******************************************************************************/
+
+/* ...buffer dispose function (called in response to "gst_buffer_unref") */
+static gboolean __replay_buffer_dispose(GstMiniObject *obj)
+{
+    GstBuffer          *buffer = GST_BUFFER(obj);
+    replay_data_t      *replay = (replay_data_t *)buffer->pool;
+    replay_buffer_t    *buf = NULL;
+    gboolean            destroy;
+    int                 i, j;
+
+    /* ...lock internal data access */
+    pthread_mutex_lock(&replay->lock);
+
+    /* ...locate buffer descriptor */
+    for (i = 0; !buf && i < replay->num; i++)
+    {
+        for (j = 0; j < replay->dev[i].num; j++)
+        {
+            if (replay->dev[i].pool[j].buffer == buffer)
+            {
+                buf = &replay->dev[i].pool[j];
+                break;
+            }
+        }
+    }
+
+    BUG(!buf || (replay->active && !buf->busy), _x("invalid buffer: %p"), buffer);
+
+    /* ...return buffer to the pool */
+    (buf->busy ? buf->busy = 0, replay->dev[i - 1].busy-- : 0);
+
+    TRACE(DEBUG, _b("buffer #<%d,%d> returned to pool"), i - 1, j);
+
+    if (replay->active)
+    {
+        /* ...keep the reference */
+        gst_buffer_ref(buffer);
+        destroy = FALSE;
+    }
+    else
+    {
+        /* ...source is being destroyed; force destruction of the miniobject */
+        buf->buffer = NULL;
+        destroy = TRUE;
+    }
+
+    /* ...resume delivery thread or destructor waiting for a buffer */
+    pthread_cond_broadcast(&replay->wait);
+
+    pthread_mutex_unlock(&replay->lock);
+
+    return destroy;
+}
+
+/* ...take next free buffer of a camera (called with a lock held) */
+static inline replay_buffer_t * __replay_buffer_get(replay_device_t *dev)
+{
+    replay_buffer_t    *buf;
+    int                 k;
+
+    /* ...buffers are mostly returned in delivery order; application may hold some longer */
+    for (k = 0; k < dev->num; k++)
+    {
+        buf = &dev->pool[dev->index];
+        dev->index = (dev->index + 1 == dev->num ? 0 : dev->index + 1);
+
+        if (!buf->busy)
+        {
+            buf->busy = 1, dev->busy++;
+            return buf;
+        }
+    }
+
+    return NULL;
+}
+
+/*******************************************************************************
+ * Delivery thread
+ ******************************************************************************/
+
+/* ...deliver camera frame (called with a lock held) */
+static int __replay_deliver(replay_data_t *replay, int i, u32 n, u64 t)
+{
+    replay_device_t    *dev = &replay->dev[i];
+    replay_buffer_t    *buf;
+    GstBuffer          *buffer;
+    int                 r;
+
+    /* ...wait for a free buffer (consumers pace the delivery) */
+    while ((buf = __replay_buffer_get(dev)) == NULL)
+    {
+        /* ...bail out if source is being destroyed */
+        if (!replay->active)    return 0;
+
+        pthread_cond_wait(&replay->wait, &replay->lock);
+    }
+
+    /* ...copy frame out of the mapped recording */
+    memcpy(vsp_mem_ptr(buf->mem), dev->data + (n % replay->frames) * dev->step, dev->size);
+
+    /* ...set decoding/presentation timestamp (in nanoseconds) */
+    buffer = buf->buffer;
+    GST_BUFFER_DTS(buffer) = GST_BUFFER_PTS(buffer) = t;
+
+    /* ...frame number stands for capture sequence number */
+    GST_BUFFER_OFFSET(buffer) = n;
+
+    TRACE(DEBUG, _b("camera-%d: frame #%u delivered, ts=%llu"), i, n, (unsigned long long)t);
+
+    /* ...release lock before passing buffer to the application */
+    pthread_mutex_unlock(&replay->lock);
+
+    r = replay->cb->process(replay->cdata, i, buffer);
+
+    /* ...drop the reference (buffer is now owned by application) */
+    gst_buffer_unref(buffer);
+
+    pthread_mutex_lock(&replay->lock);
+
+    return CHK_API(r);
+}
+
+/* ...delivery thread */
+static void * replay_thread(void *arg)
+{
+    replay_data_t  *replay = arg;
+    u64             t0 = __replay_time(), t;
+    u32             n;
+    int             i;
+
+    thread_placement(THREAD_INPUT);
+
+    pthread_mutex_lock(&replay->lock);
+
+    for (n = 0; replay->active; n++)
+    {
+        if (n && n % replay->frames == 0)
+        {
+            TRACE(INFO, _b("recording looped (%u frames)"), n);
+        }
+
+        for (i = 0; replay->active && i < replay->num; i++)
+        {
+            t = t0 + __replay_pts(replay, &replay->dev[i], n);
+
+            /* ...wait until the frame is due */
+            if (replay->rate != REPLAY_RATE_MAX)
+            {
+                pthread_mutex_unlock(&replay->lock);
+                __replay_sleep(t);
+                pthread_mutex_lock(&replay->lock);
+            }
+
+            /* ...source may have been stopped while sleeping */
+            if (!replay->active)    break;
+
+            if (__replay_deliver(replay, i, n, t) < 0)
+            {
+                TRACE(ERROR, _x("camera-%d: delivery failed: %m"), i);
+                goto out;
+            }
+        }
+    }
+
+out:
+    pthread_mutex_unlock(&replay->lock);
+
+    TRACE(INIT, _b("thread exits"));
+
+    return NULL;
+}
+
+/*******************************************************************************
+ * API functions
+ ******************************************************************************/
+
+/* ...camera stream initialization */
+int replay_device_init(replay_data_t *replay, int i, int w, int h, u32 fmt, int size)
+{
+    replay_device_t    *dev = &replay->dev[i];
+    replay_file_t      *file;
+    u32                 plane[GST_VIDEO_MAX_PLANES], stride[GST_VIDEO_MAX_PLANES];
+    int                 n, j, k;
+
+    /* ...make sure we have proper index and pool size */
+    CHK_ERR((u32)i < (u32)replay->num && size > 0 && size <= REPLAY_POOL_SIZE, -(errno = EINVAL));
+
+    /* ...get frame layout */
+    CHK_ERR((n = __replay_frame_planes(w, h, fmt, plane, stride)) > 0, -(errno = EINVAL));
+    for (k = 0, dev->size = 0; k < n; k++)
+    {
+        dev->size += plane[k];
+    }
+
+    /* ...locate camera frames in a recording */
+    if (replay->files == 1)
+    {
+        file = &replay->file[0];
+        dev->data = file->data + (size_t)i * dev->size;
+        dev->step = (size_t)replay->num * dev->size;
+        dev->pts = (file->pts ? file->pts + i : NULL), dev->pts_step = replay->num;
+    }
+    else
+    {
+        file = &replay->file[i];
+        dev->data = file->data;
+        dev->step = dev->size;
+        dev->pts = file->pts, dev->pts_step = 1;
+    }
+
+    /* ...number of complete frames */
+    CHK_ERR((dev->frames = (file->length - (dev->data - file->data)) / dev->step) > 0, -(errno = ENODATA));
+
+    /* ...timestamps must cover all frames */
+    if (dev->pts && file->pts_num < (dev->frames - 1) * dev->pts_step + (dev->pts - file->pts) + 1)
+    {
+        TRACE(ERROR, _b("camera-%d: %u timestamps for %u frames; ignored"), i, file->pts_num, dev->frames);
+        dev->pts = NULL;
+    }
+
+    /* ...create buffers pool */
+    for (j = 0, dev->num = size; j < size; j++)
+    {
+        replay_buffer_t    *buf = &dev->pool[j];
+        GstBuffer          *buffer;
+        vsink_meta_t       *vmeta;
+
+        /* ...allocate contiguous memory and export it as a single descriptor */
+        CHK_ERR(buf->mem = vsp_mem_alloc(dev->size), -errno);
+        CHK_ERR(buf->dmabuf = vsp_dmabuf_export(buf->mem, 0, dev->size), -errno);
+
+        /* ...allocate empty GStreamer buffer */
+        CHK_ERR(buf->buffer = buffer = gst_buffer_new(), -(errno = ENOMEM));
+
+        /* ...add vsink metadata */
+        CHK_ERR(vmeta = gst_buffer_add_vsink_meta(buffer), -(errno = ENOMEM));
+        vmeta->width = w;
+        vmeta->height = h;
+        vmeta->format = __pixfmt_v4l2_to_gst(fmt);
+        vmeta->plane[0] = vsp_mem_ptr(buf->mem);
+
+        /* ...planes share a descriptor (as VIN buffers do) */
+        for (k = 0; k < n; k++)
+        {
+            vmeta->dmafd[k] = vsp_dmabuf_fd(buf->dmabuf);
+            vmeta->offset[k] = (k ? vmeta->offset[k - 1] + plane[k - 1] : 0);
+            vmeta->stride[k] = stride[k];
+        }
+
+        GST_META_FLAG_SET(vmeta, GST_META_FLAG_POOLED);
+
+        /* ...modify buffer release callback */
+        GST_MINI_OBJECT(buffer)->dispose = __replay_buffer_dispose;
+
+        /* ...use "pool" pointer as a custom data */
+        buffer->pool = (void *)replay;
+
+        /* ...notify application on buffer allocation */
+        CHK_API(replay->cb->allocate(replay->cdata, i, buffer));
+    }
+
+    TRACE(INIT, _b("camera-%d: %u frames of %d*%d %c%c%c%c (%d buffers)"), i, dev->frames, w, h, __v4l2_fmt(fmt), size);
+
+    return 0;
+}
+
+/* ...start frames delivery */
+int replay_start(replay_data_t *replay)
+{
+    pthread_attr_t  attr;
+    int             r;
+
+    /* ...set recording timeline */
+    __replay_timeline(replay);
+
+    /* ...mark source is active */
+    replay->active = 1;
+
+    /* ...initialize thread attributes (joinable, 128KB stack) */
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    pthread_attr_setstacksize(&attr, 128 << 10);
+
+    r = pthread_create(&replay->thread, &attr, replay_thread, replay);
+    pthread_attr_destroy(&attr);
+
+    CHK_ERR(r == 0, -(errno = r));
+
+    TRACE(INIT, _b("replay started"));
+
+    return 0;
+}
+
+/* ...stop delivery and destroy source (waits until application returns all buffers) */
+void replay_destroy(replay_data_t *replay)
+{
+    int     i, j, started;
+
+    /* ...stop delivery thread */
+    pthread_mutex_lock(&replay->lock);
+    started = replay->active, replay->active = 0;
+    pthread_cond_broadcast(&replay->wait);
+    pthread_mutex_unlock(&replay->lock);
+
+    (started ? pthread_join(replay->thread, NULL) : 0);
+
+    pthread_mutex_lock(&replay->lock);
+
+    for (i = 0; i < replay->num; i++)
+    {
+        replay_device_t    *dev = &replay->dev[i];
+
+        /* ...wait until all buffers are collected */
+        while (dev->busy)
+        {
+            pthread_cond_wait(&replay->wait, &replay->lock);
+        }
+
+        /* ...destroy buffers pool */
+        for (j = 0; j < REPLAY_POOL_SIZE; j++)
+        {
+            replay_buffer_t    *buf = &dev->pool[j];
+
+            (buf->buffer ? gst_buffer_unref(buf->buffer) : 0);
+            (buf->dmabuf ? vsp_dmabuf_unexport(buf->dmabuf) : 0);
+            (buf->mem ? vsp_mem_free(buf->mem) : 0);
+        }
+    }
+
+    pthread_mutex_unlock(&replay->lock);
+
+    /* ...unmap recording files */
+    for (i = 0; i < replay->files; i++)
+    {
+        (replay->file[i].data ? munmap(replay->file[i].data, replay->file[i].length) : 0);
+        free(replay->file[i].pts);
+    }
+
+    pthread_cond_destroy(&replay->wait);
+    pthread_mutex_destroy(&replay->lock);
+    free(replay->file);
+    free(replay->dev);
+    free(replay);
+
+    TRACE(INIT, _b("replay source destroyed"));
+}
+
+/* ...open recording */
+replay_data_t * replay_init(char **filename, int files, int num, int rate, camera_callback_t *cb, void *cdata)
+{
+    replay_data_t          *replay;
+    pthread_mutexattr_t     attr;
+    struct stat             st;
+    int                     i, fd;
+
+    /* ...single interleaved file or a file per camera */
+    CHK_ERR(files == 1 || files == num, (errno = EINVAL, NULL));
+
+    /* ...create source structure */
+    CHK_ERR(replay = calloc(1, sizeof(*replay)), (errno = ENOMEM, NULL));
+
+    /* ...save application provided callback */
+    replay->cb = cb, replay->cdata = cdata, replay->rate = rate;
+
+    /* ...allocate cameras and files descriptors */
+    if ((replay->dev = calloc(replay->num = num, sizeof(replay_device_t))) == NULL ||
+        (replay->file = calloc(replay->files = files, sizeof(replay_file_t))) == NULL)
+    {
+        TRACE(ERROR, _x("failed to allocate memory"));
+        errno = ENOMEM;
+        goto error;
+    }
+
+    /* ...map recording files */
+    for (i = 0; i < files; i++)
+    {
+        replay_file_t  *file = &replay->file[i];
+
+        if ((fd = open(filename[i], O_RDONLY)) < 0)
+        {
+            TRACE(ERROR, _x("failed to open file '%s': %m"), filename[i]);
+            goto error;
+        }
+
+        if (fstat(fd, &st) < 0 || (file->length = st.st_size) == 0)
+        {
+            TRACE(ERROR, _x("invalid file '%s'"), filename[i]);
+            close(fd);
+            errno = EINVAL;
+            goto error;
+        }
+
+        file->data = mmap(NULL, file->length, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+
+        if (file->data == MAP_FAILED)
+        {
+            TRACE(ERROR, _x("failed to map file '%s': %m"), filename[i]);
+            file->data = NULL;
+            goto error;
+        }
+
+        /* ...recording is read sequentially */
+        madvise(file->data, file->length, MADV_SEQUENTIAL);
+
+        if (__replay_pts_load(file, filename[i]) < 0)
+        {
+            goto error;
+        }
+
+        TRACE(INIT, _b("recording '%s' mapped (%zu bytes)"), filename[i], file->length);
+    }
+
+    /* ...initialize internal data access lock */
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&replay->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    pthread_cond_init(&replay->wait, NULL);
+
+    TRACE(INIT, _b("replay source initialized: %d cameras, %d file(s), rate=%d"), num, files, rate);
+
+    return replay;
+
+error:
+    for (i = 0; replay->file && i < files; i++)
+    {
+        (replay->file[i].data ? munmap(replay->file[i].data, replay->file[i].length) : 0);
+        free(replay->file[i].pts);
+    }
+
+    free(replay->file);
+    free(replay->dev);
+    free(replay);
+
+    return NULL;
+}
@@ -0,0 +1,57 @@
+/*******************************************************************************
+ * utest-replay.h
+ *
+ * IMR unit test application - recorded cameras replay
+ *
+ * Copyright (c) 2016 Cogent Embedded Inc. ALL RIGHTS RESERVED.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#ifndef __UTEST_REPLAY_H
+#define __UTEST_REPLAY_H
+
+/*******************************************************************************
+ * Types definitions
+ ******************************************************************************/
+
+/* ...opaque type */
+typedef struct replay_data  replay_data_t;
+
+/* ...delivery pacing: recorded timestamps or as fast as consumers return buffers */
+#define REPLAY_RATE_PTS                 -1
+#define REPLAY_RATE_MAX                 0
+
+/*******************************************************************************
+ * External API
+ ******************************************************************************/
+
+/* ...open recording (single file with interleaved cameras, or one file per camera) */
+extern replay_data_t * replay_init(char **filename, int files, int num, int rate, camera_callback_t *cb, void *cdata);
+
+/* ...camera stream initialization (allocates a pool of exportable buffers) */
+extern int replay_device_init(replay_data_t *replay, int i, int w, int h, u32 fmt, int size);
+
+/* ...start frames delivery */
+extern int replay_start(replay_data_t *replay);
+
+/* ...stop delivery and destroy source (waits until application returns all buffers) */
+extern void replay_destroy(replay_data_t *replay);
+
+#endif  /* __UTEST_REPLAY_H */
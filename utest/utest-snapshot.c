@@ -0,0 +1,362 @@
+/*******************************************************************************
+ * utest-snapshot.c
+ *
+ * IMR unit test application - asynchronous snapshot writer
+ *
+ * Copyright (c) 2016 Cogent Embedded Inc. ALL RIGHTS RESERVED.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#define MODULE_TAG                      SNAPSHOT
+
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+
+#include "utest-common.h"
+#include "utest-snapshot.h"
+#include "utest-png.h"
+
+/*******************************************************************************
+ * Tracing configuration
+ ******************************************************************************/
+
+TRACE_TAG(INIT, 1);
+TRACE_TAG(INFO, 1);
+TRACE_TAG(DEBUG, 0);
+
+/*******************************************************************************
+ * Local types definitions
+ ******************************************************************************/
+
+/* ...zlib compression level of PNG snapshots (favour speed over size) */
+#define SNAPSHOT_PNG_LEVEL              1
+
+/* ...pending snapshot */
+typedef struct snapshot
+{
+    /* ...output file path (without extension) */
+    char                   *path;
+
+    /* ...image dimensions and format */
+    int                     w, h, format;
+
+    /* ...copied pixels */
+    u8                     *data;
+
+}   snapshot_t;
+
+/* ...snapshot writer */
+struct snapshot_writer
+{
+    /* ...file format */
+    int                     type;
+
+    /* ...pending snapshots queue */
+    GQueue                  queue;
+
+    /* ...writer thread termination flag */
+    int                     exit;
+
+    /* ...internal data access lock */
+    pthread_mutex_t         lock;
+
+    /* ...writer thread wake-up condition */
+    pthread_cond_t          wait;
+
+    /* ...writer thread handle */
+    pthread_t               thread;
+};
+
+/*******************************************************************************
+ * Snapshot encoding
+ ******************************************************************************/
+
+/* ...bytes per pixel of supported formats */
+static inline int __pixel_size(int format)
+{
+    switch (format)
+    {
+    case GST_VIDEO_FORMAT_GRAY8:    return 1;
+    case GST_VIDEO_FORMAT_RGB:      return 3;
+    case GST_VIDEO_FORMAT_ARGB:     return 4;
+    default:                        return 0;
+    }
+}
+
+/* ...raw file extension describing memory layout of pixels */
+static inline const char * __raw_extension(int format)
+{
+    return (format == GST_VIDEO_FORMAT_GRAY8 ? "y8" : (format == GST_VIDEO_FORMAT_RGB ? "bgr" : "bgra"));
+}
+
+/* ...write pixels as they are stored in memory */
+static int __store_raw(snapshot_t *s, const char *path)
+{
+    FILE       *fp;
+    size_t      size = (size_t)s->w * s->h * __pixel_size(s->format);
+    int         r = 0;
+
+    CHK_ERR(fp = fopen(path, "wb"), -errno);
+
+    (fwrite(s->data, 1, size, fp) != size ? r = -errno : 0);
+    (fclose(fp) != 0 && r == 0 ? r = -errno : 0);
+
+    return r;
+}
+
+/* ...write binary PGM (greyscale) or PPM (colour, alpha is dropped) */
+static int __store_ppm(snapshot_t *s, const char *path)
+{
+    FILE       *fp;
+    int         bpp = __pixel_size(s->format);
+    int         n = (bpp == 1 ? 1 : 3);
+    u8         *row, *src;
+    int         x, y, r = 0;
+
+    CHK_ERR(row = malloc(s->w * n), -(errno = ENOMEM));
+
+    if ((fp = fopen(path, "wb")) == NULL)
+    {
+        r = -errno;
+        goto out;
+    }
+
+    fprintf(fp, "P%d\n%d %d\n255\n", (n == 1 ? 5 : 6), s->w, s->h);
+
+    for (y = 0, src = s->data; y < s->h && r == 0; y++)
+    {
+        if (n == 1)
+        {
+            memcpy(row, src, s->w), src += s->w;
+        }
+        else
+        {
+            /* ...native colour order is BGR(A) */
+            for (x = 0; x < s->w; x++, src += bpp)
+            {
+                row[3 * x + 0] = src[2];
+                row[3 * x + 1] = src[1];
+                row[3 * x + 2] = src[0];
+            }
+        }
+
+        (fwrite(row, n, s->w, fp) != (size_t)s->w ? r = -errno : 0);
+    }
+
+    (fclose(fp) != 0 && r == 0 ? r = -errno : 0);
+
+out:
+    free(row);
+    return r;
+}
+
+/* ...encode snapshot into a file */
+static int __snapshot_write(int type, snapshot_t *s)
+{
+    char        path[PATH_MAX];
+    int         bpp = __pixel_size(s->format);
+    int         r;
+
+    switch (type)
+    {
+    case SNAPSHOT_RAW:
+        snprintf(path, sizeof(path), "%s-%dx%d.%s", s->path, s->w, s->h, __raw_extension(s->format));
+        r = __store_raw(s, path);
+        break;
+
+    case SNAPSHOT_PPM:
+        snprintf(path, sizeof(path), "%s.%s", s->path, (bpp == 1 ? "pgm" : "ppm"));
+        r = __store_ppm(s, path);
+        break;
+
+    default:
+        snprintf(path, sizeof(path), "%s.png", s->path);
+        r = store_png_level(path, s->w, s->h, s->format, s->data, SNAPSHOT_PNG_LEVEL);
+    }
+
+    if (r != 0)
+    {
+        TRACE(ERROR, _x("failed to write snapshot '%s': %d"), path, r);
+    }
+    else
+    {
+        TRACE(INFO, _b("snapshot '%s' stored"), path);
+    }
+
+    return r;
+}
+
+/* ...destroy snapshot */
+static void __snapshot_free(snapshot_t *s)
+{
+    free(s->data);
+    free(s->path);
+    free(s);
+}
+
+/*******************************************************************************
+ * Writer thread
+ ******************************************************************************/
+
+/* ...background encoding thread (pending snapshots are written before exit) */
+static void * snapshot_thread(void *arg)
+{
+    snapshot_writer_t  *writer = arg;
+    snapshot_t         *s;
+    u32                 t0, t1;
+
+    thread_placement(THREAD_WORKER);
+
+    pthread_mutex_lock(&writer->lock);
+
+    while (1)
+    {
+        if ((s = g_queue_pop_head(&writer->queue)) == NULL)
+        {
+            if (writer->exit)   break;
+
+            pthread_cond_wait(&writer->wait, &writer->lock);
+            continue;
+        }
+
+        pthread_mutex_unlock(&writer->lock);
+
+        t0 = __get_time_usec();
+        __snapshot_write(writer->type, s);
+        t1 = __get_time_usec();
+
+        TRACE(DEBUG, _b("snapshot encoded in %u usec"), (u32)(t1 - t0));
+
+        __snapshot_free(s);
+
+        pthread_mutex_lock(&writer->lock);
+    }
+
+    pthread_mutex_unlock(&writer->lock);
+
+    return NULL;
+}
+
+/*******************************************************************************
+ * External API
+ ******************************************************************************/
+
+/* ...parse snapshot format name */
+int snapshot_format(const char *name)
+{
+    if (!strcmp(name, "raw"))   return SNAPSHOT_RAW;
+    if (!strcmp(name, "ppm"))   return SNAPSHOT_PPM;
+    if (!strcmp(name, "png"))   return SNAPSHOT_PNG;
+
+    return -(errno = EINVAL);
+}
+
+/* ...create snapshot writer thread */
+snapshot_writer_t * snapshot_writer_create(int type)
+{
+    snapshot_writer_t  *writer;
+    pthread_attr_t      attr;
+    int                 r;
+
+    CHK_ERR(writer = calloc(1, sizeof(*writer)), (errno = ENOMEM, NULL));
+
+    writer->type = type;
+    g_queue_init(&writer->queue);
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->wait, NULL);
+
+    /* ...initialize thread attributes (joinable, 128KB stack) */
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    pthread_attr_setstacksize(&attr, 128 << 10);
+    r = pthread_create(&writer->thread, &attr, snapshot_thread, writer);
+    pthread_attr_destroy(&attr);
+
+    if (r != 0)
+    {
+        TRACE(ERROR, _x("failed to create snapshot thread: %d"), r);
+        pthread_cond_destroy(&writer->wait);
+        pthread_mutex_destroy(&writer->lock);
+        free(writer);
+        errno = r;
+        return NULL;
+    }
+
+    TRACE(INIT, _b("snapshot writer created (format=%d)"), type);
+
+    return writer;
+}
+
+/* ...copy image and queue it for writing */
+int snapshot_store(snapshot_writer_t *writer, const char *path, int w, int h, int format, const void *data)
+{
+    snapshot_t     *s;
+    size_t          size = (size_t)w * h * __pixel_size(format);
+    int             busy;
+
+    CHK_ERR(w > 0 && h > 0 && size > 0, -(errno = EINVAL));
+
+    /* ...refuse snapshot if writer is not keeping up (nothing is copied) */
+    pthread_mutex_lock(&writer->lock);
+    busy = (g_queue_get_length(&writer->queue) >= SNAPSHOT_QUEUE_MAX);
+    pthread_mutex_unlock(&writer->lock);
+
+    if (busy)
+    {
+        TRACE(ERROR, _x("snapshot '%s' dropped: writer busy"), path);
+        return -(errno = EBUSY);
+    }
+
+    CHK_ERR(s = calloc(1, sizeof(*s)), -(errno = ENOMEM));
+
+    if ((s->path = strdup(path)) == NULL || (s->data = malloc(size)) == NULL)
+    {
+        __snapshot_free(s);
+        return -(errno = ENOMEM);
+    }
+
+    s->w = w, s->h = h, s->format = format;
+    memcpy(s->data, data, size);
+
+    pthread_mutex_lock(&writer->lock);
+    g_queue_push_tail(&writer->queue, s);
+    pthread_cond_signal(&writer->wait);
+    pthread_mutex_unlock(&writer->lock);
+
+    TRACE(DEBUG, _b("snapshot '%s' queued: %d*%d, format=%d"), path, w, h, format);
+
+    return 0;
+}
+
+/* ...write pending snapshots and destroy writer */
+void snapshot_writer_destroy(snapshot_writer_t *writer)
+{
+    pthread_mutex_lock(&writer->lock);
+    writer->exit = 1;
+    pthread_cond_signal(&writer->wait);
+    pthread_mutex_unlock(&writer->lock);
+
+    pthread_join(writer->thread, NULL);
+
+    pthread_cond_destroy(&writer->wait);
+    pthread_mutex_destroy(&writer->lock);
+    free(writer);
+}
@@ -0,0 +1,62 @@
+/*******************************************************************************
+ * utest-snapshot.h
+ *
+ * IMR unit test application - asynchronous snapshot writer
+ *
+ * Copyright (c) 2016 Cogent Embedded Inc. ALL RIGHTS RESERVED.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+
+#ifndef __UTEST_SNAPSHOT_H
+#define __UTEST_SNAPSHOT_H
+
+/*******************************************************************************
+ * Types definitions
+ ******************************************************************************/
+
+/* ...snapshot file formats */
+#define SNAPSHOT_RAW                    0
+#define SNAPSHOT_PPM                    1
+#define SNAPSHOT_PNG                    2
+
+/* ...maximal number of pending snapshots */
+#define SNAPSHOT_QUEUE_MAX              4
+
+/* ...opaque type */
+typedef struct snapshot_writer  snapshot_writer_t;
+
+/*******************************************************************************
+ * External API
+ ******************************************************************************/
+
+/* ...parse snapshot format name ("raw", "ppm" or "png") */
+extern int snapshot_format(const char *name);
+
+/* ...create snapshot writer thread */
+extern snapshot_writer_t * snapshot_writer_create(int type);
+
+/* ...copy image and queue it for writing (path has no extension) */
+extern int snapshot_store(snapshot_writer_t *writer, const char *path, int w, int h, int format, const void *data);
+
+/* ...write pending snapshots and destroy writer */
+extern void snapshot_writer_destroy(snapshot_writer_t *writer);
+
+#endif  /* __UTEST_SNAPSHOT_H */
@@ -0,0 +1,363 @@
+/*******************************************************************************
+ * utest-sync.c
+ *
+ * IMR unit test application - multi-camera frames synchronization
+ *
+ * Copyright (c) 2016 Cogent Embedded Inc. ALL RIGHTS RESERVED.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#define MODULE_TAG                      SYNC
+
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+
+#include "utest-common.h"
+#include "utest-sync.h"
+
+/*******************************************************************************
+ * Tracing configuration
+ ******************************************************************************/
+
+TRACE_TAG(INIT, 1);
+TRACE_TAG(INFO, 1);
+TRACE_TAG(DEBUG, 0);
+
+/*******************************************************************************
+ * Local types definitions
+ ******************************************************************************/
+
+/* ...number of aligned sets between drop statistics reports */
+#define SYNC_REPORT_PERIOD              1024
+
+/* ...frames synchronizer */
+struct frame_sync
+{
+    /* ...number of streams */
+    int                     n;
+
+    /* ...maximal number of frames queued per stream */
+    int                     depth;
+
+    /* ...matching tolerance window (nanoseconds) */
+    u64                     window;
+
+    /* ...pending frames queues */
+    GQueue                  queue[SYNC_STREAMS_MAX];
+
+    /* ...empty queues mask */
+    u32                     empty;
+
+    /* ...absent streams mask (not matched; reported as NULL frames) */
+    u32                     absent;
+
+    /* ...number of frames dropped per stream */
+    u32                     dropped[SYNC_STREAMS_MAX];
+
+    /* ...number of aligned sets retrieved */
+    u32                     sets;
+};
+
+/*******************************************************************************
+ * Internal helpers
+ ******************************************************************************/
+
+/* ...drop the oldest frame of a stream */
+static inline void __sync_drop(frame_sync_t *sync, int i)
+{
+    GstBuffer      *buffer = g_queue_pop_head(&sync->queue[i]);
+
+    TRACE(DEBUG, _b("stream-%d: frame dropped (pts=%llu)"), i, (unsigned long long)GST_BUFFER_PTS(buffer));
+
+    gst_buffer_unref(buffer);
+
+    sync->dropped[i]++;
+
+    (g_queue_is_empty(&sync->queue[i]) ? sync->empty |= 1 << i : 0);
+}
+
+/* ...time span of frames selected in each stream queue */
+static GstClockTime __sync_skew(frame_sync_t *sync, int *pos, int *oldest)
+{
+    GstClockTime    ts, t0 = ~0ULL, t1 = 0;
+    int             i;
+
+    for (i = 0; i < sync->n; i++)
+    {
+        if (sync->absent & (1 << i))    continue;
+
+        ts = GST_BUFFER_PTS((GstBuffer *)g_queue_peek_nth(&sync->queue[i], pos[i]));
+
+        (ts < t0 ? t0 = ts, *oldest = i : 0), (ts > t1 ? t1 = ts : 0);
+    }
+
+    return t1 - t0;
+}
+
+/* ...full queue forces a set with minimal skew instead of waiting for a match */
+static void __sync_fallback(frame_sync_t *sync)
+{
+    int             pos[SYNC_STREAMS_MAX] = { 0 }, best[SYNC_STREAMS_MAX] = { 0 };
+    GstClockTime    skew, min;
+    int             i, j;
+
+    /* ...advance the oldest selected frame and keep the positions of the smallest spread */
+    for (min = __sync_skew(sync, pos, &j); pos[j] + 1 < (int)g_queue_get_length(&sync->queue[j]); )
+    {
+        if (!GST_CLOCK_TIME_IS_VALID(GST_BUFFER_PTS((GstBuffer *)g_queue_peek_nth(&sync->queue[j], pos[j] + 1))))
+        {
+            break;
+        }
+
+        pos[j]++;
+
+        if ((skew = __sync_skew(sync, pos, &j)) < min)
+        {
+            min = skew, memcpy(best, pos, sizeof(best));
+        }
+    }
+
+    TRACE(DEBUG, _b("queue is full: set with skew=%u us is forced"), (u32)(min / 1000));
+
+    /* ...drop frames preceding the selected ones */
+    for (i = 0; i < sync->n; i++)
+    {
+        while (best[i]-- > 0)
+        {
+            __sync_drop(sync, i);
+        }
+    }
+}
+
+/* ...drop frames that cannot be matched; return non-zero if heads are aligned */
+static int __sync_align(frame_sync_t *sync)
+{
+    /* ...at least one stream must be present */
+    if (sync->absent == (1U << sync->n) - 1)
+    {
+        return 0;
+    }
+
+    while ((sync->empty & ~sync->absent) == 0)
+    {
+        GstClockTime    ts, tmax = 0;
+        int             i, k, m;
+
+        /* ...positional matching if disabled */
+        if (sync->window == 0)
+        {
+            return 1;
+        }
+
+        /* ...find the latest head frame (frames without timestamp are matched by position) */
+        for (i = 0; i < sync->n; i++)
+        {
+            if (sync->absent & (1 << i))    continue;
+
+            ts = GST_BUFFER_PTS((GstBuffer *)g_queue_peek_head(&sync->queue[i]));
+
+            if (!GST_CLOCK_TIME_IS_VALID(ts))
+            {
+                return 1;
+            }
+
+            (ts > tmax ? tmax = ts : 0);
+        }
+
+        /* ...heads older than the window are dropped once a newer frame of the stream supersedes them */
+        for (i = k = m = 0; i < sync->n; i++)
+        {
+            GstBuffer  *next;
+
+            if (sync->absent & (1 << i))    continue;
+
+            ts = GST_BUFFER_PTS((GstBuffer *)g_queue_peek_head(&sync->queue[i]));
+
+            if (ts + sync->window >= tmax)  continue;
+
+            m++;
+
+            if ((next = g_queue_peek_nth(&sync->queue[i], 1)) != NULL && GST_BUFFER_PTS(next) <= tmax)
+            {
+                __sync_drop(sync, i), k++;
+            }
+        }
+
+        /* ...all heads are within the window */
+        if (m == 0)
+        {
+            return 1;
+        }
+
+        /* ...nothing was superseded; full queue cannot wait for a match any longer */
+        for (i = 0; k == 0 && i < sync->n; i++)
+        {
+            if (sync->absent & (1 << i))    continue;
+
+            if ((int)g_queue_get_length(&sync->queue[i]) == sync->depth)
+            {
+                __sync_fallback(sync);
+                return 1;
+            }
+        }
+
+        /* ...wait for more frames */
+        if (k == 0)
+        {
+            return 0;
+        }
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * API functions
+ ******************************************************************************/
+
+/* ...queue stream frame */
+int frame_sync_push(frame_sync_t *sync, int i, GstBuffer *buffer)
+{
+    /* ...sanity check */
+    CHK_ERR((u32)i < (u32)sync->n, -(errno = EINVAL));
+
+    /* ...bounded queue keeps the latest frames */
+    if ((int)g_queue_get_length(&sync->queue[i]) == sync->depth)
+    {
+        __sync_drop(sync, i);
+    }
+
+    /* ...add frame to a queue */
+    g_queue_push_tail(&sync->queue[i], gst_buffer_ref(buffer));
+
+    sync->empty &= ~(1 << i);
+
+    return 0;
+}
+
+/* ...retrieve temporally aligned frames set */
+int frame_sync_pop(frame_sync_t *sync, GstBuffer **buf)
+{
+    GstClockTime    t0, t1;
+    int             i;
+
+    /* ...check if aligned set is available */
+    if (!__sync_align(sync))
+    {
+        return 0;
+    }
+
+    /* ...pass ownership of head frames to the caller */
+    for (i = 0, t0 = ~0ULL, t1 = 0; i < sync->n; i++)
+    {
+        GstClockTime    ts;
+
+        /* ...absent stream has no frame in a set */
+        if (sync->absent & (1 << i))
+        {
+            buf[i] = NULL;
+            continue;
+        }
+
+        ts = GST_BUFFER_PTS(buf[i] = g_queue_pop_head(&sync->queue[i]));
+
+        (ts < t0 ? t0 = ts : 0), (ts > t1 ? t1 = ts : 0);
+
+        (g_queue_is_empty(&sync->queue[i]) ? sync->empty |= 1 << i : 0);
+    }
+
+    TRACE(DEBUG, _b("aligned set retrieved: skew=%u us"), (sync->window ? (u32)((t1 - t0) / 1000) : 0));
+
+    /* ...report drop statistics periodically */
+    if (++sync->sets % SYNC_REPORT_PERIOD == 0)
+    {
+        for (i = 0; i < sync->n; i++)
+        {
+            (sync->dropped[i] ? TRACE(INFO, _b("stream-%d: %u frames dropped"), i, sync->dropped[i]), 0 : 0);
+        }
+    }
+
+    return 1;
+}
+
+/* ...mark streams that stopped delivering frames */
+void frame_sync_absent(frame_sync_t *sync, u32 mask)
+{
+    int     i;
+
+    mask &= (1U << sync->n) - 1;
+
+    /* ...frames left in the queues of absent streams are stale */
+    for (i = 0; i < sync->n; i++)
+    {
+        while ((mask & ~sync->absent & (1 << i)) && !g_queue_is_empty(&sync->queue[i]))
+        {
+            __sync_drop(sync, i);
+        }
+    }
+
+    if (mask != sync->absent)
+    {
+        TRACE(INFO, _b("absent streams: %X -> %X"), sync->absent, mask);
+        sync->absent = mask;
+    }
+}
+
+/* ...number of stream frames dropped */
+u32 frame_sync_dropped(frame_sync_t *sync, int i)
+{
+    return ((u32)i < (u32)sync->n ? sync->dropped[i] : 0);
+}
+
+/* ...create synchronizer */
+frame_sync_t * frame_sync_create(int n, u64 window, int depth)
+{
+    frame_sync_t   *sync;
+
+    /* ...sanity check */
+    CHK_ERR(n > 0 && n <= SYNC_STREAMS_MAX && depth > 0, (errno = EINVAL, NULL));
+
+    /* ...allocate synchronizer data */
+    CHK_ERR(sync = calloc(1, sizeof(*sync)), (errno = ENOMEM, NULL));
+
+    sync->n = n, sync->window = window, sync->depth = depth;
+
+    /* ...all queues are empty */
+    sync->empty = (1 << n) - 1;
+
+    TRACE(INIT, _b("frames synchronizer: %d streams, window=%u us, depth=%d"), n, (u32)(window / 1000), depth);
+
+    return sync;
+}
+
+/* ...destroy synchronizer */
+void frame_sync_destroy(frame_sync_t *sync)
+{
+    int     i;
+
+    for (i = 0; i < sync->n; i++)
+    {
+        g_queue_foreach(&sync->queue[i], (GFunc)gst_buffer_unref, NULL);
+        g_queue_clear(&sync->queue[i]);
+    }
+
+    free(sync);
+}
@@ -0,0 +1,62 @@
+/*******************************************************************************
+ * utest-sync.h
+ *
+ * IMR unit test application - multi-camera frames synchronization
+ *
+ * Copyright (c) 2016 Cogent Embedded Inc. ALL RIGHTS RESERVED.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#ifndef __UTEST_SYNC_H
+#define __UTEST_SYNC_H
+
+/*******************************************************************************
+ * Types definitions
+ ******************************************************************************/
+
+/* ...maximal number of synchronized streams */
+#define SYNC_STREAMS_MAX                8
+
+/* ...opaque type */
+typedef struct frame_sync   frame_sync_t;
+
+/*******************************************************************************
+ * External API (access is serialized by the caller)
+ ******************************************************************************/
+
+/* ...create synchronizer (window in nanoseconds; 0 - match frames by queue position) */
+extern frame_sync_t * frame_sync_create(int n, u64 window, int depth);
+
+/* ...queue stream frame (takes a reference; drops the oldest frame of a full queue) */
+extern int frame_sync_push(frame_sync_t *sync, int i, GstBuffer *buffer);
+
+/* ...retrieve temporally aligned frames set (ownership is passed to the caller) */
+extern int frame_sync_pop(frame_sync_t *sync, GstBuffer **buf);
+
+/* ...mark streams that stopped delivering frames (sets carry NULL in their slots) */
+extern void frame_sync_absent(frame_sync_t *sync, u32 mask);
+
+/* ...number of stream frames dropped */
+extern u32 frame_sync_dropped(frame_sync_t *sync, int i);
+
+/* ...destroy synchronizer (releases queued frames) */
+extern void frame_sync_destroy(frame_sync_t *sync);
+
+#endif  /* __UTEST_SYNC_H */
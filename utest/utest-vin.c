@@ -33,6 +33,8 @@
 #include "utest-common.h"
 #include "utest-camera.h"
 #include "utest-vsink.h"
+#include "utest-vin.h"
+#include "utest-reactor.h"
 #include <fcntl.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
@@ -55,13 +57,33 @@ TRACE_TAG(DEBUG, 1);
 /* ...individual camera buffer pool size */
 #define VIN_BUFFER_POOL_SIZE            5
 
+/* ...number of frames of a camera between capture statistics reports */
+#define VIN_REPORT_PERIOD               1024
+
 /* ...external VIN device names */
 extern char * vin_devices[CAMERAS_NUMBER];
 
+/* ...map buffers into user space (buffers are exported as DMABUFs anyway) */
+extern int __vin_mmap;
+
 /*******************************************************************************
  * Local types definitions
  ******************************************************************************/
 
+/* ...capture statistics of a camera */
+typedef struct vin_stats
+{
+    /* ...number of frames received */
+    u32             received;
+
+    /* ...number of sequence gaps and frames lost by a driver in them */
+    u32             gaps, lost;
+
+    /* ...buffers held by application when gaps were detected (total and maximum) */
+    u32             busy_sum, busy_max;
+
+}   vin_stats_t;
+
 /* ...buffer description */
 typedef struct vin_buffer
 {
@@ -103,10 +125,19 @@ typedef struct vin_device
     /* ...conditional variable for busy buffers collection */
     pthread_cond_t          wait;
 
+    /* ...expected sequence number of next frame */
+    u32                     seq;
+
+    /* ...capture statistics */
+    vin_stats_t             stats;
+
+    /* ...reactor event source */
+    reactor_source_t        source;
+
 }   vin_device_t;
     
 /* ...decoder data structure */   
-typedef struct vin_data
+struct vin_data
 {
     /* ...GStreamer bin element for pipeline handling */
     GstElement                 *bin;
@@ -114,6 +145,9 @@ typedef struct vin_data
     /* ...single epoll-descriptor */
     int                         efd;
 
+    /* ...shared reactor (devices are serviced by reactor thread; optional) */
+    reactor_t                  *reactor;
+
     /* ...number of devices connected */
     int                         num;
     
@@ -149,8 +183,7 @@ typedef struct vin_data
 
     /* ...application callback data */
     void                       *cdata;
-
-}   vin_data_t;
+};
 
 /*******************************************************************************
  * Custom buffer metadata implementation
@@ -343,6 +376,10 @@ static inline int vin_allocate_buffers(int vfd, vin_buffer_t *pool, int num)
         CHK_API(ioctl(vfd, VIDIOC_QUERYBUF, &buf));
         _buf->length = buf.length;
         _buf->offset = buf.m.offset;
+
+        /* ...CPU mapping is optional; consumers import exported descriptors */
+        if (!__vin_mmap)    continue;
+
         _buf->data = mmap(NULL, _buf->length, PROT_READ | PROT_WRITE, MAP_SHARED, vfd, _buf->offset);
         CHK_ERR(_buf->data != MAP_FAILED, -errno);
 
@@ -386,7 +423,7 @@ static inline int vin_destroy_buffers(int vfd, vin_buffer_t *pool, int num)
     /* ...unmap all buffers */
     for (j = 0; j < num; j++)
     {
-        munmap(pool[j].data, pool[j].length);
+        (pool[j].data ? munmap(pool[j].data, pool[j].length) : 0);
     }
     
     /* ...release kernel-allocated buffers */
@@ -447,7 +484,14 @@ static inline int __register_poll(vin_data_t *vin, int i, int add)
     event.events = EPOLLIN, event.data.u32 = (u32)i;
 
     /* ...add/remove source */
-    CHK_API(epoll_ctl(vin->efd, (add ? EPOLL_CTL_ADD : EPOLL_CTL_DEL), dev->vfd, &event));
+    if (vin->reactor)
+    {
+        CHK_API(reactor_poll(vin->reactor, dev->vfd, &dev->source, add));
+    }
+    else
+    {
+        CHK_API(epoll_ctl(vin->efd, (add ? EPOLL_CTL_ADD : EPOLL_CTL_DEL), dev->vfd, &event));
+    }
 
     TRACE(DEBUG, _b("#%d: poll source %s"), i, (add ? "added" : "removed"));
 
@@ -473,6 +517,41 @@ static inline int __submit_buffer(vin_data_t *vin, int i, int j)
     return 0;
 }
 
+/* ...account frames lost by a driver (capture pool exhausted by slow consumers) */
+static inline void __vin_sequence_check(vin_device_t *dev, int i, u32 seq)
+{
+    vin_stats_t    *stats = &dev->stats;
+    u32             lost = 0;
+
+    /* ...sequence going backwards (stream restart or driver reset) is a resync, not a loss */
+    if (stats->received && seq < dev->seq)
+    {
+        TRACE(INFO, _b("vin-%d: sequence resync: %u -> %u"), i, dev->seq, seq);
+    }
+    else if (stats->received)
+    {
+        lost = seq - dev->seq;
+    }
+
+    if (lost)
+    {
+        stats->gaps++, stats->lost += lost;
+        stats->busy_sum += dev->busy;
+        ((u32)dev->busy > stats->busy_max ? stats->busy_max = dev->busy : 0);
+
+        TRACE(DEBUG, _b("vin-%d: %u frames lost before seq=%u (held by application: %d, queued: %d)"), i, lost, seq, dev->busy, dev->submitted);
+    }
+
+    dev->seq = seq + 1;
+
+    /* ...report statistics periodically */
+    if (++stats->received % VIN_REPORT_PERIOD == 0)
+    {
+        TRACE(INFO, _b("vin-%d: %u frames received, %u lost in %u gaps, buffers held at gaps: avg %u, max %u"),
+              i, stats->received, stats->lost, stats->gaps, (stats->gaps ? stats->busy_sum / stats->gaps : 0), stats->busy_max);
+    }
+}
+
 /* ...buffer processing function */
 static inline int __process_buffer(vin_data_t *vin, int i)
 {
@@ -491,12 +570,18 @@ static inline int __process_buffer(vin_data_t *vin, int i)
     /* ...remove poll-source if last buffer is dequeued */
     (--dev->submitted == 0 ? __register_poll(vin, i, 0) : 0);
 
+    /* ...detect sequence gaps */
+    __vin_sequence_check(dev, i, seq);
+
     /* ...get buffer descriptor */
     buffer = dev->pool[j].buffer;
     
     /* ...set decoding/presentation timestamp (in nanoseconds) */
     GST_BUFFER_DTS(buffer) = GST_BUFFER_PTS(buffer) = ts * 1000;
 
+    /* ...keep capture sequence number (offset of raw video buffer is a frame number) */
+    GST_BUFFER_OFFSET(buffer) = seq;
+
     TRACE(DEBUG, _b("dequeued buffer #<%d,%d>, ts=%llu, seq=%u, submitted=%d"), i, j, (unsigned long long)ts, seq, dev->submitted);
 
     /* ...advance number of busy buffers */
@@ -517,12 +602,30 @@ static inline int __process_buffer(vin_data_t *vin, int i)
     return 0;
 }
 
+/* ...reactor event processing hook */
+static int __vin_reactor_hook(void *cdata, int i, u32 events)
+{
+    vin_data_t     *vin = cdata;
+    int             r;
+
+    BUG(!(events & EPOLLIN), _x("invalid poll events: i=%d, event=%X"), i, events);
+
+    /* ...event may have been retrieved before device was closed */
+    pthread_mutex_lock(&vin->lock);
+    r = (vin->dev[i].active ? __process_buffer(vin, i) : 0);
+    pthread_mutex_unlock(&vin->lock);
+
+    return r;
+}
+
 /* ...decoding thread */
 static void * vin_thread(void *arg)
 {
     vin_data_t         *vin = arg;
     struct epoll_event  event[vin->num];
 
+    thread_placement(THREAD_INPUT);
+
     /* ...lock internal data access */
     pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
     pthread_mutex_lock(&vin->lock);
@@ -561,10 +664,10 @@ static void * vin_thread(void *arg)
         {
             int     i = (int)event[k].data.u32;
 
-            /* ...process output buffers */
+            /* ...process output buffers (device may have been closed meanwhile) */
             if (event[k].events & EPOLLIN)
             {
-                if (__process_buffer(vin, i) < 0)
+                if (vin->dev[i].active && __process_buffer(vin, i) < 0)
                 {
                     TRACE(ERROR, _x("processing failed: %m"));
                     goto out;
@@ -597,6 +700,9 @@ int vin_start(vin_data_t *vin)
     /* ...mark module is active */
     vin->active = 1;
 
+    /* ...devices are serviced by shared reactor */
+    if (vin->reactor)   return 0;
+
     /* ...initialize thread attributes (joinable, 128KB stack) */
     pthread_attr_init(&attr);
     pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
@@ -741,6 +847,7 @@ int vin_device_init(vin_data_t *vin, int i, int w, int h, u32 fmt, int size)
         CHK_ERR((n = __v4l2_pixfmt_planes(w, h, fmt, size, vmeta->stride)) > 0, -(errno = EINVAL));
         CHK_API(vin_export_buffers(dev->vfd, j, vmeta->dmafd));
         vmeta->plane[0] = buf->data;
+        CHK_ERR(vmeta->dmafd[0] >= 0, -(errno = EBADF));
 
         TRACE(1, _b("plane #%d: fd=%d, offset=%u, size=%u"), 0, vmeta->dmafd[0], 0, size[0]);
 
@@ -781,6 +888,9 @@ static void __vin_device_close(vin_data_t *vin, int i)
     /* ...if anything has been submitted, cancel it */
     dev->active = 0;
 
+    /* ...stop polling the device */
+    (dev->submitted ? __register_poll(vin, i, 0), dev->submitted = 0 : 0);
+
     /* ...wait until all buffers are collected */
     while (dev->busy)
     {
@@ -813,16 +923,16 @@ static void __vin_device_close(vin_data_t *vin, int i)
 void vin_destroy(gpointer data, GObject *obj)
 {
     vin_data_t     *vin = data;
-    int             i;
+    int             i, started;
 
     /* ...acquire lock */
     pthread_mutex_lock(&vin->lock);
     
-    /* ...clear activity flag */
-    vin->active = 0;
+    /* ...clear activity flag (processing thread exists only if module was started) */
+    started = vin->active, vin->active = 0;
 
     /* ...cancel processing thread */
-    pthread_cancel(vin->thread);
+    (vin->reactor || !started ? 0 : pthread_cancel(vin->thread));
 
     /* ...wait for all devices flushing */
     for (i = 0; i < vin->num; i++)
@@ -830,10 +940,24 @@ void vin_destroy(gpointer data, GObject *obj)
         __vin_device_close(vin, i);
     }    
 
+    pthread_mutex_unlock(&vin->lock);
+
+    /* ...make sure no event processing is in progress before memory is released */
+    if (vin->reactor)
+    {
+        reactor_sync(vin->reactor);
+    }
+    else if (started)
+    {
+        pthread_join(vin->thread, NULL);
+    }
+
     /* ...destroy mutex */
     pthread_mutex_destroy(&vin->lock);
     
     /* ...destroy decoder structure */
+    close(vin->efd);
+    free(vin->dev);
     free(vin);
 
     TRACE(INIT, _b("vin-camera-bin destroyed"));
@@ -859,6 +983,9 @@ vin_data_t * vin_init(char **devname, int num, camera_callback_t *cb, void *cdat
         goto error;
     }
 
+    /* ...devices may be serviced by shared reactor instead of own thread */
+    vin->reactor = reactor_get();
+
     /* ...create epoll descriptor */
     if ((vin->efd = epoll_create(num)) < 0)
     {
@@ -871,6 +998,9 @@ vin_data_t * vin_init(char **devname, int num, camera_callback_t *cb, void *cdat
     {
         vin_device_t   *dev = &vin->dev[i];
 
+        /* ...set reactor event source */
+        dev->source.hook = __vin_reactor_hook, dev->source.cdata = vin, dev->source.id = i;
+
         /* ...open VIN device */
         if ((dev->vfd = open(devname[i], O_RDWR | O_NONBLOCK)) < 0)
         {
@@ -27,7 +27,7 @@
 #ifndef __UTEST_VIN_H
 #define __UTEST_VIN_H
 
-typedef struct vin_data    *vin_data_t;
+typedef struct vin_data    vin_data_t;
 
 extern vin_data_t * vin_init(char **devname, int num, camera_callback_t *cb, void *cdata);
 
@@ -35,5 +35,7 @@ extern int vin_device_init(vin_data_t *vin, int i, int w, int h, u32 fmt, int si
 
 extern int vin_start(vin_data_t *vin);
 
+extern void vin_destroy(gpointer data, GObject *obj);
+
 #endif  /* __UTEST_VIN_H */
 
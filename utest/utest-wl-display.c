@@ -108,6 +108,9 @@ typedef struct input_data
 
 }   input_data_t;
 
+/* ...maximal number of tracked DMA-buffer formats accepted by the compositor */
+#define DISPLAY_DMABUF_FORMATS_MAX      32
+
 /* ...dispatch loop source */
 typedef struct display_source_cb
 {
@@ -140,6 +143,10 @@ struct display_data
     /* ....DMA buffers handling interface */
     struct zlinux_dmabuf       *dmabuf;
 
+    /* ...DMA-buffer formats accepted by the compositor */
+    uint32_t                    dmabuf_format[DISPLAY_DMABUF_FORMATS_MAX];
+    int                         dmabuf_formats;
+
     /* ...scaling interface */
     struct wl_scaler           *scaler;
 
@@ -314,6 +321,8 @@ static void * dispatch_thread(void *arg)
     display_data_t     *display = arg;
     struct epoll_event  event[DISPLAY_EVENTS_NUM];
 
+    thread_placement(THREAD_DISPLAY);
+
     /* ...add display file descriptor */
     CHK_ERR(display_add_poll_source(display, wl_display_get_fd(display->display), NULL) == 0, NULL);
 
@@ -1373,9 +1382,25 @@ error:
 
 static void dmabuf_format(void *data, struct zlinux_dmabuf *dmabuf, uint32_t format)
 {
-    display_data_t     __trace__(*display) = data;
+    display_data_t     *display = data;
 
     TRACE(DEBUG, _b("dmabuf-format supported: %X"), format);
+
+    /* ...remember formats a client buffer can be passed in */
+    (display->dmabuf_formats < DISPLAY_DMABUF_FORMATS_MAX ? display->dmabuf_format[display->dmabuf_formats++] = format : 0);
+}
+
+/* ...check if compositor accepts DMA-buffers of given format (no formats reported - unknown) */
+static int dmabuf_format_supported(display_data_t *display, uint32_t format)
+{
+    int     i;
+
+    for (i = 0; i < display->dmabuf_formats; i++)
+    {
+        if (display->dmabuf_format[i] == format)    return 1;
+    }
+
+    return (display->dmabuf_formats == 0 || display->dmabuf_formats == DISPLAY_DMABUF_FORMATS_MAX);
 }
 
 static const struct zlinux_dmabuf_listener dmabuf_listener = {
@@ -1483,6 +1508,8 @@ static void * window_thread(void *arg)
     window_data_t      *window = arg;
     display_data_t     *display = window->display;
 
+    thread_placement(THREAD_RENDER);
+
     /* ...register current window inside TLS */
     pthread_setspecific(__key_window, window);
 
@@ -2474,7 +2501,7 @@ static inline float texture_view_height(texture_view_t *v)
     return ((*v)[5] - (*v)[1]) / 2;    
 }
 
-/* ...draw external texture in given view-port */
+/* ...draw external texture in given view-port (DMA-buffer is attached to window surface; no GPU pass) */
 void texture_draw(texture_data_t *texture, texture_view_t *view, texture_crop_t *crop, float alpha)
 {
     window_data_t      *window = pthread_getspecific(__key_window);
@@ -2595,6 +2622,14 @@ texture_data_t * texture_create(int w, int h, int format, int *dmafd, unsigned *
     /* ...map format to the internal value */
     CHK_ERR((fmt = __pixfmt_gst_to_drm(format, &n)) > 0, (errno = EINVAL, NULL));
 
+    /* ...buffer is handed to the compositor as is; it must accept the format */
+    if (!dmabuf_format_supported(display, fmt))
+    {
+        TRACE(ERROR, _x("DMA-buffer format %c%c%c%c is not accepted by the compositor"), __v4l2_fmt(fmt));
+        errno = EINVAL;
+        return NULL;
+    }
+
     /* ...allocate texture data */
     CHK_ERR(texture = malloc(sizeof(*texture)), (errno = ENOMEM, NULL));
 